@@ -0,0 +1,312 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/cmethod.h"
+#include "utils/macro.h"
+#include "bench.h"
+
+
+#define ARRAY_LEN 1024
+
+static const struct CObjSlot slot_len = {.name = "len"};
+static const struct CObjSlot slot_size = {.name = "size"};
+static const struct CObjSlot slot_init = {.name = "init"};
+static const struct CObjSlot slot_destroy = {.name = "destroy"};
+static const struct CObjSlot slot_move = {.name = "move"};
+static const struct CObjSlot slot_find = {.name = "find"};
+static const struct CObjSlot slot_fill = {.name = "fill"};
+static const struct CObjSlot slot_array_hash = {.name = "array_hash"};
+static const struct CObjSlot slot_sort = {.name = "sort"};
+static const struct CObjSlot slot_stable_sort = {.name = "stable_sort"};
+
+
+struct ArrayArg {
+  const struct CObjTag *types[2];
+  struct CMethodContext context;
+  void *src;
+  void *dst;
+  /// element size
+  int size;
+};
+
+
+static void run_len (void *arg, long n) {
+  struct ArrayArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    bench_clobber();
+    bench_sink = ((int (*) ()) a->context.func)(a->src, &a->context);
+  }
+}
+
+
+static void run_init (void *arg, long n) {
+  struct ArrayArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    bench_clobber();
+    bench_sink = ((int (*) ()) a->context.func)(a->dst, a->src, &a->context);
+  }
+}
+
+
+// sort a fresh copy of the unsorted source each time
+static void run_sort (void *arg, long n) {
+  struct ArrayArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    memcpy(a->dst, a->src, a->size * (ARRAY_LEN + 1));
+    bench_clobber();
+    bench_sink = ((int (*) ()) a->context.func)(a->dst, &a->context);
+  }
+}
+
+
+static void run_destroy (void *arg, long n) {
+  struct ArrayArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    bench_clobber();
+    a->context.func(a->src, &a->context);
+  }
+}
+
+
+static void run_find (void *arg, long n) {
+  struct ArrayArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    bench_clobber();
+    // the terminator is the only match
+    bench_sink = ((CObjFindFunc) a->context.func)(
+      a->src, ARRAY_LEN + 1, a->dst, &a->context);
+  }
+}
+
+
+static void run_fill (void *arg, long n) {
+  struct ArrayArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    bench_clobber();
+    ((CObjFillFunc) a->context.func)(a->dst, ARRAY_LEN, a->src, &a->context);
+  }
+}
+
+
+static void run_array_hash (void *arg, long n) {
+  struct ArrayArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    bench_clobber();
+    bench_sink = ((CObjArrayHashFunc) a->context.func)(
+      a->src, ARRAY_LEN, &a->context);
+  }
+}
+
+
+static void run_dispatch (void *arg, long n) {
+  struct ArrayArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    struct CMethodContext context;
+    context.types = a->types;
+    context.len = 2;
+    bench_clobber();
+    bench_sink = CMethodContext_init(&context, &slot_init);
+  }
+}
+
+
+static void run_append (void *arg, long n) {
+  struct ArrayArg *a = arg;
+  int size = CObjTagArray_get0(a->types[1], &slot_size, a->src);
+  for (long i = 0; i < n; i++) {
+    struct CObjVector vector = {0};
+    for (int j = 0; j < ARRAY_LEN; j++) {
+      bench_clobber();
+      int res = CObjVector_append(
+        &vector, a->types[0], (char *) a->src + size * j, NULL);
+      should (res == 0) otherwise {
+        abort();
+      }
+    }
+    free(vector.data);
+  }
+}
+
+
+/// moves left before the mover of Failing fails
+static long failing_moves;
+
+
+static int Failing_move (long *self, long *other,
+                         const struct CMethodContext *ctx) {
+  (void) ctx;
+  return_if (failing_moves-- == 0) 1;
+  *self = *other;
+  *other = -1;
+  return 0;
+}
+static const struct CMethod Failing_move_[] = {
+  {.func = (CObjFunc) Failing_move}, {0}};
+
+
+static void Failing_destroy (long *self, const struct CMethodContext *ctx) {
+  (void) ctx;
+  *self = -2;
+}
+static const struct CMethod Failing_destroy_[] = {
+  {.func = (CObjFunc) Failing_destroy}, {0}};
+
+
+// grow a vector whose mover fails halfway, and check the elements are kept
+static void run_grow_fail (void *arg, long n) {
+  struct ArrayArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    struct CObjVector vector = {0};
+    should (CObjVector_extend(
+        &vector, a->types[0], a->src, ARRAY_LEN, NULL) == 0) otherwise {
+      abort();
+    }
+    failing_moves = vector.len / 2;
+    bench_clobber();
+    should (CObjVector_reserve(
+        &vector, a->types[0], vector.cap * 2, NULL) != 0) otherwise {
+      abort();
+    }
+    should (vector.len == ARRAY_LEN && memcmp(
+        vector.data, a->src, sizeof(long) * ARRAY_LEN) == 0) otherwise {
+      abort();
+    }
+    free(vector.data);
+  }
+}
+
+
+static void prepare (
+    struct ArrayArg *arg, const struct CObjSlot *slot, int len) {
+  arg->context.types = arg->types;
+  arg->context.len = len;
+  arg->context.msg = NULL;
+  should (CMethodContext_init(&arg->context, slot) == 0) otherwise {
+    abort();
+  }
+}
+
+
+void bench_array (void) {
+  static const struct {
+    const struct CObjTag *type;
+    int size;
+  } elements[] = {
+    {Imm1Type, 1}, {Imm2Type, 2}, {Imm4Type, 4}, {Imm8Type, 8},
+    {Imm16Type, 16},
+  };
+
+  for (unsigned i = 0; i < arraysize(elements); i++) {
+    int size = elements[i].size;
+    struct CObjTag tags[] = {
+      {.name = "super", .tags = elements[i].type, .type = COBJ_TYPE_TAGS},
+      COBJ_TAG_ARRAY_LEN,
+      COBJ_TAG_ARRAY_SIZE,
+      COBJ_TAG_ARRAY_DESTROY,
+      COBJ_TAG_ARRAY_INIT,
+      COBJ_TAG_ARRAY_MOVE,
+      COBJ_TAG_ARRAY_SORT,
+      COBJ_TAG_ARRAY_STABLE_SORT,
+    };
+    const struct CObjTag *type = bench_tags(tags, arraysize(tags));
+
+    struct ArrayArg arg = {
+      .types = {type, type},
+      .src = malloc(size * (ARRAY_LEN + 1)),
+      .dst = malloc(size * (ARRAY_LEN + 1)),
+      .size = size,
+    };
+    should (arg.src != NULL && arg.dst != NULL) otherwise {
+      abort();
+    }
+    memset(arg.src, 0x5a, size * ARRAY_LEN);
+    memset((char *) arg.src + size * ARRAY_LEN, 0, size);
+
+    prepare(&arg, &slot_len, 1);
+    bench_report("array", "len", run_len, &arg,
+                 "\"element_size\": %d, \"length\": %d", size, ARRAY_LEN);
+    prepare(&arg, &slot_size, 1);
+    bench_report("array", "size", run_len, &arg,
+                 "\"element_size\": %d, \"length\": %d", size, ARRAY_LEN);
+    prepare(&arg, &slot_init, 2);
+    bench_report("array", "init", run_init, &arg,
+                 "\"element_size\": %d, \"length\": %d", size, ARRAY_LEN);
+    prepare(&arg, &slot_move, 2);
+    bench_report("array", "move", run_init, &arg,
+                 "\"element_size\": %d, \"length\": %d", size, ARRAY_LEN);
+
+    // nonzero bytes, so that no element terminates the array early
+    unsigned seed = 1;
+    for (int j = 0; j < size * ARRAY_LEN; j++) {
+      seed = seed * 1103515245 + 12345;
+      ((unsigned char *) arg.src)[j] = (seed >> 16) | 1;
+    }
+    prepare(&arg, &slot_sort, 1);
+    bench_report("array", "sort", run_sort, &arg,
+                 "\"element_size\": %d, \"length\": %d", size, ARRAY_LEN);
+    prepare(&arg, &slot_stable_sort, 1);
+    bench_report("array", "stable_sort", run_sort, &arg,
+                 "\"element_size\": %d, \"length\": %d", size, ARRAY_LEN);
+    memset(arg.src, 0x5a, size * ARRAY_LEN);
+
+    prepare(&arg, &slot_destroy, 1);
+    bench_report("array", "destroy", run_destroy, &arg,
+                 "\"element_size\": %d, \"length\": %d", size, ARRAY_LEN);
+    bench_report("array", "dispatch_init", run_dispatch, &arg,
+                 "\"element_size\": %d", size);
+
+    struct ArrayArg element_arg = {
+      .types = {elements[i].type},
+      .src = arg.src,
+      .dst = arg.dst,
+    };
+    memset(arg.dst, 0, size * (ARRAY_LEN + 1));
+    prepare(&element_arg, &slot_find, 1);
+    bench_report("imm", "find", run_find, &element_arg,
+                 "\"element_size\": %d, \"length\": %d", size, ARRAY_LEN);
+    prepare(&element_arg, &slot_fill, 1);
+    bench_report("imm", "fill", run_fill, &element_arg,
+                 "\"element_size\": %d, \"length\": %d", size, ARRAY_LEN);
+    prepare(&element_arg, &slot_array_hash, 1);
+    bench_report("imm", "array_hash", run_array_hash, &element_arg,
+                 "\"element_size\": %d, \"length\": %d", size, ARRAY_LEN);
+
+    struct CObjTag vector_tags[] = {
+      {.name = "super", .tags = elements[i].type, .type = COBJ_TYPE_TAGS},
+    };
+    struct ArrayArg vector_arg = {
+      .types = {bench_tags(vector_tags, arraysize(vector_tags)),
+                elements[i].type},
+      .src = arg.src,
+    };
+    bench_report("vector", "append", run_append, &vector_arg,
+                 "\"element_size\": %d, \"length\": %d", size, ARRAY_LEN);
+
+    free(arg.src);
+    free(arg.dst);
+  }
+
+  static const struct CObjTag Failing[] = {
+    COBJ_TAG_SIZEOF(long),
+    {.name = "move", .methods = Failing_move_, .type = COBJ_TYPE_CMETHODS},
+    {.name = "destroy", .methods = Failing_destroy_,
+     .type = COBJ_TYPE_CMETHODS},
+    COBJ_TAG_END
+  };
+  static const struct CObjTag FailingVector[] = {
+    {.name = "super", .tags = Failing, .type = COBJ_TYPE_TAGS},
+    COBJ_TAG_END
+  };
+  long *src = malloc(sizeof(long) * ARRAY_LEN);
+  should (src != NULL) otherwise {
+    abort();
+  }
+  for (int i = 0; i < ARRAY_LEN; i++) {
+    src[i] = i;
+  }
+  struct ArrayArg arg = {.types = {FailingVector}, .src = src};
+  bench_report("vector", "grow_fail", run_grow_fail, &arg,
+               "\"element_size\": %d, \"length\": %d", (int) sizeof(long),
+               ARRAY_LEN);
+  free(src);
+}
@@ -0,0 +1,173 @@
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "include/ccache.h"
+#include "utils/macro.h"
+#include "bench.h"
+
+
+#define BENCH_REPEAT 3
+
+volatile long bench_sink;
+
+static long min_time_ns = 20 * 1000 * 1000;
+static const char *filter;
+static bool first_result = true;
+
+
+long bench_now_ns (void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+
+void bench_run (struct BenchResult *result, BenchFunc func, void *arg) {
+  // find iteration count that takes at least min_time_ns
+  long n = 1;
+  long elapsed;
+  while (1) {
+    long start = bench_now_ns();
+    func(arg, n);
+    elapsed = bench_now_ns() - start;
+    break_if (elapsed >= min_time_ns || n >= 1L << 40);
+    long next = elapsed <= 0 ? n * 100 :
+      (long) ((double) n * min_time_ns * 1.2 / elapsed);
+    n = max(next, n * 2);
+  }
+
+  double best = (double) elapsed / n;
+  for (int i = 1; i < BENCH_REPEAT; i++) {
+    long start = bench_now_ns();
+    func(arg, n);
+    double ns = (double) (bench_now_ns() - start) / n;
+    best = min(best, ns);
+  }
+  result->ns_per_op = best;
+  result->iterations = n;
+}
+
+
+void bench_result_begin (void) {
+  printf("%s\n    ", first_result ? "" : ",");
+  first_result = false;
+}
+
+
+bool bench_selected (const char *group, const char *name) {
+  return_if (filter == NULL) true;
+  char full[256];
+  snprintf(full, sizeof(full), "%s/%s", group, name);
+  return strstr(full, filter) != NULL;
+}
+
+
+void bench_report (
+    const char *group, const char *name, BenchFunc func, void *arg,
+    const char *params_fmt, ...) {
+  return_if_fail (bench_selected(group, name));
+
+  char params[256];
+  va_list ap;
+  va_start(ap, params_fmt);
+  vsnprintf(params, sizeof(params), params_fmt, ap);
+  va_end(ap);
+
+  for (int cached = 1; cached >= 0; cached--) {
+    bool old = CObjCache_enable(cached);
+    CObjCache_clear();
+    struct BenchResult result;
+    bench_run(&result, func, arg);
+    CObjCache_enable(old);
+
+    bench_result_begin();
+    printf("{\"group\": \"%s\", \"name\": \"%s\", \"params\": {%s}, "
+           "\"cache\": %s, \"ns_per_op\": %.3f, \"iterations\": %ld}",
+           group, name, params, cached ? "true" : "false", result.ns_per_op,
+           result.iterations);
+    fflush(stdout);
+  }
+}
+
+
+const struct CObjTag *bench_tags (const struct CObjTag *tags, int len) {
+  struct CObjTag *ret = calloc(len + 1, sizeof(*ret));
+  should (ret != NULL) otherwise {
+    perror("calloc");
+    exit(EXIT_FAILURE);
+  }
+  memcpy(ret, tags, sizeof(*ret) * len);
+  return ret;
+}
+
+
+void bench_slot (struct CObjSlot *slot, const char *format, ...) {
+  char buf[sizeof(slot->name) + 1];
+  va_list ap;
+  va_start(ap, format);
+  vsnprintf(buf, sizeof(buf), format, ap);
+  va_end(ap);
+  memset(slot, 0, sizeof(*slot));
+  memcpy(slot->name, buf, sizeof(slot->name));
+}
+
+
+static void usage (const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-t MSEC] [-f FILTER] [-s [-j THREADS]]\n"
+          "  -t MSEC     minimum time of each repetition (default: 20)\n"
+          "  -f FILTER   only run benchmarks whose \"group/name\" contains "
+          "FILTER\n"
+          "  -s          measure multithreaded scaling instead; exit with "
+          "failure if\n"
+          "              any benchmark scales sublinearly\n"
+          "  -j THREADS  maximum number of threads (default: online CPUs)\n",
+          prog);
+}
+
+
+int main (int argc, char *argv[]) {
+  bool scaling = false;
+  int threads = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:f:sj:h")) != -1) {
+    switch (opt) {
+      case 't':
+        min_time_ns = atol(optarg) * 1000 * 1000;
+        break;
+      case 'f':
+        filter = optarg;
+        break;
+      case 's':
+        scaling = true;
+        break;
+      case 'j':
+        threads = atoi(optarg);
+        break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  if (scaling) {
+    printf("{\n  \"unit\": \"ops/s\",\n  \"results\": [");
+    int flagged = bench_scaling(threads, min_time_ns);
+    printf("\n  ]\n}\n");
+    return flagged == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  printf("{\n  \"unit\": \"ns\",\n  \"results\": [");
+  bench_lookup();
+  bench_method();
+  bench_array();
+  bench_map();
+  bench_exec();
+  printf("\n  ]\n}\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#ifndef COBJ_BENCH_BENCH_H
+#define COBJ_BENCH_BENCH_H
+
+#include <stdbool.h>
+
+#include "include/cobj.h"
+#ifdef COBJ_HEADER_ONLY
+#include "include/cobj-inline.h"
+#endif
+
+
+/**
+ * @file
+ * Microbenchmark harness. Results are written to stdout as JSON.
+ */
+
+
+/// benchmark body, runs @p n iterations
+typedef void (*BenchFunc) (void *arg, long n);
+
+/// Benchmark result.
+struct BenchResult {
+  /// nanoseconds per iteration, best of all repetitions
+  double ns_per_op;
+  /// iterations per repetition
+  long iterations;
+};
+
+/// sink to prevent the compiler from discarding results
+extern volatile long bench_sink;
+
+/// prevent the compiler from hoisting pure function calls out of loops
+static inline void bench_clobber (void) {
+  __asm__ volatile ("" : : : "memory");
+}
+
+/**
+ * @brief Get the time of a monotonic clock.
+ *
+ * @return Time in nanoseconds.
+ */
+long bench_now_ns (void);
+
+__attribute__((nonnull(1, 2)))
+/**
+ * @brief Calibrate and run a benchmark.
+ *
+ * @param[out] result Benchmark result.
+ * @param func Benchmark body.
+ * @param arg Argument to @p func.
+ */
+void bench_run (struct BenchResult *result, BenchFunc func, void *arg);
+
+__attribute__((pure, nonnull))
+/**
+ * @brief Test whether a benchmark passes the filter given on the command line.
+ *
+ * @param group Benchmark group.
+ * @param name Benchmark name.
+ * @return @c true if the benchmark should be run.
+ */
+bool bench_selected (const char *group, const char *name);
+
+/**
+ * @brief Start a result entry in the JSON output, printing the separator from
+ *  the previous entry.
+ */
+void bench_result_begin (void);
+
+__attribute__((nonnull(1, 2, 3, 5), format(printf, 5, 6)))
+/**
+ * @brief Run a benchmark with lookup caches enabled and disabled, and report
+ *  the results, unless filtered out.
+ *
+ * @param group Benchmark group.
+ * @param name Benchmark name.
+ * @param func Benchmark body.
+ * @param arg Argument to @p func.
+ * @param params_fmt Format string of JSON object members describing the
+ *  parameters, for example `"\"depth\": %d"`.
+ * @param ... Format arguments.
+ */
+void bench_report (
+  const char *group, const char *name, BenchFunc func, void *arg,
+  const char *params_fmt, ...);
+
+__attribute__((nonnull))
+/**
+ * @brief Build a tag set on heap. The tag set is never freed.
+ *
+ * @param tags Tags, not including the terminator.
+ * @param len Number of tags.
+ * @return Tag set.
+ */
+const struct CObjTag *bench_tags (const struct CObjTag *tags, int len);
+
+__attribute__((nonnull))
+/**
+ * @brief Make a slot from a format string.
+ *
+ * @param[out] slot Slot.
+ * @param format Format string.
+ * @param ... Format arguments.
+ */
+void bench_slot (struct CObjSlot *slot, const char *format, ...);
+
+void bench_lookup (void);
+void bench_method (void);
+void bench_array (void);
+void bench_map (void);
+void bench_exec (void);
+
+/**
+ * @brief Measure the throughput of concurrent lookups and array methods from
+ *  1 up to @p threads threads, and flag sublinear scaling.
+ *
+ * @param threads Maximum number of threads, or 0 for the number of online
+ *  CPUs.
+ * @param time_ns Duration of each measurement.
+ * @return Number of measurements flagged as not scaling.
+ */
+int bench_scaling (int threads, long time_ns);
+
+
+#endif /* COBJ_BENCH_BENCH_H */
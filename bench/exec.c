@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/cexec.h"
+#include "utils/macro.h"
+#include "bench.h"
+
+
+/// number of tasks per batch
+#define EXEC_TASKS 256
+/// number of elements copied by each task
+#define EXEC_LEN 1024
+
+static const struct CObjSlot slot_init = {.name = "init"};
+
+
+struct ExecArg {
+  struct CObjExecutor *executor;
+  struct CObjTask tasks[EXEC_TASKS];
+  int status[EXEC_TASKS];
+};
+
+
+static void run_inline (void *arg, long n) {
+  struct ExecArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    for (int j = 0; j < EXEC_TASKS; j++) {
+      struct CObjTask *task = a->tasks + j;
+      bench_clobber();
+      a->status[j] = ((int (*) ()) task->context.func)(
+        task->self, task->other, &task->context);
+    }
+  }
+}
+
+
+static void run_executor (void *arg, long n) {
+  struct ExecArg *a = arg;
+  struct CObjTaskGroup *group = CObjTaskGroup_new(a->executor);
+  should (group != NULL) otherwise {
+    abort();
+  }
+  for (long i = 0; i < n; i++) {
+    should (CObjTaskGroup_submit(group, a->tasks, EXEC_TASKS) == 0) otherwise {
+      abort();
+    }
+    bench_sink = CObjTaskGroup_wait(group, NULL);
+  }
+  CObjTaskGroup_free(group);
+}
+
+
+void bench_exec (void) {
+  static const struct CObjTag tags[] = {
+    {.name = "super", .tags = Imm8Type, .type = COBJ_TYPE_TAGS},
+    COBJ_TAG_ARRAY_INIT,
+  };
+  static const struct CObjTag *types[2];
+  types[0] = types[1] = bench_tags(tags, arraysize(tags));
+
+  struct ExecArg *arg = calloc(1, sizeof(*arg));
+  // each task copies its own array, terminator included
+  char *src = malloc(8 * (EXEC_LEN + 1));
+  char *dst = malloc(8 * (EXEC_LEN + 1) * EXEC_TASKS);
+  should (arg != NULL && src != NULL && dst != NULL) otherwise {
+    abort();
+  }
+  memset(src, 0x5a, 8 * EXEC_LEN);
+  memset(src + 8 * EXEC_LEN, 0, 8);
+
+  struct CMethodContext context = {.types = types, .len = 2};
+  should (CMethodContext_init(&context, &slot_init) == 0) otherwise {
+    abort();
+  }
+  for (int i = 0; i < EXEC_TASKS; i++) {
+    arg->tasks[i] = (struct CObjTask) {
+      .context = context, .self = dst + 8 * (EXEC_LEN + 1) * i, .other = src,
+      .status = arg->status + i,
+    };
+  }
+
+  bench_report("exec", "inline", run_inline, arg,
+               "\"tasks\": %d, \"length\": %d", EXEC_TASKS, EXEC_LEN);
+  static const int threads[] = {1, 2, 4, 0};
+  for (unsigned i = 0; i < arraysize(threads); i++) {
+    arg->executor = CObjExecutor_new(threads[i]);
+    should (arg->executor != NULL) otherwise {
+      abort();
+    }
+    bench_report("exec", "executor", run_executor, arg,
+                 "\"tasks\": %d, \"length\": %d, \"threads\": %d",
+                 EXEC_TASKS, EXEC_LEN, CObjExecutor_threads(arg->executor));
+    CObjExecutor_free(arg->executor);
+  }
+
+  free(src);
+  free(dst);
+  free(arg);
+}
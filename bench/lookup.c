@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "include/cbuilder.h"
+#include "include/ccache.h"
+#include "include/cobj.h"
+#include "include/cvtable.h"
+#include "utils/macro.h"
+#include "bench.h"
+
+
+static const struct CObjSlot slot_target = {.name = "target"};
+static const struct CObjSlot slot_missing = {.name = "missing"};
+
+
+struct LookupArg {
+  const struct CObjTag *tags;
+  struct CObjSlot slot;
+  const struct CObjSlot *path;
+  const struct CObjVTable *vtable;
+};
+
+
+static void run_find (void *arg, long n) {
+  const struct LookupArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    bench_clobber();
+    bench_sink = (long) CObjTagArray_find(a->tags, &a->slot);
+  }
+}
+
+
+static void run_resolve (void *arg, long n) {
+  const struct LookupArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    const struct CObjTag *target;
+    int offset;
+    bench_clobber();
+    bench_sink = (long) CObjTagArray_resolve(a->tags, &a->slot, &target,
+                                             &offset);
+  }
+}
+
+
+static void run_vtable_resolve (void *arg, long n) {
+  const struct LookupArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    const struct CObjTag *target;
+    int offset;
+    bench_clobber();
+    bench_sink = (long) CObjVTable_resolve(a->vtable, &a->slot, &target,
+                                           &offset);
+  }
+}
+
+
+static void run_resolves (void *arg, long n) {
+  const struct LookupArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    const struct CObjTag *target;
+    int offset;
+    bench_clobber();
+    bench_sink = (long) CObjTagArray_resolves(a->tags, a->path, &target,
+                                              &offset);
+  }
+}
+
+
+static void run_get (void *arg, long n) {
+  const struct LookupArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    bench_clobber();
+    bench_sink = CObjTagArray_get0(a->tags, &a->slot, a);
+  }
+}
+
+
+// tag set of `width` plain tags, the last one being `target`
+static const struct CObjTag *make_wide (int width) {
+  struct CObjTag tags[width];
+  int i;
+  for (i = 0; i < width - 1; i++) {
+    tags[i] = (struct CObjTag) {.value = i};
+    bench_slot(&tags[i].slot, "t%d", i);
+  }
+  tags[i++] = (struct CObjTag) {.name = "target", .value = 42};
+  return bench_tags(tags, i);
+}
+
+
+// like make_wide(), built at runtime with `target` expected to be the hottest
+static struct CObjVTable *make_built (int width) {
+  static const struct CObjSlot slot_size = {.name = "size"};
+  struct CObjTypeBuilder *builder = CObjTypeBuilder_new(NULL);
+  should (builder != NULL) otherwise {
+    perror("CObjTypeBuilder_new");
+    exit(EXIT_FAILURE);
+  }
+  int res = CObjTypeBuilder_add_field(builder, &slot_size, 8, 0);
+  for (int i = 0; res == 0 && i < width - 2; i++) {
+    struct CObjSlot slot;
+    bench_slot(&slot, "t%d", i);
+    res = CObjTypeBuilder_add_field(builder, &slot, i, 1);
+  }
+  if (res == 0) {
+    res = CObjTypeBuilder_add_field(builder, &slot_target, 42, 100);
+  }
+  struct CObjVTable *ret =
+    res == 0 ? CObjTypeBuilder_finalize(builder, NULL, 0) : NULL;
+  should (ret != NULL) otherwise {
+    perror("CObjTypeBuilder_finalize");
+    exit(EXIT_FAILURE);
+  }
+  CObjTypeBuilder_free(builder);
+  return ret;
+}
+
+
+// chain of `depth` tag sets, `target` is defined in the deepest one
+static const struct CObjTag *make_chain (int depth, int width) {
+  const struct CObjTag *type = make_wide(width);
+  for (int i = 1; i < depth; i++) {
+    struct CObjTag tags[width];
+    tags[0] = (struct CObjTag) {
+      .name = "base", .tags = type, .type = COBJ_TYPE_TAGS, .public_ = true,
+      .offset = 8};
+    for (int j = 1; j < width; j++) {
+      tags[j] = (struct CObjTag) {.value = j};
+      bench_slot(&tags[j].slot, "d%dt%d", i, j);
+    }
+    type = bench_tags(tags, width);
+  }
+  return type;
+}
+
+
+// alias chain a0 -> a1 -> ... -> target, defined in a base of the result
+static const struct CObjTag *make_alias (int len, bool virtual_) {
+  struct CObjTag tags[len + 1];
+  for (int i = 0; i < len; i++) {
+    struct CObjSlot *path = calloc(2, sizeof(*path));
+    should (path != NULL) otherwise {
+      perror("calloc");
+      exit(EXIT_FAILURE);
+    }
+    if (i == len - 1) {
+      *path = slot_target;
+    } else {
+      bench_slot(path, "a%d", i + 1);
+    }
+    tags[i] = (struct CObjTag) {
+      .path = path, .type = COBJ_TYPE_PATH, .virtual_ = virtual_};
+    bench_slot(&tags[i].slot, "a%d", i);
+  }
+  tags[len] = (struct CObjTag) {.name = "target", .value = 42};
+  const struct CObjTag *base = bench_tags(tags, len + 1);
+
+  struct CObjTag derived[] = {
+    {.name = "base", .tags = base, .type = COBJ_TYPE_TAGS, .public_ = true,
+     .offset = 8},
+  };
+  return bench_tags(derived, 1);
+}
+
+
+// nested tag sets, reached with path n.n.n...target
+static const struct CObjTag *make_nested (int len, struct CObjSlot **path) {
+  const struct CObjTag *type = make_wide(4);
+  *path = calloc(len + 1, sizeof(**path));
+  should (*path != NULL) otherwise {
+    perror("calloc");
+    exit(EXIT_FAILURE);
+  }
+  for (int i = 0; i < len - 1; i++) {
+    struct CObjTag tags[] = {
+      {.name = "x", .value = 1},
+      {.name = "n", .tags = type, .type = COBJ_TYPE_TAGS},
+    };
+    type = bench_tags(tags, arraysize(tags));
+    bench_slot(*path + i, "n");
+  }
+  (*path)[len - 1] = slot_target;
+  return type;
+}
+
+
+static long getter (const void *obj, const void *ctx) {
+  (void) ctx;
+  return (long) obj;
+}
+
+
+void bench_lookup (void) {
+  static const int widths[] = {4, 16, 64};
+  static const int depths[] = {1, 2, 4, 8};
+  static const int lens[] = {1, 2, 4, 8};
+
+  for (unsigned i = 0; i < arraysize(widths); i++) {
+    struct LookupArg arg = {.tags = make_wide(widths[i])};
+    arg.slot = slot_target;
+    bench_report("tag", "find", run_find, &arg,
+                 "\"width\": %d, \"hit\": true", widths[i]);
+    arg.slot = slot_missing;
+    bench_report("tag", "find", run_find, &arg,
+                 "\"width\": %d, \"hit\": false", widths[i]);
+    arg.slot = slot_target;
+    bench_report("tag", "resolve_width", run_resolve, &arg,
+                 "\"width\": %d", widths[i]);
+
+    struct CObjVTable *built = make_built(widths[i]);
+    arg.tags = built->type;
+    bench_report("tag", "find_built", run_find, &arg,
+                 "\"width\": %d", widths[i]);
+    CObjVTable_free(built);
+    CObjCache_clear();
+  }
+
+  for (unsigned i = 0; i < arraysize(depths); i++) {
+    struct LookupArg arg = {.tags = make_chain(depths[i], 4)};
+    arg.slot = slot_target;
+    bench_report("tag", "resolve_depth", run_resolve, &arg,
+                 "\"depth\": %d, \"hit\": true", depths[i]);
+    arg.slot = slot_missing;
+    bench_report("tag", "resolve_depth", run_resolve, &arg,
+                 "\"depth\": %d, \"hit\": false", depths[i]);
+    arg.slot = slot_target;
+    bench_report("tag", "get", run_get, &arg, "\"depth\": %d", depths[i]);
+
+    struct CObjVTable *vtable = CObjTagArray_finalize(arg.tags, NULL);
+    if (vtable != NULL) {
+      arg.vtable = vtable;
+      bench_report("tag", "vtable_resolve", run_vtable_resolve, &arg,
+                   "\"depth\": %d, \"hit\": true", depths[i]);
+      arg.slot = slot_missing;
+      bench_report("tag", "vtable_resolve", run_vtable_resolve, &arg,
+                   "\"depth\": %d, \"hit\": false", depths[i]);
+      CObjVTable_free(vtable);
+    }
+  }
+
+  for (unsigned i = 0; i < arraysize(lens); i++) {
+    for (int virtual_ = 0; virtual_ <= 1; virtual_++) {
+      struct LookupArg arg = {.tags = make_alias(lens[i], virtual_)};
+      bench_slot(&arg.slot, "a0");
+      bench_report("tag", "resolve_alias", run_resolve, &arg,
+                   "\"length\": %d, \"virtual\": %s", lens[i],
+                   virtual_ ? "true" : "false");
+    }
+  }
+
+  for (unsigned i = 0; i < arraysize(lens); i++) {
+    struct CObjSlot *path;
+    struct LookupArg arg = {.tags = make_nested(lens[i], &path)};
+    arg.path = path;
+    bench_report("tag", "resolves", run_resolves, &arg,
+                 "\"length\": %d", lens[i]);
+  }
+
+  {
+    struct CObjTag tags[] = {
+      {.name = "target", .func = (CObjFunc) getter, .type = COBJ_TYPE_FUNC},
+    };
+    struct LookupArg arg = {.tags = bench_tags(tags, 1), .slot = slot_target};
+    bench_report("tag", "get_func", run_get, &arg, "%s", "");
+  }
+}
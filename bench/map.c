@@ -0,0 +1,77 @@
+#include <stdlib.h>
+
+#include "include/cmap.h"
+#include "utils/macro.h"
+#include "bench.h"
+
+
+static const struct CObjTag Map[] = {
+  {.name = "key", .tags = Imm8Type, .type = COBJ_TYPE_TAGS},
+  {.name = "value", .tags = Imm8Type, .type = COBJ_TYPE_TAGS},
+  COBJ_TAG_END
+};
+
+
+struct MapArg {
+  struct CObjHashMap *map;
+  long len;
+};
+
+
+static void run_get (void *arg, long n) {
+  struct MapArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    // multiplicative scatter over hits and misses
+    long key = (i * 0x9e3779b1) % (a->len * 2);
+    bench_clobber();
+    bench_sink = CObjHashMap_get(a->map, &key) != NULL;
+  }
+}
+
+
+static void run_put (void *arg, long n) {
+  struct MapArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    long key = (i * 0x9e3779b1) % a->len;
+    bench_clobber();
+    bench_sink = CObjHashMap_put(a->map, &key, &i);
+  }
+}
+
+
+static void run_build (void *arg, long n) {
+  struct MapArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    struct CObjHashMap *map = CObjHashMap_new(Map, NULL);
+    should (map != NULL) otherwise {
+      abort();
+    }
+    for (long key = 0; key < a->len; key++) {
+      bench_sink = CObjHashMap_put(map, &key, &key);
+    }
+    CObjHashMap_free(map);
+  }
+}
+
+
+void bench_map (void) {
+  static const long lens[] = {16, 1024, 65536};
+
+  for (unsigned i = 0; i < arraysize(lens); i++) {
+    struct MapArg arg = {.map = CObjHashMap_new(Map, NULL), .len = lens[i]};
+    should (arg.map != NULL) otherwise {
+      abort();
+    }
+    for (long key = 0; key < arg.len; key++) {
+      should (CObjHashMap_put(arg.map, &key, &key) == 0) otherwise {
+        abort();
+      }
+    }
+
+    bench_report("map", "get", run_get, &arg, "\"len\": %ld", arg.len);
+    bench_report("map", "put", run_put, &arg, "\"len\": %ld", arg.len);
+    bench_report("map", "build", run_build, &arg, "\"len\": %ld", arg.len);
+
+    CObjHashMap_free(arg.map);
+  }
+}
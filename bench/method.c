@@ -0,0 +1,153 @@
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "include/cmethod.h"
+#include "utils/macro.h"
+#include "bench.h"
+
+
+enum {
+  KIND_NONE,
+  KIND_EQUAL,
+  KIND_OFTYPE,
+  KIND_SUBTYPE,
+  KIND_FUNC,
+};
+
+static const char * const kind_names[] = {
+  [KIND_NONE] = "none",
+  [KIND_EQUAL] = "equal",
+  [KIND_OFTYPE] = "oftype",
+  [KIND_SUBTYPE] = "subtype",
+  [KIND_FUNC] = "func",
+};
+
+static const struct CObjSlot path_1[] = {{.name = {1}}, {{0}}};
+static const struct CObjSlot path_1_k[] = {
+  {.name = {1}}, {.name = "kind"}, {{0}}};
+static const struct CObjSlot path_1_missing[] = {
+  {.name = {1}}, {.name = "missing"}, {{0}}};
+
+static const struct CObjTag Base[] = {{.name = "kind", .value = 1}, COBJ_TAG_END};
+static const struct CObjTag Other[] = {{.name = "kind", .value = 2}, COBJ_TAG_END};
+static const struct CObjTag Derived[] = {
+  {.name = "base", .tags = Base, .type = COBJ_TYPE_TAGS, .public_ = true},
+  COBJ_TAG_END
+};
+
+static const struct CObjSlot slot_method = {.name = "method"};
+
+
+static bool trait_test (
+    const struct CObjVariant *var1, const struct CObjVariant *var2,
+    const struct CObjTrait *traits, const struct CObjTag **types, int len) {
+  (void) var2;
+  (void) types;
+  (void) len;
+  return var1 != NULL && var1->value == (long) traits->userdata;
+}
+
+
+static int method_func (void) {
+  return 0;
+}
+
+
+// `candidates` methods, only the last one matches Derived
+static const struct CMethod *make_methods (int candidates, int kind) {
+  struct CMethod *methods = calloc(
+    1, sizeof(*methods) * (candidates + 1) +
+       sizeof(struct CObjTrait) * candidates * 2);
+  should (methods != NULL) otherwise {
+    abort();
+  }
+  struct CObjTrait *traits = (void *) (methods + candidates + 1);
+  for (int i = 0; i < candidates; i++) {
+    bool match = i == candidates - 1;
+    struct CObjTrait *trait = traits + i * 2;
+    switch (kind) {
+      case KIND_NONE:
+        trait->path = match ? path_1_k : path_1_missing;
+        break;
+      case KIND_EQUAL:
+        trait->path = path_1_k;
+        trait->value.value = match ? 1 : 2;
+        trait->cmp = COBJ_TRAIT_EQUAL;
+        break;
+      case KIND_OFTYPE:
+        trait->path = path_1_k;
+        trait->value.type = match ? COBJ_TYPE_UNDEFINED : COBJ_TYPE_FUNC;
+        trait->cmp = COBJ_TRAIT_OFTYPE;
+        break;
+      case KIND_SUBTYPE:
+        trait->path = path_1;
+        trait->value.tags = match ? Base : Other;
+        trait->value.type = COBJ_TYPE_TAGS;
+        trait->cmp = COBJ_TRAIT_SUBTYPE;
+        break;
+      case KIND_FUNC:
+        trait->path = path_1_k;
+        trait->cmp = COBJ_TRAIT_FUNC;
+        trait->func = trait_test;
+        trait->userdata = (void *) (long) (match ? 1 : 2);
+        break;
+    }
+    methods[i].func = (CObjFunc) method_func;
+    methods[i].traits = trait;
+  }
+  return methods;
+}
+
+
+struct MethodArg {
+  const struct CMethod *methods;
+  const struct CObjTag *types[1];
+  const struct CObjTag *type;
+};
+
+
+static void run_find (void *arg, long n) {
+  struct MethodArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    bench_clobber();
+    bench_sink = (long) CMethodArray_find(a->methods, a->types, 1);
+  }
+}
+
+
+static void run_context_init (void *arg, long n) {
+  struct MethodArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    struct CMethodContext context;
+    context.types = &a->type;
+    context.len = 1;
+    bench_clobber();
+    bench_sink = CMethodContext_init(&context, &slot_method);
+  }
+}
+
+
+void bench_method (void) {
+  static const int candidates[] = {1, 4, 16};
+
+  for (int kind = 0; kind < (int) arraysize(kind_names); kind++) {
+    for (unsigned i = 0; i < arraysize(candidates); i++) {
+      struct MethodArg arg = {
+        .methods = make_methods(candidates[i], kind), .types = {Derived}};
+      bench_report("method", "find", run_find, &arg,
+                   "\"candidates\": %d, \"trait\": \"%s\"",
+                   candidates[i], kind_names[kind]);
+
+      struct CObjTag tags[] = {
+        {.name = "base", .tags = Base, .type = COBJ_TYPE_TAGS,
+         .public_ = true},
+        {.name = "method", .methods = arg.methods,
+         .type = COBJ_TYPE_CMETHODS},
+      };
+      arg.type = bench_tags(tags, arraysize(tags));
+      bench_report("method", "context_init", run_context_init, &arg,
+                   "\"candidates\": %d, \"trait\": \"%s\"",
+                   candidates[i], kind_names[kind]);
+    }
+  }
+}
@@ -0,0 +1,329 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "include/ccache.h"
+#include "include/cmethod.h"
+#include "include/cpool.h"
+#include "utils/macro.h"
+#include "bench.h"
+
+
+/// iterations between checks of the stop flag
+#define SCALING_CHUNK 64
+/// throughput per thread relative to 1 thread below which scaling is flagged
+#define SCALING_MIN_EFFICIENCY 0.8
+/// length of arrays
+#define SCALING_ARRAY_LEN 256
+/// blocks live at once in allocation benchmarks
+#define SCALING_ALLOC_LEN 16
+/// size of blocks in allocation benchmarks
+#define SCALING_ALLOC_SIZE 64
+
+static const struct CObjSlot slot_target = {.name = "target"};
+static const struct CObjSlot slot_len = {.name = "len"};
+static const struct CObjSlot slot_init = {.name = "init"};
+
+
+/// Data shared read-only by all threads.
+struct ScalingShared {
+  /// chain of 4 tag sets, `target` defined in the deepest one
+  const struct CObjTag *chain;
+  /// array of Imm8
+  const struct CObjTag *types[2];
+  /// source array, terminated
+  void *src;
+};
+
+/// Data of a thread, on its own cache lines.
+struct ScalingArg {
+  const struct ScalingShared *shared;
+  struct CMethodContext context;
+  /// destination array
+  void *dst;
+  pthread_t thread;
+  /// iterations done
+  long ops;
+  /// time measured
+  long ns;
+} __attribute__((aligned(64)));
+
+/// Scalability benchmark.
+struct ScalingCase {
+  const char *group;
+  const char *name;
+  BenchFunc func;
+  /// slot to prepare ScalingArg::context with, if any
+  const struct CObjSlot *slot;
+  int len;
+};
+
+/// State of a measurement.
+struct ScalingRun {
+  const struct ScalingCase *bench;
+  pthread_barrier_t start;
+  bool stop;
+};
+
+struct ScalingThread {
+  struct ScalingRun *run;
+  struct ScalingArg *arg;
+};
+
+
+static void run_resolve (void *arg, long n) {
+  const struct ScalingArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    const struct CObjTag *target;
+    int offset;
+    bench_clobber();
+    bench_sink = (long) CObjTagArray_resolve(
+      a->shared->chain, &slot_target, &target, &offset);
+  }
+}
+
+
+static void run_get (void *arg, long n) {
+  const struct ScalingArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    bench_clobber();
+    bench_sink = CObjTagArray_get0(a->shared->chain, &slot_target, a);
+  }
+}
+
+
+static void run_dispatch (void *arg, long n) {
+  const struct ScalingArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    struct CMethodContext context;
+    context.types = (const struct CObjTag **) a->shared->types;
+    context.len = 2;
+    context.msg = NULL;
+    bench_clobber();
+    bench_sink = CMethodContext_init(&context, &slot_init);
+  }
+}
+
+
+static void run_len (void *arg, long n) {
+  const struct ScalingArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    bench_clobber();
+    bench_sink = ((int (*) ()) a->context.func)(a->shared->src, &a->context);
+  }
+}
+
+
+static void run_init (void *arg, long n) {
+  const struct ScalingArg *a = arg;
+  for (long i = 0; i < n; i++) {
+    bench_clobber();
+    bench_sink = ((int (*) ()) a->context.func)(
+      a->dst, a->shared->src, &a->context);
+  }
+}
+
+
+// allocate a few blocks, then free them in allocation order
+static void run_malloc (void *arg, long n) {
+  (void) arg;
+  for (long i = 0; i < n; i++) {
+    void *blocks[SCALING_ALLOC_LEN];
+    for (int j = 0; j < SCALING_ALLOC_LEN; j++) {
+      blocks[j] = malloc(SCALING_ALLOC_SIZE);
+    }
+    bench_clobber();
+    for (int j = 0; j < SCALING_ALLOC_LEN; j++) {
+      free(blocks[j]);
+    }
+  }
+}
+
+
+static void run_pool (void *arg, long n) {
+  (void) arg;
+  for (long i = 0; i < n; i++) {
+    void *blocks[SCALING_ALLOC_LEN];
+    for (int j = 0; j < SCALING_ALLOC_LEN; j++) {
+      blocks[j] = CObjPool_malloc(SCALING_ALLOC_SIZE);
+    }
+    bench_clobber();
+    for (int j = 0; j < SCALING_ALLOC_LEN; j++) {
+      CObjPool_free(blocks[j]);
+    }
+  }
+}
+
+
+static const struct ScalingCase cases[] = {
+  {"tag", "resolve", run_resolve},
+  {"tag", "get", run_get},
+  {"method", "dispatch", run_dispatch},
+  {"array", "len", run_len, &slot_len, 1},
+  {"array", "init", run_init, &slot_init, 2},
+  {"alloc", "malloc", run_malloc},
+  {"alloc", "pool", run_pool},
+};
+
+
+static void *ScalingThread_main (void *data) {
+  struct ScalingThread *self = data;
+  struct ScalingRun *run = self->run;
+  struct ScalingArg *arg = self->arg;
+
+  pthread_barrier_wait(&run->start);
+  long start = bench_now_ns();
+  long ops = 0;
+  while (!__atomic_load_n(&run->stop, __ATOMIC_RELAXED)) {
+    run->bench->func(arg, SCALING_CHUNK);
+    ops += SCALING_CHUNK;
+  }
+  arg->ns = bench_now_ns() - start;
+  arg->ops = ops;
+  return NULL;
+}
+
+
+// total iterations per second of threads running the benchmark concurrently
+static double ScalingRun_measure (
+    struct ScalingRun *self, struct ScalingArg *args, int threads,
+    long time_ns) {
+  struct ScalingThread data[threads];
+  pthread_barrier_init(&self->start, NULL, threads + 1);
+  self->stop = false;
+  for (int i = 0; i < threads; i++) {
+    data[i] = (struct ScalingThread) {.run = self, .arg = args + i};
+    should (pthread_create(
+        &args[i].thread, NULL, ScalingThread_main, data + i) == 0) otherwise {
+      perror("pthread_create");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  pthread_barrier_wait(&self->start);
+  struct timespec ts = {
+    .tv_sec = time_ns / 1000000000, .tv_nsec = time_ns % 1000000000};
+  nanosleep(&ts, NULL);
+  __atomic_store_n(&self->stop, true, __ATOMIC_RELAXED);
+
+  double ret = 0;
+  for (int i = 0; i < threads; i++) {
+    pthread_join(args[i].thread, NULL);
+    ret += args[i].ops * 1e9 / args[i].ns;
+  }
+  pthread_barrier_destroy(&self->start);
+  return ret;
+}
+
+
+int bench_scaling (int threads, long time_ns) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (threads <= 0) {
+    threads = cpus > 0 ? cpus : 1;
+  }
+
+  static const struct CObjTag Array[] = {
+    {.name = "super", .tags = Imm8Type, .type = COBJ_TYPE_TAGS},
+    COBJ_TAG_ARRAY_LEN,
+    COBJ_TAG_ARRAY_INIT,
+    COBJ_TAG_END
+  };
+  struct ScalingShared shared = {
+    .types = {Array, Array},
+    .src = malloc(8 * (SCALING_ARRAY_LEN + 1)),
+  };
+  should (shared.src != NULL) otherwise {
+    perror("malloc");
+    exit(EXIT_FAILURE);
+  }
+  memset(shared.src, 0x5a, 8 * SCALING_ARRAY_LEN);
+  memset((char *) shared.src + 8 * SCALING_ARRAY_LEN, 0, 8);
+
+  shared.chain = bench_tags(
+    (struct CObjTag []) {{.name = "target", .value = 42}}, 1);
+  for (int i = 1; i < 4; i++) {
+    struct CObjTag tags[] = {
+      {.name = "base", .tags = shared.chain, .type = COBJ_TYPE_TAGS,
+       .public_ = true, .offset = 8},
+      {.name = "x", .value = i},
+    };
+    shared.chain = bench_tags(tags, arraysize(tags));
+  }
+
+  struct ScalingArg *args = aligned_alloc(64, sizeof(*args) * threads);
+  should (args != NULL) otherwise {
+    perror("aligned_alloc");
+    exit(EXIT_FAILURE);
+  }
+  for (int i = 0; i < threads; i++) {
+    args[i] = (struct ScalingArg) {
+      .shared = &shared, .dst = malloc(8 * (SCALING_ARRAY_LEN + 1))};
+    should (args[i].dst != NULL) otherwise {
+      perror("malloc");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  int flagged = 0;
+  for (unsigned i = 0; i < arraysize(cases); i++) {
+    const struct ScalingCase *bench = cases + i;
+    continue_if (!bench_selected(bench->group, bench->name));
+
+    for (int cached = 1; cached >= 0; cached--) {
+      bool old = CObjCache_enable(cached);
+      CObjCache_clear();
+      for (int j = 0; j < threads; j++) {
+        struct CMethodContext *context = &args[j].context;
+        context->types = shared.types;
+        context->len = bench->len;
+        context->msg = NULL;
+        should (bench->slot == NULL ||
+                CMethodContext_init(context, bench->slot) == 0) otherwise {
+          abort();
+        }
+      }
+
+      struct ScalingRun run = {.bench = bench};
+      double base = 0;
+      // 1, 2, 4, ..., and threads itself
+      for (int n = 1; ; n = min(n * 2, threads)) {
+        double throughput = ScalingRun_measure(&run, args, n, time_ns);
+        if (n == 1) {
+          base = throughput;
+        }
+        double efficiency = throughput / (base * n);
+        // oversubscribed CPUs cannot scale
+        bool linear = n > cpus || efficiency >= SCALING_MIN_EFFICIENCY;
+        if (!linear) {
+          flagged++;
+          fprintf(stderr, "%s/%s (cache %s): %d threads at %.0f%% of linear\n",
+                  bench->group, bench->name, cached ? "on" : "off", n,
+                  efficiency * 100);
+        }
+
+        bench_result_begin();
+        printf("{\"group\": \"%s\", \"name\": \"%s\", "
+               "\"params\": {\"threads\": %d}, \"cache\": %s, "
+               "\"ops_per_sec\": %.0f, \"ops_per_sec_per_thread\": %.0f, "
+               "\"efficiency\": %.3f, \"linear\": %s}",
+               bench->group, bench->name, n, cached ? "true" : "false",
+               throughput, throughput / n, efficiency,
+               linear ? "true" : "false");
+        fflush(stdout);
+        break_if (n == threads);
+      }
+      CObjCache_enable(old);
+    }
+  }
+
+  for (int i = 0; i < threads; i++) {
+    free(args[i].dst);
+  }
+  free(args);
+  free(shared.src);
+  return flagged;
+}
@@ -0,0 +1,157 @@
+#ifndef CBUILDER_H
+#define CBUILDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+#include <stddef.h>
+
+#include "cobj.h"
+#include "cvtable.h"
+
+/**
+ * @file
+ * Builder of tag sets at runtime.
+ *
+ * Tags are checked as they are added. CObjTypeBuilder_finalize() validates the
+ * whole tag set, and lays it out in a single cache-line-aligned allocation
+ * together with copies of alias paths and the slot table of the finalized
+ * type. Tags are ordered by expected hits, so that the hottest tags share the
+ * first cache lines; public tag sets keep the order they were added in, which
+ * decides overrides.
+ */
+
+
+/// Builder of a tag set, opaque.
+struct CObjTypeBuilder;
+
+
+__attribute__((warn_unused_result, access(read_only, 1)))
+/**
+ * @memberof CObjTypeBuilder
+ * @brief Create an empty builder.
+ *
+ * @param allocator Memory allocator of the builder and the built tag set, can
+ *  be @c NULL.
+ * @return Builder, or @c NULL on error with @c errno set.
+ */
+COBJ_API struct CObjTypeBuilder *CObjTypeBuilder_new (
+  const struct CObjAllocator *allocator);
+/**
+ * @memberof CObjTypeBuilder
+ * @brief Free a builder. Finalized tag sets are not affected.
+ *
+ * @param self Builder, can be @c NULL.
+ */
+COBJ_API void CObjTypeBuilder_free (struct CObjTypeBuilder *self);
+__attribute__((warn_unused_result, nonnull, access(read_only, 2)))
+/**
+ * @memberof CObjTypeBuilder
+ * @brief Add a field holding a plain value, such as `size`.
+ *
+ * @param self Builder.
+ * @param slot Slot name.
+ * @param value Value; must be positive for `size`.
+ * @param hits Expected relative access frequency.
+ * @return 0 on success, -1 on error with @c errno set (@c EINVAL if the
+ *  arguments are invalid, @c EEXIST if the slot is already added).
+ */
+COBJ_API int CObjTypeBuilder_add_field (
+  struct CObjTypeBuilder *self, const struct CObjSlot *slot, long value,
+  unsigned hits);
+__attribute__((warn_unused_result, nonnull, access(read_only, 2)))
+/**
+ * @memberof CObjTypeBuilder
+ * @brief Add a field computed from the object by a getter, see
+ *  CObjTagArray_get().
+ *
+ * @param self Builder.
+ * @param slot Slot name.
+ * @param func Getter.
+ * @param hits Expected relative access frequency.
+ * @return 0 on success, -1 on error with @c errno set.
+ */
+COBJ_API int CObjTypeBuilder_add_getter (
+  struct CObjTypeBuilder *self, const struct CObjSlot *slot, CObjFunc func,
+  unsigned hits);
+__attribute__((warn_unused_result, nonnull, access(read_only, 2),
+               access(read_only, 3)))
+/**
+ * @memberof CObjTypeBuilder
+ * @brief Add a method.
+ *
+ * @param self Builder.
+ * @param slot Slot name.
+ * @param methods Method implementations, which must stay alive while the
+ *  built tag set is in use.
+ * @param hits Expected relative access frequency.
+ * @return 0 on success, -1 on error with @c errno set.
+ */
+COBJ_API int CObjTypeBuilder_add_method (
+  struct CObjTypeBuilder *self, const struct CObjSlot *slot,
+  const struct CMethod *methods, unsigned hits);
+__attribute__((warn_unused_result, nonnull, access(read_only, 2),
+               access(read_only, 3)))
+/**
+ * @memberof CObjTypeBuilder
+ * @brief Add a public tag set, whose slots are inherited.
+ *
+ * @param self Builder.
+ * @param slot Slot name.
+ * @param super Tag set, which must stay alive while the built tag set is in
+ *  use.
+ * @param offset Offset of the structure of @p super in the structure of the
+ *  built tag set.
+ * @param hits Expected relative access frequency.
+ * @return 0 on success, -1 on error with @c errno set.
+ */
+COBJ_API int CObjTypeBuilder_add_super (
+  struct CObjTypeBuilder *self, const struct CObjSlot *slot,
+  const struct CObjTag *super, size_t offset, unsigned hits);
+__attribute__((warn_unused_result, nonnull, access(read_only, 2),
+               access(read_only, 3)))
+/**
+ * @memberof CObjTypeBuilder
+ * @brief Add an alias.
+ *
+ * @param self Builder.
+ * @param slot Slot name.
+ * @param path Slot path, terminated by an empty slot. It is copied.
+ * @param virtual_ Whether to resolve the path from the top tag set.
+ * @param hits Expected relative access frequency.
+ * @return 0 on success, -1 on error with @c errno set (@c ELOOP if the alias
+ *  points to itself).
+ */
+COBJ_API int CObjTypeBuilder_add_alias (
+  struct CObjTypeBuilder *self, const struct CObjSlot *slot,
+  const struct CObjSlot *path, bool virtual_, unsigned hits);
+__attribute__((warn_unused_result, nonnull(1), access(read_only, 1),
+               access(write_only, 2, 3)))
+/**
+ * @memberof CObjTypeBuilder
+ * @brief Build the tag set and its slot table.
+ *
+ * The built tag set is CObjVTable::type of the returned table, and is marked
+ * as validated. It is freed together with the table by CObjVTable_free(),
+ * after which CObjCache_clear() must be called. The builder can be reused.
+ *
+ * @param self Builder.
+ * @param[out] errors Found defects, see CObjTagArray_validate(). Defects of
+ *  the built tag set itself have CObjTagError::tags set to @c NULL, and
+ *  CObjTagError::tag pointing into the builder. Can be @c NULL if @p n is 0.
+ * @param n Capacity of @p errors.
+ * @return Slot table, or @c NULL on error with @c errno set (@c EINVAL if
+ *  defects are found).
+ */
+COBJ_API struct CObjVTable *CObjTypeBuilder_finalize (
+  const struct CObjTypeBuilder *self, struct CObjTagError *errors, int n);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CBUILDER_H */
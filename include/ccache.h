@@ -0,0 +1,73 @@
+#ifndef CCACHE_H
+#define CCACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+#include "cobj.h"
+
+/**
+ * @file
+ * Functions for controlling lookup caches and their snapshots.
+ *
+ * Results of CObjTagArray_resolve() and CMethodArray_find() are cached
+ * process-wide, keyed by the addresses of tag sets and method arrays. Tag sets
+ * are assumed to be immutable; if a tag set built at runtime is modified or
+ * freed, CObjCache_clear() must be called.
+ *
+ * Each tag set resolved also gets bloom filters of its own and inherited
+ * slots, cached alongside, with which most misses are answered without
+ * scanning the tag sets. They are dropped together with the caches.
+ */
+
+
+/**
+ * @brief Enable or disable lookup caches. Caches are enabled by default.
+ *
+ * @param enable Whether to enable caches.
+ * @return Previous state.
+ */
+COBJ_API bool CObjCache_enable (bool enable);
+/**
+ * @brief Drop all cached lookups, and forget which tag sets passed
+ *  CObjTagArray_validate().
+ */
+COBJ_API void CObjCache_clear (void);
+
+__attribute__((nonnull))
+/**
+ * @brief Dump cached lookups to a snapshot file.
+ *
+ * Only lookups whose tag sets, tag data and method descriptors live in a loaded
+ * module (executable or shared object) with a GNU build ID are dumped. They are
+ * recorded as offsets relative to the module, keyed by its build ID, so that
+ * the snapshot stays valid across restarts and address space randomization,
+ * until the module is rebuilt.
+ *
+ * @param path File path.
+ * @return Number of dumped entries, or -1 on error, with @c errno set.
+ */
+COBJ_API int CObjCache_save (const char *path);
+__attribute__((nonnull))
+/**
+ * @brief Prefill lookup caches from a snapshot file created by
+ *  CObjCache_save().
+ *
+ * Entries referring to modules that are not loaded, or whose build IDs have
+ * changed, are ignored. Nothing is loaded while caches are disabled.
+ *
+ * @param path File path.
+ * @return Number of entries stored into the caches, or -1 on error, with
+ *  @c errno set.
+ */
+COBJ_API int CObjCache_load (const char *path);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CCACHE_H */
@@ -0,0 +1,130 @@
+#ifndef CEXEC_H
+#define CEXEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "cmethod.h"
+
+/**
+ * @file
+ * Work-stealing executor for deferred method invocations.
+ *
+ * A task is a method context prepared with CMethodContext_init() plus its
+ * arguments. Tasks are submitted to a task group and run by the worker threads
+ * of an executor. Each worker owns a deque: it runs its own tasks newest
+ * first, and steals the oldest tasks of other workers when it runs out.
+ * Threads waiting for a group run queued tasks while they wait, so tasks can
+ * submit and wait for nested groups.
+ */
+
+
+/// Executor, opaque.
+struct CObjExecutor;
+/// Group of tasks waited for together, opaque.
+struct CObjTaskGroup;
+
+/// Deferred method invocation.
+struct CObjTask {
+  /// prepared method context; CMethodContext::len arguments are passed, and
+  ///  CMethodContext::types and CMethodContext::msg must stay valid until the
+  ///  task is run
+  struct CMethodContext context;
+  /// first argument
+  void *self;
+  /// second argument, if CMethodContext::len is 2
+  void *other;
+  /// where to store the status returned by the method, or @c NULL if the
+  ///  method returns nothing (such as `destroy`)
+  int *status;
+};
+
+
+__attribute__((warn_unused_result))
+/**
+ * @memberof CObjExecutor
+ * @brief Create an executor and start its worker threads.
+ *
+ * @param threads Number of worker threads, or 0 for the number of online CPUs.
+ * @return Executor, or @c NULL on error with @c errno set.
+ */
+COBJ_API struct CObjExecutor *CObjExecutor_new (int threads);
+/**
+ * @memberof CObjExecutor
+ * @brief Run all queued tasks, stop the worker threads and free the executor.
+ *
+ * All task groups of the executor must be freed first.
+ *
+ * @param self Executor, can be @c NULL.
+ */
+COBJ_API void CObjExecutor_free (struct CObjExecutor *self);
+__attribute__((pure, warn_unused_result, nonnull, access(read_only, 1)))
+/**
+ * @memberof CObjExecutor
+ * @brief Get the number of worker threads.
+ *
+ * @param self Executor.
+ * @return Number of worker threads.
+ */
+COBJ_API int CObjExecutor_threads (const struct CObjExecutor *self);
+
+__attribute__((warn_unused_result, nonnull))
+/**
+ * @memberof CObjTaskGroup
+ * @brief Create an empty task group.
+ *
+ * @param executor Executor to run the tasks.
+ * @return Task group, or @c NULL on error with @c errno set.
+ */
+COBJ_API struct CObjTaskGroup *CObjTaskGroup_new (
+  struct CObjExecutor *executor);
+/**
+ * @memberof CObjTaskGroup
+ * @brief Wait for all tasks of the group and free it.
+ *
+ * @param self Task group, can be @c NULL.
+ */
+COBJ_API void CObjTaskGroup_free (struct CObjTaskGroup *self);
+__attribute__((warn_unused_result, nonnull, access(read_only, 2, 3)))
+/**
+ * @memberof CObjTaskGroup
+ * @brief Submit tasks.
+ *
+ * Tasks are copied. Tasks submitted from outside the executor are spread over
+ * all workers; tasks submitted by a running task are queued to its worker, to
+ * be stolen by idle ones.
+ *
+ * A group can only be submitted to while no thread waits for it, or by its own
+ * running tasks.
+ *
+ * @param self Task group.
+ * @param tasks Tasks.
+ * @param len Number of tasks.
+ * @return 0 on success, -1 if out of memory, in which case no task is
+ *  submitted.
+ */
+COBJ_API int CObjTaskGroup_submit (
+  struct CObjTaskGroup *self, const struct CObjTask *tasks, size_t len);
+__attribute__((nonnull(1), access(write_only, 2)))
+/**
+ * @memberof CObjTaskGroup
+ * @brief Wait for all submitted tasks, running queued tasks meanwhile.
+ *
+ * Failures are counted and cleared, and the group can be submitted to again.
+ *
+ * @param self Task group.
+ * @param[out] error First nonzero status returned by a task, or 0. Can be
+ *  @c NULL.
+ * @return Number of tasks that returned a nonzero status.
+ */
+COBJ_API size_t CObjTaskGroup_wait (struct CObjTaskGroup *self, int *error);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CEXEC_H */
@@ -0,0 +1,64 @@
+#ifndef CGEN_H
+#define CGEN_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#include "cobj.h"
+
+/**
+ * @file
+ * Helpers for code generated by `cobj-gen`.
+ *
+ * `cobj-gen` reads finalized tag sets and emits, for each type, inline
+ * functions which resolve slots with a perfect hash and a `switch`. When the
+ * slot is a compile-time constant, the compiler folds the lookup away.
+ */
+
+
+__attribute__((pure, warn_unused_result, nonnull, access(read_only, 1)))
+/**
+ * @memberof CObjSlot
+ * @brief Calculate seeded hash value of slot, as used by generated lookups.
+ *
+ * @param self Slot.
+ * @param seed Seed.
+ * @return Hash value.
+ */
+static inline uint64_t CObjGen_hash (
+    const struct CObjSlot *self, uint64_t seed) {
+  uint64_t a;
+  uint64_t b;
+  memcpy(&a, self, sizeof(a));
+  memcpy(&b, (const char *) self + sizeof(a), sizeof(b));
+  uint64_t h = ((a ^ seed) * 0x9e3779b97f4a7c15) ^ b;
+  h *= 0xbf58476d1ce4e5b9;
+  return h ^ (h >> 32);
+}
+__attribute__((pure, warn_unused_result, nonnull,
+               access(read_only, 1), access(read_only, 2)))
+/**
+ * @memberof CObjSlot
+ * @brief Test if two slots are equal.
+ *
+ * @param self Slot.
+ * @param other Slot.
+ * @return @c true if equal.
+ */
+static inline bool CObjGen_match (
+    const struct CObjSlot *self, const struct CObjSlot *other) {
+  return memcmp(self, other, sizeof(*self)) == 0;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CGEN_H */
@@ -0,0 +1,71 @@
+#ifndef CHUGE_H
+#define CHUGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "cobj.h"
+
+/**
+ * @file
+ * Allocator of large blocks mapped directly from the system.
+ *
+ * Each block is an anonymous mapping of its own, which transparent huge pages
+ * are requested for. Growing a block remaps it, so that its pages are moved
+ * rather than copied; shrinking it gives the pages of the tail back to the
+ * system while keeping the mapping, so that it can grow again in place.
+ *
+ * Vectors of types without an `allocator` property switch to this allocator
+ * once their buffer reaches the `huge_threshold` property of their type, or
+ * #COBJ_HUGE_THRESHOLD if there is none.
+ */
+
+
+#ifndef COBJ_HUGE_THRESHOLD
+/// default size in bytes from which vector buffers are mapped directly
+#define COBJ_HUGE_THRESHOLD (32 * 1024 * 1024)
+#endif
+
+/// tag initializer of `huge_threshold = n`; 0 never maps buffers directly
+#define COBJ_TAG_HUGE_THRESHOLD(n) {.name = "huge_threshold", .value = n}
+
+
+/// Huge-page allocator, usable as the `allocator` slot.
+COBJ_API extern const struct CObjAllocator CObjHuge_allocator;
+
+
+__attribute__((malloc, warn_unused_result, alloc_size(1)))
+/**
+ * @brief Map a block.
+ *
+ * @param size Memory size.
+ * @return Allocated memory, aligned to 64 bytes, or @c NULL on error with
+ *  @c errno set.
+ */
+COBJ_API void *CObjHuge_malloc (size_t size);
+__attribute__((warn_unused_result, alloc_size(2)))
+/**
+ * @brief Resize a block, moving its pages if it has to be relocated.
+ *
+ * @param ptr Memory allocated by CObjHuge_malloc(), can be @c NULL.
+ * @param size New memory size.
+ * @return Re-allocated memory, or @c NULL on error with @c errno set, in
+ *  which case @p ptr is untouched.
+ */
+COBJ_API void *CObjHuge_realloc (void *ptr, size_t size);
+/**
+ * @brief Unmap a block.
+ *
+ * @param ptr Memory allocated by CObjHuge_malloc(), can be @c NULL.
+ */
+COBJ_API void CObjHuge_free (void *ptr);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CHUGE_H */
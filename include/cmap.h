@@ -0,0 +1,134 @@
+#ifndef CMAP_H
+#define CMAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+#include "cmethod.h"
+
+/**
+ * @file
+ * Open-addressing hash map driven by key and value type methods.
+ *
+ * A map type has its key type in `key`, optionally its value type in `value`
+ * (without it the map is a set), and optionally an `allocator` property. The
+ * `hash` and `equal` methods of the key type, and the `init` and `destroy`
+ * methods of both types, are resolved once when the map is created.
+ *
+ * Keys without a `hash` method are hashed bytewise, and keys without an
+ * `equal` method are compared with `memcmp`. Elements without a copyer are
+ * copied with `memcpy`. Entries are relocated bitwise when the map grows.
+ *
+ * Entries are stored SwissTable-style: a control byte per entry holds 7 bits
+ * of the hash, and a group of control bytes is probed at once with SSE2, or
+ * 8 bytes at a time elsewhere.
+ */
+
+
+/// Hash map, opaque.
+struct CObjHashMap;
+
+
+__attribute__((warn_unused_result, nonnull(1), access(read_only, 1)))
+/**
+ * @memberof CObjHashMap
+ * @brief Create an empty hash map.
+ *
+ * @param type Map type.
+ * @param msg Auxiliary data array, passed to the element methods. Must stay
+ *  alive while the map is in use.
+ * @return Hash map, or @c NULL on error with @c errno set (@c EINVAL if
+ *  @p type invalid).
+ */
+COBJ_API struct CObjHashMap *CObjHashMap_new (
+  const struct CObjTag *type, struct CObjMsg *msg);
+/**
+ * @memberof CObjHashMap
+ * @brief Destroy all entries and free the hash map.
+ *
+ * @param self Hash map, can be @c NULL.
+ */
+COBJ_API void CObjHashMap_free (struct CObjHashMap *self);
+__attribute__((pure, warn_unused_result, nonnull, access(read_only, 1)))
+/**
+ * @memberof CObjHashMap
+ * @brief Get the number of entries.
+ *
+ * @param self Hash map.
+ * @return Number of entries.
+ */
+COBJ_API size_t CObjHashMap_len (const struct CObjHashMap *self);
+__attribute__((warn_unused_result, nonnull))
+/**
+ * @memberof CObjHashMap
+ * @brief Make room for @p n entries without rehashing.
+ *
+ * @param self Hash map.
+ * @param n Number of entries.
+ * @return 0 on success, -1 if out of memory.
+ */
+COBJ_API int CObjHashMap_reserve (struct CObjHashMap *self, size_t n);
+__attribute__((warn_unused_result, nonnull, access(read_only, 2)))
+/**
+ * @memberof CObjHashMap
+ * @brief Look up a key.
+ *
+ * @param self Hash map.
+ * @param key Key.
+ * @return Value of the entry (the stored key if the map is a set), or @c NULL
+ *  if not found.
+ */
+COBJ_API void *CObjHashMap_get (
+  const struct CObjHashMap *self, const void *key);
+__attribute__((warn_unused_result, nonnull(1, 2), access(read_only, 2),
+               access(read_only, 3)))
+/**
+ * @memberof CObjHashMap
+ * @brief Insert a copy of an entry, or replace the value of an existing entry.
+ *
+ * @param self Hash map.
+ * @param key Key.
+ * @param value Value, ignored if the map is a set.
+ * @return 0 on success, -1 if out of memory, or the return value of the
+ *  copyer; on copyer error a new entry is not inserted, and an existing entry
+ *  keeps its value.
+ */
+COBJ_API int CObjHashMap_put (
+  struct CObjHashMap *self, const void *key, const void *value);
+__attribute__((nonnull, access(read_only, 2)))
+/**
+ * @memberof CObjHashMap
+ * @brief Remove and destroy an entry.
+ *
+ * @param self Hash map.
+ * @param key Key.
+ * @return @c true if the entry existed.
+ */
+COBJ_API bool CObjHashMap_remove (struct CObjHashMap *self, const void *key);
+__attribute__((warn_unused_result, nonnull(1, 2), access(read_write, 2),
+               access(write_only, 3), access(write_only, 4)))
+/**
+ * @memberof CObjHashMap
+ * @brief Iterate over entries, in no particular order.
+ *
+ * The map must not be modified during iteration.
+ *
+ * @param self Hash map.
+ * @param[in,out] iter Iterator, initialized to 0.
+ * @param[out] key Key, can be @c NULL.
+ * @param[out] value Value, can be @c NULL.
+ * @return @c true if an entry is returned, @c false if the iteration is done.
+ */
+COBJ_API bool CObjHashMap_next (
+  const struct CObjHashMap *self, size_t *iter, const void **key,
+  void **value);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CMAP_H */
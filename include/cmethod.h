@@ -91,7 +91,7 @@ __attribute__((
  * @param[out] var2 Matched tag data.
  * @return @c true if matches.
  */
-COBJ_API bool CObjTrait_match2 (
+COBJ_CORE bool CObjTrait_match2 (
   const struct CObjTrait *self, const struct CObjTag **types, int len,
   struct CObjVariant *var1, struct CObjVariant *var2);
 __attribute__((pure, warn_unused_result, nonnull, access(read_only, 1),
@@ -105,7 +105,7 @@ __attribute__((pure, warn_unused_result, nonnull, access(read_only, 1),
  * @param len Length of @p types.
  * @return @c true if matches.
  */
-COBJ_API bool CObjTrait_match (
+COBJ_CORE bool CObjTrait_match (
   const struct CObjTrait *self, const struct CObjTag **types, int len);
 
 /// CObj method.
@@ -114,7 +114,7 @@ struct CMethod {
   CObjFunc func;
   /// user data
   void *userdata;
-  /// traits required for calling the method
+  /// traits required for calling the method, or @c NULL if none
   const struct CObjTrait *traits;
 };
 
@@ -129,7 +129,7 @@ __attribute__((pure, warn_unused_result, nonnull,
  * @param len Length of @p types.
  * @return Method descriptor, or @c NULL if not found.
  */
-COBJ_API const struct CMethod *CMethodArray_find (
+COBJ_CORE const struct CMethod *CMethodArray_find (
   const struct CMethod *self, const struct CObjTag **types, int len);
 __attribute__((pure, warn_unused_result, nonnull, sentinel(2),
                access(read_only, 1)))
@@ -141,7 +141,7 @@ __attribute__((pure, warn_unused_result, nonnull, sentinel(2),
  * @param ... Type objects, terminated by @c NULL.
  * @return Method descriptor, or @c NULL if not found.
  */
-COBJ_API const struct CMethod *CMethodArray_finds (
+COBJ_CORE const struct CMethod *CMethodArray_finds (
   const struct CMethod *self, ...);
 
 /// Context for calling CMethod.
@@ -179,7 +179,7 @@ __attribute__((nonnull))
  * @return 0 on success, 1 if no suitable method found, 255 if @p self->types
  *  or @p self->len invalid.
  */
-COBJ_API int CMethodContext_init (
+COBJ_CORE int CMethodContext_init (
   struct CMethodContext *self, const struct CObjSlot *slot);
 __attribute__((pure, warn_unused_result, nonnull, access(read_only, 1)))
 /**
@@ -192,9 +192,187 @@ __attribute__((pure, warn_unused_result, nonnull, access(read_only, 1)))
 COBJ_API const struct CObjTag *CMethodContext_super (
   const struct CMethodContext *self);
 
+/**
+ * @name Standard element methods
+ * Signatures of the standard methods of element types. #Imm1Type to
+ *  #Imm16Type implement all of them; the array methods run SIMD kernels chosen
+ *  for the CPU at runtime.
+ * @{
+ */
+/// `equal`: test if two elements are equal
+typedef bool (*CObjEqualFunc) (
+  const void *self, const void *other, const struct CMethodContext *ctx);
+/// `compare`: compare two elements, returning <0, 0 or >0
+typedef int (*CObjCompareFunc) (
+  const void *self, const void *other, const struct CMethodContext *ctx);
+/// `hash`: hash an element
+typedef uint64_t (*CObjHashFunc) (
+  const void *self, const struct CMethodContext *ctx);
+/// `find`: index of the first of @p len elements equal to @p value, or -1
+typedef ptrdiff_t (*CObjFindFunc) (
+  const void *data, size_t len, const void *value,
+  const struct CMethodContext *ctx);
+/// `fill`: set @p len elements to @p value
+typedef void (*CObjFillFunc) (
+  void *data, size_t len, const void *value,
+  const struct CMethodContext *ctx);
+/// `array_equal`: test if two arrays of @p len elements are equal
+typedef bool (*CObjArrayEqualFunc) (
+  const void *self, const void *other, size_t len,
+  const struct CMethodContext *ctx);
+/// `array_hash`: hash an array of @p len elements
+typedef uint64_t (*CObjArrayHashFunc) (
+  const void *data, size_t len, const struct CMethodContext *ctx);
+/** @} */
+
+/**
+ * @name Deep traversal
+ * Pointer types (#COBJ_TAG_POINTER_INIT or #COBJ_TAG_POINTER_DESTROY) and
+ *  array types (#COBJ_TAG_ARRAY_INIT or #COBJ_TAG_ARRAY_DESTROY) are walked
+ *  through their `super` with an explicit work stack, so that nesting depth is
+ *  bounded by memory, not by the C stack. Other types are leaves, handled by
+ *  their own `init`, `destroy` and `deep_size` methods.
+ * @{
+ */
+/// `deep_size`: bytes of memory owned by an object, excluding itself, or -1
+///  on error
+typedef long (*CObjDeepSizeFunc) (
+  const void *self, const struct CMethodContext *ctx);
+
+__attribute__((warn_unused_result, nonnull(1, 2), access(read_only, 2)))
+/**
+ * @brief Deep copy an object.
+ *
+ * On failure, nothing is left allocated.
+ *
+ * @param self Object to initialize.
+ * @param other Object to copy.
+ * @param type Type.
+ * @param msg Auxiliary data array, passed to the methods of leaves.
+ * @return 0 on success, -1 if out of memory, 255 if @p type invalid, or the
+ *  return value of the copyer of a leaf.
+ */
+COBJ_API int CObjDeep_copy (
+  void *self, const void *other, const struct CObjTag *type,
+  struct CObjMsg *msg);
+__attribute__((nonnull(1)))
+/**
+ * @brief Deep destroy an object.
+ *
+ * @param self Object.
+ * @param type Type.
+ * @param msg Auxiliary data array, passed to the methods of leaves.
+ */
+COBJ_API void CObjDeep_destroy (
+  void *self, const struct CObjTag *type, struct CObjMsg *msg);
+__attribute__((warn_unused_result, nonnull(1), access(read_only, 1)))
+/**
+ * @brief Count the memory owned by an object: pointees of pointers, plus
+ *  what `deep_size` methods of leaves report.
+ *
+ * @param self Object.
+ * @param type Type.
+ * @param msg Auxiliary data array, passed to the methods of leaves.
+ * @return Number of bytes, excluding @p self itself, or -1 on error.
+ */
+COBJ_API long CObjDeep_size (
+  const void *self, const struct CObjTag *type, struct CObjMsg *msg);
+/** @} */
+
 COBJ_API extern const struct CMethod PointerType_init[];
 #define COBJ_TAG_POINTER_INIT { \
   .name = "init", .methods = PointerType_init, .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod PointerType_destroy[];
+#define COBJ_TAG_POINTER_DESTROY { \
+  .name = "destroy", .methods = PointerType_destroy, \
+  .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod PointerType_move[];
+#define COBJ_TAG_POINTER_MOVE { \
+  .name = "move", .methods = PointerType_move, .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod PointerType_deep_size[];
+#define COBJ_TAG_POINTER_DEEP_SIZE { \
+  .name = "deep_size", .methods = PointerType_deep_size, \
+  .type = COBJ_TYPE_CMETHODS}
+
+__attribute__((pure, warn_unused_result, nonnull, access(read_only, 2)))
+/**
+ * @brief Get the pointee of a small-buffer pointer.
+ *
+ * Small-buffer pointer types hold their pointee inline if the `size` of their
+ *  `super` is at most their own `size` (a pointer if not set), and a pointer
+ *  to a heap copy like #COBJ_TAG_POINTER_INIT otherwise. The `size` of
+ *  `super` must not depend on the object; a `size` getter makes the type
+ *  invalid.
+ *
+ * @param self Small-buffer pointer.
+ * @param type Small-buffer pointer type.
+ * @return Pointee, or @c NULL if @p type invalid.
+ */
+COBJ_API void *SBOPointer_deref (void *self, const struct CObjTag *type);
+COBJ_API extern const struct CMethod SBOPointerType_init[];
+#define COBJ_TAG_SBO_POINTER_INIT { \
+  .name = "init", .methods = SBOPointerType_init, .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod SBOPointerType_destroy[];
+#define COBJ_TAG_SBO_POINTER_DESTROY { \
+  .name = "destroy", .methods = SBOPointerType_destroy, \
+  .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod SBOPointerType_move[];
+#define COBJ_TAG_SBO_POINTER_MOVE { \
+  .name = "move", .methods = SBOPointerType_move, .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod SBOPointerType_deep_size[];
+#define COBJ_TAG_SBO_POINTER_DEEP_SIZE { \
+  .name = "deep_size", .methods = SBOPointerType_deep_size, \
+  .type = COBJ_TYPE_CMETHODS}
+
+__attribute__((warn_unused_result, malloc, alloc_size(2), access(read_only, 1)))
+/**
+ * @brief Allocate the pointee of a shared pointer, with reference count 1.
+ *
+ * Shared pointer types hold a pointer returned by this function, and use
+ * #COBJ_TAG_SHARED_POINTER_INIT and #COBJ_TAG_SHARED_POINTER_DESTROY, whose
+ * copies only increase the reference count.
+ *
+ * @param allocator Memory allocator, can be @c NULL.
+ * @param size Size of the pointee.
+ * @return Pointee, or @c NULL on error.
+ */
+COBJ_API void *CObjShared_alloc (
+  const struct CObjAllocator *allocator, size_t size);
+__attribute__((pure, warn_unused_result, nonnull, access(read_only, 1)))
+/**
+ * @brief Test if the pointee of a shared pointer is referenced only once.
+ *
+ * @param ptr Pointee.
+ * @return @c true if unique.
+ */
+COBJ_API bool CObjShared_isunique (const void *ptr);
+__attribute__((nonnull(1, 2), access(read_only, 2)))
+/**
+ * @brief Make the pointee of a shared pointer unique before mutating it,
+ *  copying it if it is shared (copy-on-write).
+ *
+ * @param[in,out] self Shared pointer.
+ * @param type Shared pointer type, whose `super` is the pointee type.
+ * @param msg Auxiliary data array, passed to the copyer of the pointee.
+ * @return 0 on success, -1 if out of memory, 255 if @p type invalid, or the
+ *  return value of the copyer.
+ */
+COBJ_API int CObjShared_detach (
+  void **self, const struct CObjTag *type, struct CObjMsg *msg);
+
+COBJ_API extern const struct CMethod SharedPointerType_init[];
+#define COBJ_TAG_SHARED_POINTER_INIT { \
+  .name = "init", .methods = SharedPointerType_init, \
+  .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod SharedPointerType_destroy[];
+#define COBJ_TAG_SHARED_POINTER_DESTROY { \
+  .name = "destroy", .methods = SharedPointerType_destroy, \
+  .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod SharedPointerType_move[];
+#define COBJ_TAG_SHARED_POINTER_MOVE { \
+  .name = "move", .methods = SharedPointerType_move, \
+  .type = COBJ_TYPE_CMETHODS}
+
 COBJ_API extern const struct CMethod ArrayType_len[];
 #define COBJ_TAG_ARRAY_LEN { \
   .name = "len", .methods = ArrayType_len, .type = COBJ_TYPE_CMETHODS}
@@ -204,10 +382,145 @@ COBJ_API extern const struct CMethod ArrayType_size[];
 COBJ_API extern const struct CMethod ArrayType_destroy[];
 #define COBJ_TAG_ARRAY_DESTROY { \
   .name = "destroy", .methods = ArrayType_destroy, .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod ArrayType_deep_size[];
+#define COBJ_TAG_ARRAY_DEEP_SIZE { \
+  .name = "deep_size", .methods = ArrayType_deep_size, \
+  .type = COBJ_TYPE_CMETHODS}
 COBJ_API extern const struct CMethod ArrayType_init[];
 #define COBJ_TAG_ARRAY_INIT { \
   .name = "init", .methods = ArrayType_init, .type = COBJ_TYPE_CMETHODS}
+/**
+ * Move methods have the signature of copyers, `func(self, other, ctx)`, and
+ * leave @p other destroyable. Elements without a move method are moved with
+ * `memcpy`; if they have a destructor, @p other is then left terminated at
+ * its first element, with a copy of its own terminator, to empty it.
+ */
+COBJ_API extern const struct CMethod ArrayType_move[];
+#define COBJ_TAG_ARRAY_MOVE { \
+  .name = "move", .methods = ArrayType_move, .type = COBJ_TYPE_CMETHODS}
+
+/// Sort flags.
+enum CObjSortFlag {
+  /// keep equal elements in their original order
+  COBJ_SORT_STABLE = 1,
+};
+
+__attribute__((nonnull(3)))
+/**
+ * @brief Sort an array in ascending order by the `compare` method of its
+ *  elements.
+ *
+ * Elements are relocated bitwise. Elements of the immediate types are sorted
+ * with radix sort.
+ *
+ * @param data Array.
+ * @param len Number of elements.
+ * @param type Element type.
+ * @param flags Bitwise OR of ::CObjSortFlag.
+ * @param threads Maximum number of threads, or 0 for the number of online
+ *  CPUs. Short arrays are always sorted in the calling thread.
+ * @param msg Message.
+ * @return 0 on success, 1 if the element has no `compare` method, 255 if the
+ *  element size is invalid, -1 if out of memory.
+ */
+COBJ_API int CObjArray_sort (
+  void *data, size_t len, const struct CObjTag *type, int flags,
+  int threads, struct CObjMsg *msg);
+
+/// Sort methods have the signature `int func(self, ctx)`.
+COBJ_API extern const struct CMethod ArrayType_sort[];
+#define COBJ_TAG_ARRAY_SORT { \
+  .name = "sort", .methods = ArrayType_sort, .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod ArrayType_stable_sort[];
+#define COBJ_TAG_ARRAY_STABLE_SORT { \
+  .name = "stable_sort", .methods = ArrayType_stable_sort, \
+  .type = COBJ_TYPE_CMETHODS}
+
+
+/**
+ * @brief Growable array.
+ *
+ * Vector types hold a CObjVector, have their element type in `super`, and can
+ *  have an `allocator` property. Without one, buffers from the
+ *  `huge_threshold` property on are mapped by CObjHuge_allocator, see
+ *  chuge.h. Zero-initialized vectors are empty.
+ */
+struct CObjVector {
+  /// elements
+  void *data;
+  /// number of elements
+  size_t len;
+  /// number of allocated elements
+  size_t cap;
+};
+
+__attribute__((warn_unused_result, nonnull(1, 2), access(read_only, 2)))
+/**
+ * @memberof CObjVector
+ * @brief Make room for at least @p cap elements.
+ *
+ * Elements with a move method are moved to the new storage; others are
+ *  relocated with `realloc`, which can grow in place. If the mover fails, the
+ *  elements already moved are moved back; should that fail too, they are
+ *  destroyed, and the vector is truncated before the first element lost.
+ *
+ * @param self Vector.
+ * @param type Vector type.
+ * @param cap Capacity.
+ * @param msg Auxiliary data array, passed to the element methods.
+ * @return 0 on success, -1 if out of memory, 255 if @p type invalid, or the
+ *  return value of the mover.
+ */
+COBJ_API int CObjVector_reserve (
+  struct CObjVector *self, const struct CObjTag *type, size_t cap,
+  struct CObjMsg *msg);
+__attribute__((warn_unused_result, nonnull(1, 2), access(read_only, 2)))
+/**
+ * @memberof CObjVector
+ * @brief Append copies of @p n elements, growing the vector geometrically.
+ *
+ * Elements are copied with their copyer, or `memcpy` if there is none.
+ *
+ * @param self Vector.
+ * @param type Vector type.
+ * @param other Elements, must not point into @p self.
+ * @param n Number of elements.
+ * @param msg Auxiliary data array, passed to the element methods.
+ * @return 0 on success, -1 if out of memory, 255 if @p type invalid, or the
+ *  return value of the copyer.
+ */
+COBJ_API int CObjVector_extend (
+  struct CObjVector *self, const struct CObjTag *type, const void *other,
+  size_t n, struct CObjMsg *msg);
+__attribute__((warn_unused_result, nonnull(1, 2, 3), access(read_only, 2),
+               access(read_only, 3)))
+/**
+ * @memberof CObjVector
+ * @brief Append a copy of an element.
+ *
+ * @param self Vector.
+ * @param type Vector type.
+ * @param elem Element.
+ * @param msg Auxiliary data array, passed to the element methods.
+ * @return Same as CObjVector_extend().
+ */
+COBJ_API int CObjVector_append (
+  struct CObjVector *self, const struct CObjTag *type, const void *elem,
+  struct CObjMsg *msg);
 
+COBJ_API extern const struct CMethod VectorType_len[];
+#define COBJ_TAG_VECTOR_LEN { \
+  .name = "len", .methods = VectorType_len, .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod VectorType_destroy[];
+#define COBJ_TAG_VECTOR_DESTROY { \
+  .name = "destroy", .methods = VectorType_destroy, \
+  .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod VectorType_init[];
+#define COBJ_TAG_VECTOR_INIT { \
+  .name = "init", .methods = VectorType_init, .type = COBJ_TYPE_CMETHODS}
+COBJ_API extern const struct CMethod VectorType_move[];
+#define COBJ_TAG_VECTOR_MOVE { \
+  .name = "move", .methods = VectorType_move, .type = COBJ_TYPE_CMETHODS}
 
 #ifdef __cplusplus
 }
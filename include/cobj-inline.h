@@ -0,0 +1,37 @@
+#ifndef COBJ_INLINE_H
+#define COBJ_INLINE_H
+
+/**
+ * @file
+ * Header-only build of the lookup core.
+ *
+ * Defining `COBJ_HEADER_ONLY` turns CObjTagArray_find(), CObjTagArray_resolve(),
+ * CObjTagArray_get(), CMethodArray_find() and the other functions of
+ * `src/tag.c`, `src/method.c` and `src/property.c` into `static inline`
+ * functions, whose definitions this header pulls in. Calls with constant tag
+ * sets and slots can then be inlined and specialized by the compiler.
+ *
+ * `COBJ_HEADER_ONLY` must be defined before any header of this library is
+ * included, preferably on the command line, and the root of the source tree
+ * must be on the include path. As it needs the sources, this header is not
+ * installed. The inlined core does not use the lookup caches,
+ * statistics or tracing of the library. Everything else, such as the types
+ * and their methods, still comes from the library.
+ */
+
+#ifndef COBJ_HEADER_ONLY
+#define COBJ_HEADER_ONLY
+#endif
+#undef COBJ_STATS
+#undef COBJ_TRACE
+
+#include "cobj.h"
+#include "cmethod.h"
+
+#include "../src/utils/error.c"
+#include "../src/tag.c"
+#include "../src/method.c"
+#include "../src/property.c"
+
+
+#endif /* COBJ_INLINE_H */
@@ -22,6 +22,13 @@ extern "C" {
 #else
 #define COBJ_API
 #endif
+#ifdef COBJ_HEADER_ONLY
+#define COBJ_CORE static inline
+#define COBJ_CORE_LOCAL static inline
+#else
+#define COBJ_CORE COBJ_API
+#define COBJ_CORE_LOCAL
+#endif
 /** @endcond */
 
 /// Memory allocator.
@@ -143,7 +150,7 @@ __attribute__((warn_unused_result, nonnull, access(read_only, 1),
  * @param slot Slot name.
  * @return Tag data, or @c NULL if not found.
  */
-COBJ_API const struct CObjVariant *CObjTagArray_find (
+COBJ_CORE const struct CObjVariant *CObjTagArray_find (
   const struct CObjTag *self, const struct CObjSlot *slot);
 __attribute__((
   warn_unused_result, nonnull(1, 2), access(read_only, 1),
@@ -158,7 +165,7 @@ __attribute__((
  * @param[out] offset Offset of the target tag set.
  * @return Tag data, or @c NULL if not found.
  */
-COBJ_API const struct CObjVariant *CObjTagArray_resolve (
+COBJ_CORE const struct CObjVariant *CObjTagArray_resolve (
   const struct CObjTag *self, const struct CObjSlot *slot,
   const struct CObjTag **target, int *offset);
 __attribute__((
@@ -174,9 +181,51 @@ __attribute__((
  * @param[out] offset Offset of the target tag set.
  * @return Tag data, or @c NULL if not found.
  */
-COBJ_API const struct CObjVariant *CObjTagArray_resolves (
+COBJ_CORE const struct CObjVariant *CObjTagArray_resolves (
   const struct CObjTag *self, const struct CObjSlot *path,
   const struct CObjTag **target, int *offset);
+/// Kind of defect found by CObjTagArray_validate().
+enum CObjTagErrorKind {
+  /// alias tag has no path
+  COBJ_TAG_ERROR_PATH = 1,
+  /// alias path cannot be resolved
+  COBJ_TAG_ERROR_DANGLING,
+  /// alias path, or the chain of public tag sets, leads back to itself
+  COBJ_TAG_ERROR_CYCLE,
+  /// public tag set does not fit in the structure at its offset
+  COBJ_TAG_ERROR_OFFSET,
+  /// tag set has no positive `size`
+  COBJ_TAG_ERROR_SIZE,
+};
+
+/// Defect found by CObjTagArray_validate().
+struct CObjTagError {
+  /// CObjTagErrorKind
+  int kind;
+  /// tag set which contains the defect
+  const struct CObjTag *tags;
+  /// defective tag, or @c NULL if the tag is missing
+  const struct CObjTag *tag;
+};
+
+__attribute__((nonnull(1), access(read_only, 1), access(write_only, 2, 3)))
+/**
+ * @memberof CObjTagArray
+ * @brief Check a tag set and all its public tag sets for alias cycles,
+ *  dangling alias paths, bad offsets and missing sizes.
+ *
+ * If no defect is found, the tag set is marked as validated, and
+ * CObjTagArray_resolve() skips its per-call alias checks afterwards, until
+ * CObjCache_clear() is called. If too many tag sets are validated, some may
+ * go unmarked.
+ *
+ * @param self Tag set.
+ * @param[out] errors Found defects, can be @c NULL if @p n is 0.
+ * @param n Capacity of @p errors.
+ * @return Number of found defects, which may exceed @p n.
+ */
+COBJ_CORE int CObjTagArray_validate (
+  const struct CObjTag *self, struct CObjTagError *errors, int n);
 __attribute__((pure, warn_unused_result, nonnull, access(read_only, 1),
                access(read_only, 2), access(read_only, 3)))
 /**
@@ -189,7 +238,7 @@ __attribute__((pure, warn_unused_result, nonnull, access(read_only, 1),
  * @param default_ Default value.
  * @return Property value, or @p default_ if not found.
  */
-COBJ_API long CObjTagArray_get (
+COBJ_CORE long CObjTagArray_get (
   const struct CObjTag *self, const struct CObjSlot *slot, const void *obj,
   long default_);
 __attribute__((copy(CObjTagArray_get)))
@@ -207,6 +256,8 @@ static inline long CObjTagArray_get0 (
   return CObjTagArray_get (self, slot, obj, 0);
 }
 
+/// tag set terminator
+#define COBJ_TAG_END {{{{0}}}}
 /// tag initializer of `name = s`
 #define COBJ_TAG_NAME(s) {.name = "name", .ptr = s}
 /// tag initializer of `size = n`
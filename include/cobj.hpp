@@ -0,0 +1,689 @@
+#ifndef COBJ_HPP
+#define COBJ_HPP
+
+#if __cplusplus < 202002L
+#error "cobj.hpp requires C++20"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#pragma GCC diagnostic push
+// anonymous structures of the C headers
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include "cobj.h"
+#include "cmethod.h"
+#pragma GCC diagnostic pop
+
+/**
+ * @file
+ * C++ interface: constexpr tag sets and method tables, compile-time slot
+ * resolution and trait matching, and typed method calls.
+ *
+ * Everything defined here has the layout of the C structures and can be passed
+ * to the C API, and C-defined types can be referred to from C++ definitions.
+ *
+ * Lookups on tag sets defined as `constexpr` in C++ can be done by the
+ * `consteval` functions of this header, which cost nothing at runtime. They
+ * cannot look into C-defined tag sets, whose contents are unknown to the
+ * compiler, nor evaluate traits with test functions; such lookups fail to
+ * compile, and must be done at runtime with cobj::Context.
+ *
+ * @code
+ * constexpr auto MyArray = cobj::tag_array(
+ *   cobj::super(Imm8Type), cobj::methods(cobj::slot("len"), ArrayType_len));
+ * static_assert(cobj::resolve(MyArray, cobj::slot("len")).tag->methods ==
+ *               ArrayType_len);
+ * @endcode
+ */
+
+
+namespace cobj {
+
+
+/**
+ * @name Slots
+ * @{
+ */
+/**
+ * @brief Make a slot.
+ *
+ * @param name Name, at most 14 characters.
+ * @param ns Namespace.
+ * @return Slot.
+ */
+template <std::size_t N>
+consteval CObjSlot slot (const char (&name)[N], std::int16_t ns = 0) {
+  static_assert(N - 1 <= sizeof(CObjSlot::name), "slot name too long");
+  CObjSlot ret{};
+  for (std::size_t i = 0; i < N - 1; i++) {
+    ret.name[i] = name[i];
+  }
+  ret.ns = ns;
+  return ret;
+}
+/**
+ * @brief Make the first slot of a trait path, which selects an argument.
+ *
+ * @param i Index of the argument, starting from 1.
+ * @return Slot.
+ */
+consteval CObjSlot arg (int i) {
+  CObjSlot ret{};
+  ret.name[0] = static_cast<char>(i);
+  return ret;
+}
+
+/// Test if a slot is empty, like the library does.
+constexpr bool isnull (const CObjSlot &self) {
+  for (std::size_t i = 0; i < sizeof(void *); i++) {
+    if (self.name[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+/// Test if two slots are equal.
+constexpr bool equal (const CObjSlot &self, const CObjSlot &other) {
+  for (std::size_t i = 0; i < sizeof(self.name); i++) {
+    if (self.name[i] != other.name[i]) {
+      return false;
+    }
+  }
+  return self.ns == other.ns;
+}
+
+/// Slot path, terminated, with the layout of `CObjSlot[N + 1]`.
+template <std::size_t N>
+struct Path {
+  /// slots, terminated by an empty slot
+  CObjSlot slots[N + 1];
+
+  constexpr operator const CObjSlot * () const {
+    return slots;
+  }
+};
+/// Make a slot path.
+template <typename... T>
+consteval Path<sizeof...(T)> path (const T &...slots) {
+  return {{slots..., CObjSlot{}}};
+}
+/** @} */
+
+
+/**
+ * @name Tags
+ * Tag constructors for constexpr tag sets. For use at compile time, the member
+ *  of CObjTag which is set is the one its CObjTag::type designates; CObjTag::ptr
+ *  cannot be compared at compile time.
+ * @{
+ */
+/// Tag holding a plain value.
+constexpr CObjTag value (const CObjSlot &slot, long value) {
+  CObjTag ret{};
+  ret.slot = slot;
+  ret.value = value;
+  ret.type = COBJ_TYPE_UNDEFINED;
+  ret.public_ = false;
+  ret.offset = 0;
+  return ret;
+}
+/// Tag holding a pointer to user data.
+constexpr CObjTag pointer (const CObjSlot &slot, void *ptr) {
+  CObjTag ret{};
+  ret.slot = slot;
+  ret.ptr = ptr;
+  ret.type = COBJ_TYPE_UNDEFINED;
+  ret.public_ = false;
+  ret.offset = 0;
+  return ret;
+}
+/// `size` tag, see #COBJ_TAG_SIZE.
+consteval CObjTag size (long n) {
+  return value(slot("size"), n);
+}
+/// `size` tag of a C++ type, see #COBJ_TAG_SIZEOF.
+template <typename T>
+consteval CObjTag size_of () {
+  return size(sizeof(T));
+}
+/**
+ * @brief Tag holding a tag set.
+ *
+ * @param slot Slot.
+ * @param tags Tag set.
+ * @param public_ Whether slots of @p tags are inherited.
+ * @param offset Offset of the structure of @p tags; must be at most
+ *  `USHRT_MAX`.
+ * @return Tag.
+ */
+constexpr CObjTag tags (
+    const CObjSlot &slot, const CObjTag *tags, bool public_ = false,
+    unsigned short offset = 0) {
+  CObjTag ret{};
+  ret.slot = slot;
+  ret.tags = tags;
+  ret.type = COBJ_TYPE_TAGS;
+  ret.public_ = public_;
+  ret.offset = offset;
+  return ret;
+}
+/// `super` tag, the element or pointee type.
+consteval CObjTag super (const CObjTag *type) {
+  return tags(slot("super"), type);
+}
+/// Public tag set, whose slots are inherited.
+constexpr CObjTag base (
+    const CObjSlot &slot, const CObjTag *type, unsigned short offset = 0) {
+  return tags(slot, type, true, offset);
+}
+/// Tag holding a method table.
+constexpr CObjTag methods (const CObjSlot &slot, const CMethod *methods) {
+  CObjTag ret{};
+  ret.slot = slot;
+  ret.methods = methods;
+  ret.type = COBJ_TYPE_CMETHODS;
+  ret.public_ = false;
+  ret.offset = 0;
+  return ret;
+}
+/// Tag holding a getter, see CObjTagArray_get().
+constexpr CObjTag func (const CObjSlot &slot, CObjFunc func) {
+  CObjTag ret{};
+  ret.slot = slot;
+  ret.func = func;
+  ret.type = COBJ_TYPE_FUNC;
+  ret.public_ = false;
+  ret.offset = 0;
+  return ret;
+}
+/**
+ * @brief Alias tag.
+ *
+ * @param slot Slot.
+ * @param path Slot path, which must outlive the tag.
+ * @param virtual_ Whether to resolve the path from the top tag set.
+ * @return Tag.
+ */
+constexpr CObjTag alias (
+    const CObjSlot &slot, const CObjSlot *path, bool virtual_ = false) {
+  CObjTag ret{};
+  ret.slot = slot;
+  ret.path = path;
+  ret.type = COBJ_TYPE_PATH;
+  ret.virtual_ = virtual_;
+  ret.offset = 0;
+  return ret;
+}
+
+/// Tag set, terminated, with the layout of `CObjTag[N + 1]`.
+template <std::size_t N>
+struct TagArray {
+  /// tags, terminated by #COBJ_TAG_END
+  CObjTag tags[N + 1];
+
+  constexpr operator const CObjTag * () const {
+    return tags;
+  }
+};
+static_assert(sizeof(TagArray<2>) == sizeof(CObjTag[3]));
+static_assert(std::is_standard_layout_v<TagArray<2>>);
+/// Make a tag set.
+template <typename... T>
+consteval TagArray<sizeof...(T)> tag_array (const T &...tags) {
+  return {{tags..., CObjTag{}}};
+}
+/** @} */
+
+
+/**
+ * @name Slot resolution
+ * Compile-time counterparts of CObjTagArray_resolve() and friends.
+ * @{
+ */
+/// Resolved slot.
+struct Resolved {
+  /// tag, or @c nullptr if not found
+  const CObjTag *tag;
+  /// tag set which owns CObjTag::tag
+  const CObjTag *target;
+  /// absolute offset of the structure of Resolved::target
+  int offset;
+
+  constexpr explicit operator bool () const {
+    return tag != nullptr;
+  }
+};
+
+/// @cond GARBAGE
+namespace detail {
+
+constexpr bool is_public (const CObjTag *tag) {
+  return tag->type == COBJ_TYPE_TAGS && tag->public_ && tag->tags != nullptr;
+}
+
+constexpr Resolved resolve_simple (
+    const CObjTag *self, const CObjSlot &slot, int offset) {
+  for (const CObjTag *tag = self; !isnull(tag->slot); tag++) {
+    if (equal(tag->slot, slot)) {
+      return {tag, self, offset};
+    }
+  }
+  for (const CObjTag *tag = self; !isnull(tag->slot); tag++) {
+    if (is_public(tag)) {
+      Resolved ret = resolve_simple(tag->tags, slot, offset + tag->offset);
+      if (ret) {
+        return ret;
+      }
+    }
+  }
+  return {};
+}
+
+constexpr Resolved resolves (const CObjTag *self, const CObjSlot *path);
+
+constexpr Resolved resolve (const CObjTag *self, const CObjSlot &slot) {
+  Resolved ret = resolve_simple(self, slot, 0);
+  if (!ret || ret.tag->type != COBJ_TYPE_PATH) {
+    return ret;
+  }
+  // non-virtual alias is resolved relative to the tag set which owns it
+  const CObjTag *alias = ret.tag;
+  int base = alias->virtual_ ? 0 : ret.offset;
+  ret = resolves(alias->virtual_ ? self : ret.target, alias->path);
+  if (ret) {
+    ret.offset += base;
+  }
+  return ret;
+}
+
+constexpr Resolved resolves (const CObjTag *self, const CObjSlot *path) {
+  if (isnull(*path)) {
+    return {};
+  }
+  for (; ; path++) {
+    Resolved ret = resolve(self, *path);
+    if (!ret || isnull(path[1])) {
+      return ret;
+    }
+    if (ret.tag->type != COBJ_TYPE_TAGS || ret.tag->tags == nullptr) {
+      return {};
+    }
+    self = ret.tag->tags;
+  }
+}
+
+constexpr bool is_derived (const CObjTag *self, const CObjTag *base) {
+  for (const CObjTag *tag = self; !isnull(tag->slot); tag++) {
+    if (is_public(tag) &&
+        (tag->tags == base || is_derived(tag->tags, base))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace detail
+/// @endcond
+
+/**
+ * @brief Resolve a slot, following public tag sets and aliases.
+ *
+ * @param self Tag set.
+ * @param slot Slot.
+ * @return Resolved slot.
+ */
+consteval Resolved resolve (const CObjTag *self, const CObjSlot &slot) {
+  return detail::resolve(self, slot);
+}
+/**
+ * @brief Resolve a slot path.
+ *
+ * @param self Tag set.
+ * @param path Slot path.
+ * @return Resolved slot.
+ */
+consteval Resolved resolves (const CObjTag *self, const CObjSlot *path) {
+  return detail::resolves(self, path);
+}
+/**
+ * @brief Get a plain value.
+ *
+ * @param self Tag set.
+ * @param slot Slot.
+ * @param default_ Value if not found.
+ * @return Value.
+ */
+consteval long get (
+    const CObjTag *self, const CObjSlot &slot, long default_ = 0) {
+  Resolved ret = detail::resolve(self, slot);
+  return ret && ret.tag->type == COBJ_TYPE_UNDEFINED ?
+    ret.tag->value : default_;
+}
+/**
+ * @brief Test if a tag set inherits from another, see
+ *  CObjTagArray_is_derived().
+ *
+ * @param self Tag set.
+ * @param base Base tag set.
+ * @return @c true if derived.
+ */
+consteval bool is_derived (const CObjTag *self, const CObjTag *base) {
+  return base == nullptr || self == base ||
+    (self != nullptr && detail::is_derived(self, base));
+}
+/** @} */
+
+
+/**
+ * @name Traits
+ * @{
+ */
+/// Variant holding a plain value.
+template <typename T> requires std::is_integral_v<T>
+constexpr CObjVariant variant (T value) {
+  CObjVariant ret{};
+  ret.value = value;
+  ret.type = COBJ_TYPE_UNDEFINED;
+  return ret;
+}
+/// Variant holding a tag set.
+constexpr CObjVariant variant (const CObjTag *tags) {
+  CObjVariant ret{};
+  ret.tags = tags;
+  ret.type = COBJ_TYPE_TAGS;
+  return ret;
+}
+/// Variant holding a slot path, resolved from the arguments by traits.
+constexpr CObjVariant variant (const CObjSlot *path) {
+  CObjVariant ret{};
+  ret.path = path;
+  ret.type = COBJ_TYPE_PATH;
+  return ret;
+}
+
+/**
+ * @brief Make a trait.
+ *
+ * @param path Slot path of the left value, starting with cobj::arg().
+ * @param cmp Comparison type, see #CObjTraitType.
+ * @param value Right value; a path is resolved like @p path.
+ * @return Trait.
+ */
+constexpr CObjTrait trait (
+    const CObjSlot *path, unsigned char cmp = COBJ_TRAIT_NONE,
+    const CObjVariant &value = {}) {
+  return {path, value, cmp, nullptr, nullptr};
+}
+
+/// Trait table, terminated, with the layout of `CObjTrait[N + 1]`.
+template <std::size_t N>
+struct TraitArray {
+  /// traits, terminated by an empty trait
+  CObjTrait traits[N + 1];
+
+  constexpr operator const CObjTrait * () const {
+    return traits;
+  }
+};
+/// Make a trait table.
+template <typename... T>
+consteval TraitArray<sizeof...(T)> trait_array (const T &...traits) {
+  return {{traits..., CObjTrait{}}};
+}
+
+/// @cond GARBAGE
+namespace detail {
+
+/// variant read through the member CObjVariant::type designates
+struct Value {
+  bool found;
+  unsigned char type;
+  long value;
+  const void *ptr;
+  CObjFunc func;
+};
+
+template <typename V>
+constexpr Value load (const V &v) {
+  switch (v.type) {
+    case COBJ_TYPE_UNDEFINED:
+      return {true, v.type, v.value, nullptr, nullptr};
+    case COBJ_TYPE_PATH:
+      return {true, v.type, 0, v.path, nullptr};
+    case COBJ_TYPE_TAGS:
+      return {true, v.type, 0, v.tags, nullptr};
+    case COBJ_TYPE_CMETHODS:
+      return {true, v.type, 0, v.methods, nullptr};
+    default:
+      return {true, v.type, 0, nullptr, v.func};
+  }
+}
+
+constexpr Value resolve_arg (
+    const CObjSlot *path, const CObjTag *const *types, int len) {
+  if (path == nullptr || !(0 < path[0].name[0] && path[0].name[0] <= len)) {
+    return {};
+  }
+  const CObjTag *type = types[path[0].name[0] - 1];
+  if (isnull(path[1])) {
+    return {true, COBJ_TYPE_TAGS, 0, type, nullptr};
+  }
+  if (type == nullptr) {
+    return {};
+  }
+  Resolved ret = resolves(type, path + 1);
+  return ret ? load(*ret.tag) : Value{};
+}
+
+}  // namespace detail
+/// @endcond
+
+/**
+ * @brief Test if a trait is satisfied, see CObjTrait_match().
+ *
+ * @param self Trait, without test function.
+ * @param types Tag sets of arguments.
+ * @param len Length of @p types.
+ * @return @c true if matches.
+ */
+consteval bool match (
+    const CObjTrait &self, const CObjTag *const *types, int len) {
+  detail::Value v1 = detail::resolve_arg(self.path, types, len);
+  if (self.cmp == COBJ_TRAIT_NONE) {
+    return v1.found;
+  }
+  detail::Value v2 = self.value.type == COBJ_TYPE_PATH ?
+    detail::resolve_arg(self.value.path, types, len) : detail::load(self.value);
+  if (!v1.found || !v2.found) {
+    return !v1.found && !v2.found;
+  }
+  switch (self.cmp) {
+    case COBJ_TRAIT_EQUAL:
+      return v1.type == v2.type && v1.value == v2.value && v1.ptr == v2.ptr &&
+        v1.func == v2.func;
+    case COBJ_TRAIT_OFTYPE:
+      return v1.type == v2.type;
+    case COBJ_TRAIT_SUBTYPE:
+      return v1.type == COBJ_TYPE_TAGS && v1.type == v2.type &&
+        is_derived(static_cast<const CObjTag *>(v1.ptr),
+                   static_cast<const CObjTag *>(v2.ptr));
+    default:
+      return false;
+  }
+}
+/**
+ * @brief Test if all traits of a trait table are satisfied.
+ *
+ * @param self Trait table, can be @c nullptr.
+ * @param types Tag sets of arguments.
+ * @param len Length of @p types.
+ * @return @c true if matches.
+ */
+consteval bool match (
+    const CObjTrait *self, const CObjTag *const *types, int len) {
+  if (self != nullptr) {
+    for (; self->path != nullptr; self++) {
+      if (!match(*self, types, len)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+/** @} */
+
+
+/**
+ * @name Method calls
+ * @{
+ */
+/**
+ * @brief Method implementation, for cobj::Methods.
+ *
+ * @tparam F Method function, taking `const CMethodContext *` last.
+ * @tparam Traits Traits required for calling the method.
+ */
+template <auto F, const CObjTrait *Traits = nullptr>
+struct Method {
+  static constexpr auto func = F;
+  static constexpr const CObjTrait *traits = Traits;
+};
+
+/**
+ * @brief Method table known at compile time.
+ *
+ * The table is also available to the C API as Methods::data, for use in tag
+ * sets; see cobj::methods().
+ *
+ * @tparam M cobj::Method entries, in order of preference.
+ */
+template <typename... M>
+struct Methods {
+  /// table with the layout of `CMethod[]`, terminated
+  static inline const CMethod data[] = {
+    {reinterpret_cast<CObjFunc>(M::func), nullptr, M::traits}..., {}};
+
+  /**
+   * @brief Find the first method whose traits are satisfied by the given
+   *  argument tag sets.
+   *
+   * @tparam Types Tag sets of arguments, cobj::TagArray or C-defined types.
+   * @return Index of the method, or -1 if not found.
+   */
+  template <const auto &... Types>
+  static consteval int find () {
+    constexpr const CObjTag *types[] = {
+      static_cast<const CObjTag *>(Types)..., nullptr};
+    constexpr const CObjTrait *traits[] = {M::traits...};
+    for (std::size_t i = 0; i < sizeof...(M); i++) {
+      if (match(traits[i], types, sizeof...(Types))) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+  /// @cond GARBAGE
+  template <int I, typename First, typename... Rest>
+  struct At : At<I - 1, Rest...> { };
+  template <typename First, typename... Rest>
+  struct At<0, First, Rest...> : First { };
+
+  template <const auto &... Types>
+  struct Bound {
+    static constexpr int index = find<Types...>();
+    static_assert(index >= 0, "no suitable method");
+    using Entry = At<index, M...>;
+    static constexpr const CObjTag *types[] = {
+      static_cast<const CObjTag *>(Types)...};
+    static inline const CMethodContext context = {
+      reinterpret_cast<CObjFunc>(Entry::func), nullptr, Entry::traits,
+      types[0], 0, sizeof...(Types), const_cast<const CObjTag **>(types),
+      nullptr};
+  };
+  /// @endcond
+
+  /**
+   * @brief Call the method chosen at compile time for the given argument tag
+   *  sets. The call is direct, and can be inlined.
+   *
+   * The method receives a context with CMethodContext::target set to the
+   * first tag set and CMethodContext::msg set to @c NULL.
+   *
+   * @tparam Types Tag sets of arguments, cobj::TagArray or C-defined types.
+   * @param args Arguments, without the context.
+   * @return Return value of the method.
+   */
+  template <const auto &... Types, typename... Args>
+  static decltype(auto) call (Args &&...args) {
+    using B = Bound<Types...>;
+    return B::Entry::func(static_cast<Args &&>(args)..., &B::context);
+  }
+};
+
+template <typename Sig>
+class Context;
+
+/**
+ * @brief Method context with a typed call operator, for methods resolved at
+ *  runtime.
+ *
+ * @code
+ * cobj::Context<int (void *, const void *)> init;
+ * const CObjTag *types[] = {Array, Array};
+ * if (init.init(cobj::slot("init"), types) == 0) {
+ *   init(dst, src);
+ * }
+ * @endcode
+ *
+ * @tparam R Return type.
+ * @tparam Args Argument types, without the context.
+ */
+template <typename R, typename... Args>
+class Context<R (Args...)> : public CMethodContext {
+ public:
+  /// type of the method function
+  using Func = R (*) (Args..., const CMethodContext *);
+
+  Context () : CMethodContext{} { }
+
+  /**
+   * @brief Resolve a method, see CMethodContext_init().
+   *
+   * @param slot Slot of the method.
+   * @param types Tag sets of arguments, which must outlive the context.
+   * @param len Length of @p types.
+   * @param msg Auxiliary data array.
+   * @return 0 on success, 1 if no suitable method found, 255 if @p types
+   *  invalid.
+   */
+  [[nodiscard]] int init (
+      const CObjSlot &slot, const CObjTag **types, int len,
+      CObjMsg *msg = nullptr) {
+    this->types = types;
+    this->len = len;
+    this->msg = msg;
+    return CMethodContext_init(this, &slot);
+  }
+  /// @overload
+  template <int N>
+  [[nodiscard]] int init (
+      const CObjSlot &slot, const CObjTag *(&types)[N],
+      CObjMsg *msg = nullptr) {
+    return init(slot, types, N, msg);
+  }
+
+  /// Call the resolved method.
+  R operator() (Args... args) const {
+    return reinterpret_cast<Func>(func)(args..., this);
+  }
+};
+static_assert(sizeof(Context<int (void *)>) == sizeof(CMethodContext));
+/** @} */
+
+
+}  // namespace cobj
+
+#endif /* COBJ_HPP */
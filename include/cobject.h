@@ -0,0 +1,198 @@
+#ifndef COBJECT_H
+#define COBJECT_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+#include "cmethod.h"
+
+/**
+ * @file
+ * Optional object header, which binds objects to their types.
+ *
+ * An object which starts with struct CObjHeader carries its type, so callers
+ * no longer pass the type separately. Each CObjType keeps a small dispatch
+ * cache next to its tags, so repeated calls on headered objects skip
+ * resolving and method selection.
+ */
+
+
+/// number of entries in the per-type dispatch cache, must be power of 2
+#define COBJ_TYPE_CACHE_SIZE 8
+
+/// Entry of the per-type dispatch cache.
+struct CObjTypeCacheEntry {
+  /// sequence lock
+  unsigned seq;
+  /// slot name, empty if the entry is unused
+  struct CObjSlot slot;
+  /// see CMethodContext::func
+  CObjFunc func;
+  /// see CMethodContext::userdata
+  void *userdata;
+  /// see CMethodContext::traits
+  const struct CObjTrait *traits;
+  /// see CMethodContext::target
+  const struct CObjTag *target;
+  /// see CMethodContext::offset
+  int offset;
+};
+
+/// Type of objects with CObjHeader. Must be writable, as it holds a cache.
+struct CObjType {
+  /// tag set
+  const struct CObjTag *tags;
+  /// whether CObjHeader::refcount is updated atomically
+  bool atomic;
+  /// dispatch cache of calls with the object as the only typed argument
+  struct CObjTypeCacheEntry cache[COBJ_TYPE_CACHE_SIZE];
+};
+
+/// initializer of CObjType of tag set @p t
+#define COBJ_TYPE_INIT(t) {.tags = t}
+/// initializer of CObjType of tag set @p t, with atomic reference counting
+#define COBJ_TYPE_INIT_ATOMIC(t) {.tags = t, .atomic = true}
+
+/// Object header, to be placed at the start of the object.
+struct CObjHeader {
+  /// type of the object
+  struct CObjType *type;
+  /// reference count, if the object is reference counted
+  long refcount;
+};
+
+
+__attribute__((nonnull, access(read_only, 1), access(read_only, 2)))
+/**
+ * @memberof CObjHeader
+ * @brief Resolve method of given slot for an object with header, and
+ *  initialize a method context object, like CMethodContext_init() with the
+ *  object type as the only type.
+ *
+ * @p ctx->msg is untouched.
+ *
+ * @param self Object.
+ * @param slot Slot of method.
+ * @param[out] ctx Method context.
+ * @return 0 on success, 1 if no suitable method found.
+ */
+COBJ_API int CObj_context_init (
+  const void *self, const struct CObjSlot *slot, struct CMethodContext *ctx);
+
+__attribute__((pure, warn_unused_result, nonnull, access(read_only, 1)))
+/**
+ * @memberof CObjHeader
+ * @brief Get the tag set of an object with header.
+ *
+ * @param self Object.
+ * @return Tag set.
+ */
+static inline const struct CObjTag *CObj_tags (const void *self) {
+  return ((const struct CObjHeader *) self)->type->tags;
+}
+__attribute__((pure, warn_unused_result, nonnull, access(read_only, 1),
+               access(read_only, 2)))
+/**
+ * @memberof CObjHeader
+ * @brief Get property of an object with header. If property is not found,
+ *  return default.
+ *
+ * @param self Object.
+ * @param slot Slot name.
+ * @param default_ Default value.
+ * @return Property value, or @p default_ if not found.
+ */
+static inline long CObj_get (
+    const void *self, const struct CObjSlot *slot, long default_) {
+  return CObjTagArray_get(CObj_tags(self), slot, self, default_);
+}
+
+__attribute__((nonnull))
+/**
+ * @memberof CObjHeader
+ * @brief Increase reference count of an object with header.
+ *
+ * @param self Object.
+ */
+static inline void CObj_ref (void *self) {
+  struct CObjHeader *header = (struct CObjHeader *) self;
+  if (header->type->atomic) {
+    __atomic_add_fetch(&header->refcount, 1, __ATOMIC_RELAXED);
+  } else {
+    header->refcount++;
+  }
+}
+__attribute__((warn_unused_result, nonnull))
+/**
+ * @memberof CObjHeader
+ * @brief Decrease reference count of an object with header.
+ *
+ * @param self Object.
+ * @return @c true if the count drops to zero, and the object should be
+ *  destroyed.
+ */
+static inline bool CObj_unref (void *self) {
+  struct CObjHeader *header = (struct CObjHeader *) self;
+  if (header->type->atomic) {
+    return __atomic_sub_fetch(&header->refcount, 1, __ATOMIC_ACQ_REL) == 0;
+  }
+  return --header->refcount == 0;
+}
+
+/** @cond GARBAGE */
+#define COBJ_ARGS_FIRST_(a, ...) a
+#define COBJ_ARGS_REST_(a, ...) __VA_ARGS__
+#define COBJ_ARGS_CAT_(a, b) COBJ_ARGS_CAT__(a, b)
+#define COBJ_ARGS_CAT__(a, b) a ## b
+#define COBJ_ARGS_NTH_(_1, _2, _3, _4, _5, _6, _7, _8, _9, n, ...) n
+#define COBJ_ARGS_COUNT_(...) \
+  COBJ_ARGS_NTH_(__VA_ARGS__, 9, 8, 7, 6, 5, 4, 3, 2, 1, ~)
+// parameter list made of the types of the arguments
+#define COBJ_ARGS_TYPES_(...) \
+  COBJ_ARGS_CAT_(COBJ_ARGS_TYPES_, COBJ_ARGS_COUNT_(__VA_ARGS__))(__VA_ARGS__)
+#define COBJ_ARGS_TYPES_1(a) __typeof__(a)
+#define COBJ_ARGS_TYPES_2(a, ...) __typeof__(a), COBJ_ARGS_TYPES_1(__VA_ARGS__)
+#define COBJ_ARGS_TYPES_3(a, ...) __typeof__(a), COBJ_ARGS_TYPES_2(__VA_ARGS__)
+#define COBJ_ARGS_TYPES_4(a, ...) __typeof__(a), COBJ_ARGS_TYPES_3(__VA_ARGS__)
+#define COBJ_ARGS_TYPES_5(a, ...) __typeof__(a), COBJ_ARGS_TYPES_4(__VA_ARGS__)
+#define COBJ_ARGS_TYPES_6(a, ...) __typeof__(a), COBJ_ARGS_TYPES_5(__VA_ARGS__)
+#define COBJ_ARGS_TYPES_7(a, ...) __typeof__(a), COBJ_ARGS_TYPES_6(__VA_ARGS__)
+#define COBJ_ARGS_TYPES_8(a, ...) __typeof__(a), COBJ_ARGS_TYPES_7(__VA_ARGS__)
+#define COBJ_ARGS_TYPES_9(a, ...) __typeof__(a), COBJ_ARGS_TYPES_8(__VA_ARGS__)
+/** @endcond */
+
+/**
+ * @memberof CObjHeader
+ * @brief Call method of given slot on an object with header, as
+ *  `CObj_call(obj, slot, ...)`.
+ *
+ * The method is called as `func(obj + offset, ..., &ctx)` and must return
+ * `int`. It is called through a prototype made of the types of the given
+ * arguments, without default argument promotions, so they must match the
+ * parameters of the method. At most 8 extra arguments are supported.
+ *
+ * @param obj Object.
+ * @param ... Slot of method, followed by extra arguments.
+ * @return Return value of the method, or 255 if no suitable method found.
+ */
+#define CObj_call(obj, ...) __extension__ ({ \
+  struct CMethodContext cobj_ctx_; \
+  char *cobj_obj_ = (char *) (obj); \
+  cobj_ctx_.msg = NULL; \
+  CObj_context_init( \
+    cobj_obj_, COBJ_ARGS_FIRST_(__VA_ARGS__, ~), &cobj_ctx_) != 0 ? 255 : \
+    ((int (*) (void *, COBJ_ARGS_TYPES_( \
+        COBJ_ARGS_REST_(__VA_ARGS__, &cobj_ctx_)))) \
+      (void (*) (void)) cobj_ctx_.func)( \
+      cobj_obj_ + cobj_ctx_.offset, COBJ_ARGS_REST_(__VA_ARGS__, &cobj_ctx_)); \
+})
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COBJECT_H */
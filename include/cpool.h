@@ -0,0 +1,100 @@
+#ifndef CPOOL_H
+#define CPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "cobj.h"
+
+/**
+ * @file
+ * Thread-caching pool allocator.
+ *
+ * Small requests are rounded up to one of a few dozen size classes. Each
+ * thread keeps a free list per size class, served without locking; lists
+ * are refilled from, and drained to, a central pool in batches, so the lock
+ * of a size class is taken once per batch. Blocks can be freed by any thread:
+ * they go to the cache of the freeing thread. Caches of exiting threads are
+ * returned to the central pool.
+ *
+ * Blocks are carved from aligned spans, whose header records the size class,
+ * so that freeing does not need the size. Requests above the largest class are
+ * served by the system allocator.
+ *
+ * Use CObjPool_allocator as the `allocator` slot of a type, for example with
+ * #COBJ_TAG_POOL_ALLOCATOR.
+ */
+
+
+/// Tag entry using the pool as allocator.
+#define COBJ_TAG_POOL_ALLOCATOR \
+  {.name = "allocator", .ptr = (void *) &CObjPool_allocator}
+
+/// Statistics of the pool allocator.
+struct CObjPoolStats {
+  /// number of allocations
+  size_t allocs;
+  /// number of frees
+  size_t frees;
+  /// bytes of live blocks, rounded up to their size classes
+  size_t bytes;
+  /// bytes obtained from the system
+  size_t mapped;
+};
+
+
+/// Pool allocator, usable as the `allocator` slot.
+COBJ_API extern const struct CObjAllocator CObjPool_allocator;
+
+
+__attribute__((malloc, warn_unused_result, alloc_size(1)))
+/**
+ * @brief Allocate memory from the pool.
+ *
+ * @param size Memory size.
+ * @return Allocated memory, aligned to 16 bytes, or @c NULL on error with
+ *  @c errno set.
+ */
+COBJ_API void *CObjPool_malloc (size_t size);
+__attribute__((warn_unused_result, alloc_size(2)))
+/**
+ * @brief Re-allocate memory of the pool.
+ *
+ * The block is kept if @p size still fits its size class.
+ *
+ * @param ptr Memory allocated by the pool, can be @c NULL.
+ * @param size New memory size.
+ * @return Re-allocated memory, or @c NULL on error with @c errno set, in
+ *  which case @p ptr is untouched.
+ */
+COBJ_API void *CObjPool_realloc (void *ptr, size_t size);
+/**
+ * @brief Free memory of the pool, from any thread.
+ *
+ * @param ptr Memory allocated by the pool, can be @c NULL.
+ */
+COBJ_API void CObjPool_free (void *ptr);
+/**
+ * @brief Return all blocks cached by the calling thread to the central pool.
+ */
+COBJ_API void CObjPool_flush (void);
+__attribute__((nonnull, access(write_only, 1)))
+/**
+ * @brief Collect statistics of all threads.
+ *
+ * Counters of other threads are read without stopping them, so the result is
+ * only consistent when they are idle.
+ *
+ * @param[out] stats Statistics.
+ */
+COBJ_API void CObjPool_stats (struct CObjPoolStats *stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CPOOL_H */
@@ -0,0 +1,101 @@
+#ifndef CSTATS_H
+#define CSTATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+#include <stdint.h>
+
+#include "cobj.h"
+
+/**
+ * @file
+ * Statistics of lookup and dispatch hot paths.
+ *
+ * Statistics are collected only if the library is built with `COBJ_STATS`
+ * defined (`make STATS=1`); otherwise the hooks compile to nothing. Each thread
+ * records into its own block, and blocks are merged when read.
+ */
+
+
+/// Statistic metric.
+enum CObjStat {
+  /// scans of a single tag set; value: number of tags scanned
+  COBJ_STAT_FIND = 0,
+  /// slots found by resolution; value: depth of the super chain where found
+  COBJ_STAT_RESOLVE_DEPTH,
+  /// slots not found by resolution; value: 1
+  COBJ_STAT_RESOLVE_MISS,
+  /// resolutions answered by the cache; value: 1
+  COBJ_STAT_RESOLVE_CACHE_HIT,
+  /// method searches; value: number of candidates tested
+  COBJ_STAT_DISPATCH_CANDIDATES,
+  /// method candidates tested; value: number of traits evaluated
+  COBJ_STAT_DISPATCH_TRAITS,
+  /// method searches answered by the cache; value: 1
+  COBJ_STAT_DISPATCH_CACHE_HIT,
+  /// copies done by `memcpy` for lack of element copyer; value: bytes
+  COBJ_STAT_COPY_MEMCPY,
+  /// copies done by element copyer; value: number of elements
+  COBJ_STAT_COPY_METHOD,
+  /// tag sets skipped by their slot filters during resolution; value: 1
+  COBJ_STAT_BLOOM_SKIP,
+  /// number of metrics
+  COBJ_STAT_MAX
+};
+
+/// number of histogram buckets
+#define COBJ_STAT_BUCKETS 16
+
+/// Statistic of a metric.
+struct CObjStatMetric {
+  /// number of events
+  uint64_t events;
+  /// sum of event values
+  uint64_t total;
+  /// histogram of event values; bucket 0 counts zero, bucket `i` counts values
+  /// in [2^(i-1), 2^i), the last bucket also counts all greater values
+  uint64_t buckets[COBJ_STAT_BUCKETS];
+};
+
+/// Statistics of all metrics.
+struct CObjStats {
+  /// metrics, indexed by #CObjStat
+  struct CObjStatMetric metrics[COBJ_STAT_MAX];
+};
+
+__attribute__((nonnull, access(write_only, 1)))
+/**
+ * @memberof CObjStats
+ * @brief Take a snapshot of statistics merged from all threads, since the
+ *  last CObjStats_reset().
+ *
+ * @param[out] stats Statistics.
+ * @return @c true if statistics are available, @c false if the library is
+ *  built without `COBJ_STATS`.
+ */
+COBJ_API bool CObjStats_snapshot (struct CObjStats *stats);
+/**
+ * @memberof CObjStats
+ * @brief Reset statistics of all threads.
+ */
+COBJ_API void CObjStats_reset (void);
+__attribute__((const, warn_unused_result))
+/**
+ * @memberof CObjStats
+ * @brief Get the name of a metric.
+ *
+ * @param stat Metric.
+ * @return Name of metric, or @c NULL if not found.
+ */
+COBJ_API const char *CObjStat_name (enum CObjStat stat);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CSTATS_H */
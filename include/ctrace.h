@@ -0,0 +1,73 @@
+#ifndef CTRACE_H
+#define CTRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cobj.h"
+
+/**
+ * @file
+ * Event tracing of lookup and dispatch hot paths.
+ *
+ * Tracing is available only if the library is built with `COBJ_TRACE` defined
+ * (`make TRACE=1`); otherwise the hooks compile to nothing. Each thread records
+ * events into its own ring buffer, keeping the latest #COBJ_TRACE_RING_SIZE
+ * events. The name of the type of an event is taken when it is recorded,
+ * truncated to #COBJ_TRACE_NAME_SIZE bytes, so types may be freed before
+ * events are exported. If `sys/sdt.h` is available, USDT probes `cobj:context_init`,
+ * `cobj:resolve` and `cobj:array` are also emitted, with the type, the slot
+ * and the outcome as arguments.
+ */
+
+
+/// number of events kept per thread, power of 2
+#define COBJ_TRACE_RING_SIZE 4096
+/// bytes kept of the type name of each event, including the terminator
+#define COBJ_TRACE_NAME_SIZE 64
+
+/// Kind of traced event.
+enum CObjTraceKind {
+  /// CMethodContext_init(); outcome: its return value
+  COBJ_TRACE_CONTEXT_INIT = 0,
+  /// CObjTagArray_resolve(); outcome: 0 if resolved, 1 if resolved from cache,
+  /// -1 if not found
+  COBJ_TRACE_RESOLVE,
+  /// array method; outcome: return value of the method, or 0 if none
+  COBJ_TRACE_ARRAY,
+};
+
+/**
+ * @brief Start or stop recording events. Recording is stopped by default.
+ *
+ * @param enable Whether to record events.
+ * @return Previous state, or @c false if the library is built without
+ *  `COBJ_TRACE`.
+ */
+COBJ_API bool CObjTrace_enable (bool enable);
+/**
+ * @brief Drop all recorded events.
+ */
+COBJ_API void CObjTrace_clear (void);
+__attribute__((nonnull))
+/**
+ * @brief Write recorded events of all threads in Chrome trace event format,
+ *  which can be loaded by `chrome://tracing` and Perfetto.
+ *
+ * @param stream The stream to write to.
+ * @return Number of written events, or -1 on error.
+ */
+COBJ_API int CObjTrace_export (FILE *stream);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CTRACE_H */
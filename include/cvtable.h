@@ -0,0 +1,99 @@
+#ifndef CVTABLE_H
+#define CVTABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+#include "cobj.h"
+
+/**
+ * @file
+ * Flat, override-resolved slot tables of finalized types.
+ *
+ * CObjTagArray_finalize() merges a tag set with the tags of all its public tag
+ * sets, in the override order of CObjTagArray_resolve(), follows alias tags
+ * relative to the finalized tag set, and stores the results in a hash table.
+ * Lookups on the table never recurse.
+ */
+
+
+/// Entry of CObjVTable.
+struct CObjVTableEntry {
+  /// slot name, empty if the entry is unused
+  struct CObjSlot slot;
+  /// resolved tag data
+  const struct CObjVariant *v;
+  /// target tag set
+  const struct CObjTag *target;
+  /// absolute offset of the target tag set
+  int offset;
+};
+
+/// Finalized type.
+struct CObjVTable {
+  /// finalized tag set
+  const struct CObjTag *type;
+  /// allocator of the table
+  const struct CObjAllocator *allocator;
+  /// start of the allocation holding the table
+  void *mem;
+  /// number of used entries
+  unsigned len;
+  /// number of entries minus 1, power of 2 minus 1
+  unsigned mask;
+  /// hash table
+  struct CObjVTableEntry entries[];
+};
+
+
+__attribute__((warn_unused_result, nonnull(1), access(read_only, 1),
+               access(read_only, 2)))
+/**
+ * @memberof CObjTagArray
+ * @brief Finalize a tag set into a flat slot table.
+ *
+ * The tag set and all tag sets it refers to must stay alive and unchanged
+ * while the table is in use. The tag set need not pass CObjTagArray_validate():
+ * slots whose aliases are defective or cannot be resolved are left out.
+ *
+ * @param self Tag set.
+ * @param allocator Memory allocator, can be @c NULL.
+ * @return Slot table, or @c NULL on error with @c errno set (@c ELOOP if
+ *  public tag sets nest too deep or form a cycle).
+ */
+COBJ_API struct CObjVTable *CObjTagArray_finalize (
+  const struct CObjTag *self, const struct CObjAllocator *allocator);
+__attribute__((warn_unused_result, nonnull(1, 2), access(read_only, 1),
+               access(read_only, 2), access(write_only, 3),
+               access(write_only, 4)))
+/**
+ * @memberof CObjVTable
+ * @brief Resolve a slot name to a tag, like CObjTagArray_resolve() on the
+ *  finalized tag set.
+ *
+ * @param self Slot table.
+ * @param slot Slot name.
+ * @param[out] target The target tag set.
+ * @param[out] offset Offset of the target tag set.
+ * @return Tag data, or @c NULL if not found.
+ */
+COBJ_API const struct CObjVariant *CObjVTable_resolve (
+  const struct CObjVTable *self, const struct CObjSlot *slot,
+  const struct CObjTag **target, int *offset);
+/**
+ * @memberof CObjVTable
+ * @brief Free a slot table.
+ *
+ * @param self Slot table, can be @c NULL.
+ */
+COBJ_API void CObjVTable_free (struct CObjVTable *self);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CVTABLE_H */
@@ -39,6 +39,8 @@ $(SO_NAME): $(SHLIB)
 .PHONY: clean
 clean:
 	$(RM) $(PREREQUISITES) $(ARLIB) $(SHLIB) $(OBJS) $(PCFILE) $(LIB_NAME)
+	$(RM) $(BENCH) $(BENCH_OBJS)
+	$(RM) $(GEN) $(GEN_OBJS) $(GEN_HEADER) $(SO_NAME)
 ifneq ($(DOCDIR),)
 	$(RM) -r $(DOCDIR)
 endif
@@ -79,3 +81,27 @@ install: install-static install-header
 .PHONY: doc
 doc:
 	doxygen
+
+$(BENCH): $(BENCH_OBJS) $(ARLIB)
+	$(CC) -o $@ $^ $(LDFLAGS)
+
+# results are printed as JSON; pass options with BENCHFLAGS, see `-h`
+.PHONY: bench
+bench: $(BENCH)
+	./$(BENCH) $(BENCHFLAGS)
+
+# throughput from 1 to N threads; fails if any benchmark scales sublinearly
+.PHONY: bench-scaling
+bench-scaling: $(BENCH)
+	./$(BENCH) -s $(BENCHFLAGS)
+
+$(GEN): $(GEN_OBJS) $(SHLIB) | $(SO_NAME)
+	$(CC) -o $@ $(GEN_OBJS) -l$(PROJECT) -ldl -Wl,-rpath,'$$ORIGIN/..' \
+		$(LDFLAGS)
+
+# static lookups of built-in types; pass other types with GEN_TYPES
+$(GEN_HEADER): $(GEN)
+	./$(GEN) -o $@ $(GEN_TYPES)
+
+.PHONY: gen
+gen: $(GEN_HEADER)
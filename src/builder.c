@@ -0,0 +1,285 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/cbuilder.h"
+#include "include/cmethod.h"
+#include "utils/macro.h"
+#include "allocator.h"
+#include "slot.h"
+#include "tag.h"
+#include "vtable.h"
+
+
+/// alignment of built tag sets and their slot tables
+#define COBJ_TYPE_BUILDER_ALIGN 64
+
+struct CObjTypeBuilderTag {
+  struct CObjTag tag;
+  /// number of slots of CObjTag::path, including the terminator
+  size_t path_len;
+  unsigned hits;
+};
+
+struct CObjTypeBuilder {
+  const struct CObjAllocator *allocator;
+  struct CObjTypeBuilderTag *tags;
+  size_t len;
+  size_t cap;
+};
+
+
+struct CObjTypeBuilder *CObjTypeBuilder_new (
+    const struct CObjAllocator *allocator) {
+  struct CObjTypeBuilder *ret = CObjAllocator_malloc(allocator, sizeof(*ret));
+  return_if_fail (ret != NULL) NULL;
+  *ret = (struct CObjTypeBuilder) {.allocator = allocator};
+  return ret;
+}
+
+
+void CObjTypeBuilder_free (struct CObjTypeBuilder *self) {
+  return_if_fail (self != NULL);
+  for (size_t i = 0; i < self->len; i++) {
+    if (self->tags[i].tag.type == COBJ_TYPE_PATH) {
+      CObjAllocator_free(self->allocator, (void *) self->tags[i].tag.path);
+    }
+  }
+  CObjAllocator_free(self->allocator, self->tags);
+  CObjAllocator_free(self->allocator, self);
+}
+
+
+// check slot name and make room for a new tag
+static struct CObjTypeBuilderTag *CObjTypeBuilder_reserve (
+    struct CObjTypeBuilder *self, const struct CObjSlot *slot) {
+  should (!CObjSlot_isnull(slot)) otherwise {
+    errno = EINVAL;
+    return NULL;
+  }
+  for (size_t i = 0; i < self->len; i++) {
+    should (!CObjTag_match(&self->tags[i].tag, slot)) otherwise {
+      errno = EEXIST;
+      return NULL;
+    }
+  }
+
+  if (self->len >= self->cap) {
+    size_t cap = max(self->cap * 2, 8);
+    struct CObjTypeBuilderTag *tags = CObjAllocator_realloc(
+      self->allocator, self->tags, sizeof(tags[0]) * cap);
+    return_if_fail (tags != NULL) NULL;
+    self->tags = tags;
+    self->cap = cap;
+  }
+  return self->tags + self->len;
+}
+
+
+static int CObjTypeBuilder_add (
+    struct CObjTypeBuilder *self, const struct CObjTag *tag, unsigned hits) {
+  struct CObjTypeBuilderTag *entry = CObjTypeBuilder_reserve(self, &tag->slot);
+  return_if_fail (entry != NULL) -1;
+  *entry = (struct CObjTypeBuilderTag) {.tag = *tag, .hits = hits};
+  self->len++;
+  return 0;
+}
+
+
+int CObjTypeBuilder_add_field (
+    struct CObjTypeBuilder *self, const struct CObjSlot *slot, long value,
+    unsigned hits) {
+  should (value > 0 || !CObjSlot_equal_static(slot, "size", 0)) otherwise {
+    errno = EINVAL;
+    return -1;
+  }
+  struct CObjTag tag = {.slot = *slot, .value = value};
+  return CObjTypeBuilder_add(self, &tag, hits);
+}
+
+
+int CObjTypeBuilder_add_getter (
+    struct CObjTypeBuilder *self, const struct CObjSlot *slot, CObjFunc func,
+    unsigned hits) {
+  struct CObjTag tag = {.slot = *slot, .func = func, .type = COBJ_TYPE_FUNC};
+  return CObjTypeBuilder_add(self, &tag, hits);
+}
+
+
+int CObjTypeBuilder_add_method (
+    struct CObjTypeBuilder *self, const struct CObjSlot *slot,
+    const struct CMethod *methods, unsigned hits) {
+  should (methods->func != NULL) otherwise {
+    errno = EINVAL;
+    return -1;
+  }
+  struct CObjTag tag = {
+    .slot = *slot, .methods = methods, .type = COBJ_TYPE_CMETHODS};
+  return CObjTypeBuilder_add(self, &tag, hits);
+}
+
+
+int CObjTypeBuilder_add_super (
+    struct CObjTypeBuilder *self, const struct CObjSlot *slot,
+    const struct CObjTag *super, size_t offset, unsigned hits) {
+  should (offset <= USHRT_MAX) otherwise {
+    errno = EINVAL;
+    return -1;
+  }
+  struct CObjTag tag = {
+    .slot = *slot, .tags = super, .type = COBJ_TYPE_TAGS, .public_ = true,
+    .offset = offset};
+  return CObjTypeBuilder_add(self, &tag, hits);
+}
+
+
+int CObjTypeBuilder_add_alias (
+    struct CObjTypeBuilder *self, const struct CObjSlot *slot,
+    const struct CObjSlot *path, bool virtual_, unsigned hits) {
+  should (!CObjSlot_isnull(path)) otherwise {
+    errno = EINVAL;
+    return -1;
+  }
+  should (!CObjSlot_equal(slot, path)) otherwise {
+    errno = ELOOP;
+    return -1;
+  }
+  struct CObjTypeBuilderTag *entry = CObjTypeBuilder_reserve(self, slot);
+  return_if_fail (entry != NULL) -1;
+
+  size_t path_len = 1;
+  while (!CObjSlot_isnull(path + path_len)) {
+    path_len++;
+  }
+  path_len++;
+  struct CObjSlot *copy = CObjAllocator_malloc(
+    self->allocator, sizeof(copy[0]) * path_len);
+  return_if_fail (copy != NULL) -1;
+  memcpy(copy, path, sizeof(copy[0]) * path_len);
+
+  *entry = (struct CObjTypeBuilderTag) {
+    .tag = {.slot = *slot, .path = copy, .type = COBJ_TYPE_PATH,
+            .virtual_ = virtual_},
+    .path_len = path_len, .hits = hits};
+  self->len++;
+  return 0;
+}
+
+
+// more hits first, then in order of addition
+static int CObjTypeBuilderTag_compare (const void *a, const void *b) {
+  const struct CObjTypeBuilderTag *x = *(const struct CObjTypeBuilderTag **) a;
+  const struct CObjTypeBuilderTag *y = *(const struct CObjTypeBuilderTag **) b;
+  return x->hits != y->hits ? cmp(y->hits, x->hits) : cmp(x, y);
+}
+
+
+static inline bool CObjTypeBuilderTag_is_super (
+    const struct CObjTypeBuilderTag *self) {
+  return self->tag.type == COBJ_TYPE_TAGS;
+}
+
+
+// copy tags in final order into tags, terminated
+static void CObjTypeBuilder_order (
+    const struct CObjTypeBuilder *self,
+    const struct CObjTypeBuilderTag **order, struct CObjTag *tags) {
+  for (size_t i = 0; i < self->len; i++) {
+    order[i] = self->tags + i;
+  }
+  qsort(order, self->len, sizeof(order[0]), CObjTypeBuilderTag_compare);
+
+  // public tag sets take the places of public tag sets, in order of addition
+  size_t next_super = 0;
+  for (size_t i = 0; i < self->len; i++) {
+    continue_if_not (CObjTypeBuilderTag_is_super(order[i]));
+    while (!CObjTypeBuilderTag_is_super(self->tags + next_super)) {
+      next_super++;
+    }
+    order[i] = self->tags + next_super++;
+  }
+
+  for (size_t i = 0; i < self->len; i++) {
+    tags[i] = order[i]->tag;
+  }
+  tags[self->len] = (struct CObjTag) COBJ_TAG_END;
+}
+
+
+static inline size_t CObjTypeBuilder_align (size_t n) {
+  return (n + COBJ_TYPE_BUILDER_ALIGN - 1) & ~(size_t) (
+    COBJ_TYPE_BUILDER_ALIGN - 1);
+}
+
+
+struct CObjVTable *CObjTypeBuilder_finalize (
+    const struct CObjTypeBuilder *self, struct CObjTagError *errors, int n) {
+  size_t path_len = 0;
+  for (size_t i = 0; i < self->len; i++) {
+    path_len += self->tags[i].path_len;
+  }
+
+  // order tags in scratch memory first, to size the slot table
+  const struct CObjTypeBuilderTag **order = CObjAllocator_malloc(
+    self->allocator,
+    sizeof(order[0]) * self->len + sizeof(struct CObjTag) * (self->len + 1));
+  return_if_fail (order != NULL) NULL;
+  struct CObjTag *scratch = (struct CObjTag *) (order + self->len);
+  CObjTypeBuilder_order(self, order, scratch);
+  unsigned size = CObjVTable_size(scratch);
+  should (size > 0) otherwise {
+    CObjAllocator_free(self->allocator, order);
+    errno = ELOOP;
+    return NULL;
+  }
+
+  // tags, alias paths, then the slot table
+  size_t tags_size = sizeof(struct CObjTag) * (self->len + 1);
+  size_t vtable_offset = CObjTypeBuilder_align(
+    tags_size + sizeof(struct CObjSlot) * path_len);
+  struct CObjVTable *vtable;
+  size_t total = vtable_offset + sizeof(*vtable) +
+    sizeof(vtable->entries[0]) * size;
+  void *mem = CObjAllocator_malloc(
+    self->allocator, total + COBJ_TYPE_BUILDER_ALIGN - 1);
+  should (mem != NULL) otherwise {
+    CObjAllocator_free(self->allocator, order);
+    return NULL;
+  }
+  char *base = (char *) CObjTypeBuilder_align((uintptr_t) mem);
+
+  struct CObjTag *tags = (struct CObjTag *) base;
+  memcpy(tags, scratch, tags_size);
+  struct CObjSlot *paths = (struct CObjSlot *) (base + tags_size);
+  for (size_t i = 0; i < self->len; i++) {
+    continue_if_not (order[i]->path_len > 0);
+    memcpy(paths, tags[i].path, sizeof(paths[0]) * order[i]->path_len);
+    tags[i].path = paths;
+    paths += order[i]->path_len;
+  }
+
+  // validate before filling the table, which resolves every slot
+  int count = CObjTagArray_validate(tags, errors, n);
+  should (count == 0) otherwise {
+    // the built tag set is freed; refer to the tags of the builder instead
+    for (int i = 0; i < min(count, n); i++) {
+      continue_if_not (errors[i].tags == tags);
+      errors[i].tags = NULL;
+      if (errors[i].tag != NULL) {
+        errors[i].tag = &order[errors[i].tag - tags]->tag;
+      }
+    }
+    CObjAllocator_free(self->allocator, order);
+    CObjAllocator_free(self->allocator, mem);
+    errno = EINVAL;
+    return NULL;
+  }
+  CObjAllocator_free(self->allocator, order);
+  vtable = (struct CObjVTable *) (base + vtable_offset);
+  CObjVTable_init(vtable, size, tags, self->allocator, mem);
+  return vtable;
+}
@@ -0,0 +1,236 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "include/ccache.h"
+#include "utils/macro.h"
+#include "utils/seqlock.h"
+#include "slot.h"
+#include "tag.h"
+#include "cache.h"
+
+
+struct CObjCacheResolveEntry {
+  unsigned seq;
+  struct CObjCacheResolve data;
+} __attribute__((aligned(64)));
+
+struct CObjCacheDispatchEntry {
+  unsigned seq;
+  struct CObjCacheDispatch data;
+} __attribute__((aligned(64)));
+
+struct CObjCacheTypeInfoEntry {
+  unsigned seq;
+  struct CObjTypeInfo data;
+} __attribute__((aligned(64)));
+
+struct CObjCacheBloomEntry {
+  unsigned seq;
+  struct CObjTagBloom data;
+} __attribute__((aligned(64)));
+
+static bool cache_enabled = true;
+static struct CObjCacheResolveEntry resolve_cache[COBJ_CACHE_RESOLVE_SIZE];
+static struct CObjCacheDispatchEntry dispatch_cache[COBJ_CACHE_DISPATCH_SIZE];
+static struct CObjCacheTypeInfoEntry type_info_cache[
+  COBJ_CACHE_TYPE_INFO_SIZE];
+static struct CObjCacheBloomEntry bloom_cache[COBJ_CACHE_BLOOM_SIZE];
+
+
+static inline uint64_t mix_hash (uint64_t h) {
+  h *= 0x9e3779b97f4a7c15;
+  return h ^ (h >> 29);
+}
+
+
+bool CObjCache_isenabled (void) {
+  return __atomic_load_n(&cache_enabled, __ATOMIC_RELAXED);
+}
+
+
+static struct CObjCacheResolveEntry *CObjCacheResolve_entry (
+    const struct CObjTag *self, const struct CObjSlot *slot) {
+  uint64_t h = mix_hash((uintptr_t) self) ^ CObjSlot_hash(slot);
+  return resolve_cache + (h & (COBJ_CACHE_RESOLVE_SIZE - 1));
+}
+
+
+bool CObjCacheResolve_get (struct CObjCacheResolve *self) {
+  return_if_fail (CObjCache_isenabled()) false;
+  struct CObjCacheResolveEntry *entry =
+    CObjCacheResolve_entry(self->self, &self->slot);
+  unsigned seq = seqlock_read_begin(&entry->seq);
+  struct CObjCacheResolve data = entry->data;
+  return_if_fail (seqlock_read_end(&entry->seq, seq)) false;
+  return_if_fail (data.self == self->self &&
+                  CObjSlot_equal(&data.slot, &self->slot)) false;
+  *self = data;
+  return true;
+}
+
+
+bool CObjCacheResolve_put (const struct CObjCacheResolve *self) {
+  return_if_fail (CObjCache_isenabled()) false;
+  struct CObjCacheResolveEntry *entry =
+    CObjCacheResolve_entry(self->self, &self->slot);
+  unsigned seq;
+  return_if_fail (seqlock_write_begin(&entry->seq, &seq)) false;
+  entry->data = *self;
+  seqlock_write_end(&entry->seq, seq);
+  return true;
+}
+
+
+bool CObjCacheResolve_at (unsigned index, struct CObjCacheResolve *entry) {
+  return_if_fail (index < COBJ_CACHE_RESOLVE_SIZE) false;
+  struct CObjCacheResolveEntry *e = resolve_cache + index;
+  unsigned seq = seqlock_read_begin(&e->seq);
+  *entry = e->data;
+  return seqlock_read_end(&e->seq, seq) && entry->self != NULL;
+}
+
+
+static struct CObjCacheDispatchEntry *CObjCacheDispatch_entry (
+    const struct CMethod *methods, const struct CObjTag * const *types,
+    int len) {
+  uint64_t h = mix_hash((uintptr_t) methods);
+  for (int i = 0; i < len; i++) {
+    h = mix_hash(h ^ (uintptr_t) types[i]);
+  }
+  return dispatch_cache + (h & (COBJ_CACHE_DISPATCH_SIZE - 1));
+}
+
+
+bool CObjCacheDispatch_get (struct CObjCacheDispatch *self) {
+  return_if_fail (self->len <= COBJ_CACHE_DISPATCH_MAXLEN) false;
+  return_if_fail (CObjCache_isenabled()) false;
+  struct CObjCacheDispatchEntry *entry =
+    CObjCacheDispatch_entry(self->methods, self->types, self->len);
+  unsigned seq = seqlock_read_begin(&entry->seq);
+  struct CObjCacheDispatch data = entry->data;
+  return_if_fail (seqlock_read_end(&entry->seq, seq)) false;
+  return_if_fail (data.methods == self->methods && data.len == self->len &&
+                  memcmp(data.types, self->types,
+                         sizeof(data.types[0]) * data.len) == 0) false;
+  self->method = data.method;
+  return true;
+}
+
+
+bool CObjCacheDispatch_put (const struct CObjCacheDispatch *self) {
+  return_if_fail (self->len <= COBJ_CACHE_DISPATCH_MAXLEN) false;
+  return_if_fail (CObjCache_isenabled()) false;
+  struct CObjCacheDispatchEntry *entry =
+    CObjCacheDispatch_entry(self->methods, self->types, self->len);
+  unsigned seq;
+  return_if_fail (seqlock_write_begin(&entry->seq, &seq)) false;
+  entry->data = *self;
+  seqlock_write_end(&entry->seq, seq);
+  return true;
+}
+
+
+bool CObjCacheDispatch_at (unsigned index, struct CObjCacheDispatch *entry) {
+  return_if_fail (index < COBJ_CACHE_DISPATCH_SIZE) false;
+  struct CObjCacheDispatchEntry *e = dispatch_cache + index;
+  unsigned seq = seqlock_read_begin(&e->seq);
+  *entry = e->data;
+  return seqlock_read_end(&e->seq, seq) && entry->methods != NULL;
+}
+
+
+static struct CObjCacheTypeInfoEntry *CObjCacheTypeInfo_entry (
+    const struct CObjTag *self) {
+  return type_info_cache + (
+    mix_hash((uintptr_t) self) & (COBJ_CACHE_TYPE_INFO_SIZE - 1));
+}
+
+
+bool CObjCacheTypeInfo_get (struct CObjTypeInfo *self) {
+  return_if_fail (CObjCache_isenabled()) false;
+  struct CObjCacheTypeInfoEntry *entry = CObjCacheTypeInfo_entry(self->self);
+  unsigned seq = seqlock_read_begin(&entry->seq);
+  struct CObjTypeInfo data = entry->data;
+  return_if_fail (seqlock_read_end(&entry->seq, seq)) false;
+  return_if_fail (data.self == self->self) false;
+  *self = data;
+  return true;
+}
+
+
+void CObjCacheTypeInfo_put (const struct CObjTypeInfo *self) {
+  return_if_fail (CObjCache_isenabled());
+  struct CObjCacheTypeInfoEntry *entry = CObjCacheTypeInfo_entry(self->self);
+  unsigned seq;
+  return_if_fail (seqlock_write_begin(&entry->seq, &seq));
+  entry->data = *self;
+  seqlock_write_end(&entry->seq, seq);
+}
+
+
+static struct CObjCacheBloomEntry *CObjCacheBloom_entry (
+    const struct CObjTag *self) {
+  return bloom_cache + (
+    mix_hash((uintptr_t) self) & (COBJ_CACHE_BLOOM_SIZE - 1));
+}
+
+
+bool CObjCacheBloom_get (struct CObjTagBloom *self) {
+  return_if_fail (CObjCache_isenabled()) false;
+  struct CObjCacheBloomEntry *entry = CObjCacheBloom_entry(self->self);
+  unsigned seq = seqlock_read_begin(&entry->seq);
+  struct CObjTagBloom data = entry->data;
+  return_if_fail (seqlock_read_end(&entry->seq, seq)) false;
+  return_if_fail (data.self == self->self) false;
+  *self = data;
+  return true;
+}
+
+
+void CObjCacheBloom_put (const struct CObjTagBloom *self) {
+  return_if_fail (CObjCache_isenabled());
+  struct CObjCacheBloomEntry *entry = CObjCacheBloom_entry(self->self);
+  unsigned seq;
+  return_if_fail (seqlock_write_begin(&entry->seq, &seq));
+  entry->data = *self;
+  seqlock_write_end(&entry->seq, seq);
+}
+
+
+bool CObjCache_enable (bool enable) {
+  return __atomic_exchange_n(&cache_enabled, enable, __ATOMIC_RELAXED);
+}
+
+
+void CObjCache_clear (void) {
+  for (unsigned i = 0; i < COBJ_CACHE_RESOLVE_SIZE; i++) {
+    struct CObjCacheResolveEntry *entry = resolve_cache + i;
+    unsigned seq;
+    while (!seqlock_write_begin(&entry->seq, &seq)) { }
+    entry->data.self = NULL;
+    seqlock_write_end(&entry->seq, seq);
+  }
+  for (unsigned i = 0; i < COBJ_CACHE_DISPATCH_SIZE; i++) {
+    struct CObjCacheDispatchEntry *entry = dispatch_cache + i;
+    unsigned seq;
+    while (!seqlock_write_begin(&entry->seq, &seq)) { }
+    entry->data.methods = NULL;
+    seqlock_write_end(&entry->seq, seq);
+  }
+  for (unsigned i = 0; i < COBJ_CACHE_TYPE_INFO_SIZE; i++) {
+    struct CObjCacheTypeInfoEntry *entry = type_info_cache + i;
+    unsigned seq;
+    while (!seqlock_write_begin(&entry->seq, &seq)) { }
+    entry->data.self = NULL;
+    seqlock_write_end(&entry->seq, seq);
+  }
+  for (unsigned i = 0; i < COBJ_CACHE_BLOOM_SIZE; i++) {
+    struct CObjCacheBloomEntry *entry = bloom_cache + i;
+    unsigned seq;
+    while (!seqlock_write_begin(&entry->seq, &seq)) { }
+    entry->data.self = NULL;
+    seqlock_write_end(&entry->seq, seq);
+  }
+  CObjTagArray_clear_validated();
+}
@@ -0,0 +1,260 @@
+#ifndef COBJ_CACHE_H
+#define COBJ_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "include/cmethod.h"
+
+
+/// number of entries in the resolution cache, must be power of 2
+#define COBJ_CACHE_RESOLVE_SIZE 1024
+/// number of entries in the dispatch cache, must be power of 2
+#define COBJ_CACHE_DISPATCH_SIZE 512
+/// maximum number of argument types of a cached dispatch
+#define COBJ_CACHE_DISPATCH_MAXLEN 4
+/// number of entries in the type info cache, must be power of 2
+#define COBJ_CACHE_TYPE_INFO_SIZE 512
+/// number of entries in the slot filter cache, must be power of 2
+#define COBJ_CACHE_BLOOM_SIZE 1024
+/// number of 64-bit blocks of a slot filter, must be power of 2
+#define COBJ_BLOOM_WORDS 4
+
+/// Cached result of CObjTagArray_resolve().
+struct CObjCacheResolve {
+  /// tag set
+  const struct CObjTag *self;
+  /// slot name
+  struct CObjSlot slot;
+  /// resolved tag data, or @c NULL if not found
+  const struct CObjVariant *v;
+  /// target tag set
+  const struct CObjTag *target;
+  /// offset of the target tag set
+  int offset;
+};
+
+/// Cached result of CMethodArray_find().
+struct CObjCacheDispatch {
+  /// method descriptor array
+  const struct CMethod *methods;
+  /// type objects
+  const struct CObjTag *types[COBJ_CACHE_DISPATCH_MAXLEN];
+  /// length of CObjCacheDispatch::types
+  int len;
+  /// found method descriptor, or @c NULL if not found
+  const struct CMethod *method;
+};
+
+
+struct CObjAllocator;
+
+/// Core protocol methods of a type.
+enum CObjTypeMethod {
+  /// `isnull`, of argument types (T)
+  COBJ_TYPE_METHOD_ISNULL = 0,
+  /// `len`, of argument types (T)
+  COBJ_TYPE_METHOD_LEN,
+  /// `init`, of argument types (T, T)
+  COBJ_TYPE_METHOD_INIT,
+  /// `destroy`, of argument types (T)
+  COBJ_TYPE_METHOD_DESTROY,
+  /// `move`, of argument types (T, T)
+  COBJ_TYPE_METHOD_MOVE,
+  /// number of methods
+  COBJ_TYPE_METHOD_MAX
+};
+
+/// Method resolved by CMethodContext_init().
+struct CObjTypeInfoMethod {
+  /// return value of CMethodContext_init()
+  int res;
+  /// CMethodContext::func
+  CObjFunc func;
+  /// CMethodContext::userdata
+  void *userdata;
+  /// CMethodContext::traits
+  const struct CObjTrait *traits;
+  /// CMethodContext::target
+  const struct CObjTag *target;
+  /// CMethodContext::offset
+  int offset;
+};
+
+/// Core protocol slots of a type, resolved at once.
+struct CObjTypeInfo {
+  /// tag set
+  const struct CObjTag *self;
+  /// `super`, or @c NULL
+  const struct CObjTag *super;
+  /// `size`, unless CObjTypeInfo::size_getter
+  long size;
+  /// `allocator`, unless CObjTypeInfo::allocator_getter
+  const struct CObjAllocator *allocator;
+  /// whether `size` is computed from the object
+  bool size_getter;
+  /// whether `allocator` is computed from the object
+  bool allocator_getter;
+  /// methods, indexed by #CObjTypeMethod
+  struct CObjTypeInfoMethod methods[COBJ_TYPE_METHOD_MAX];
+};
+
+/// Blocked bloom filters of the slots of a tag set.
+struct CObjTagBloom {
+  /// tag set
+  const struct CObjTag *self;
+  /// slots of the tag set itself
+  uint64_t own[COBJ_BLOOM_WORDS];
+  /// slots of the tag set and its public tag sets, recursively
+  uint64_t all[COBJ_BLOOM_WORDS];
+};
+
+
+#ifdef COBJ_HEADER_ONLY
+
+// caches are shared by the library; inlined lookups do without
+static inline bool CObjCache_isenabled (void) {
+  return false;
+}
+static inline bool CObjCacheResolve_get (struct CObjCacheResolve *self) {
+  (void) self;
+  return false;
+}
+static inline bool CObjCacheResolve_put (
+    const struct CObjCacheResolve *self) {
+  (void) self;
+  return false;
+}
+static inline bool CObjCacheDispatch_get (struct CObjCacheDispatch *self) {
+  (void) self;
+  return false;
+}
+static inline bool CObjCacheDispatch_put (
+    const struct CObjCacheDispatch *self) {
+  (void) self;
+  return false;
+}
+static inline bool CObjCacheTypeInfo_get (struct CObjTypeInfo *self) {
+  (void) self;
+  return false;
+}
+static inline void CObjCacheTypeInfo_put (const struct CObjTypeInfo *self) {
+  (void) self;
+}
+
+#else
+
+__attribute__((warn_unused_result))
+/**
+ * @brief Check whether caches are enabled.
+ *
+ * @return @c true if enabled.
+ */
+bool CObjCache_isenabled (void);
+
+__attribute__((warn_unused_result, nonnull))
+/**
+ * @memberof CObjCacheResolve
+ * @brief Look up a cached resolution.
+ *
+ * @param[in,out] self Cache entry, with CObjCacheResolve::self and
+ *  CObjCacheResolve::slot set.
+ * @return @c true if found.
+ */
+bool CObjCacheResolve_get (struct CObjCacheResolve *self);
+__attribute__((nonnull, access(read_only, 1)))
+/**
+ * @memberof CObjCacheResolve
+ * @brief Store a resolution into the cache.
+ *
+ * The entry replaces any other in its slot. It is dropped while caches are
+ * disabled or the slot is being written by another thread.
+ *
+ * @param self Cache entry.
+ * @return @c true if stored.
+ */
+bool CObjCacheResolve_put (const struct CObjCacheResolve *self);
+__attribute__((warn_unused_result, nonnull(2), access(write_only, 2)))
+/**
+ * @memberof CObjCacheResolve
+ * @brief Read the @p index -th entry of the cache.
+ *
+ * @param index Index of entry.
+ * @param[out] entry Cache entry.
+ * @return @c true if the entry is occupied.
+ */
+bool CObjCacheResolve_at (unsigned index, struct CObjCacheResolve *entry);
+
+__attribute__((warn_unused_result, nonnull))
+/**
+ * @memberof CObjCacheDispatch
+ * @brief Look up a cached dispatch.
+ *
+ * @param[in,out] self Cache entry, with CObjCacheDispatch::methods,
+ *  CObjCacheDispatch::types and CObjCacheDispatch::len set.
+ * @return @c true if found.
+ */
+bool CObjCacheDispatch_get (struct CObjCacheDispatch *self);
+__attribute__((nonnull, access(read_only, 1)))
+/**
+ * @memberof CObjCacheDispatch
+ * @brief Store a dispatch into the cache.
+ *
+ * The entry replaces any other in its slot. It is dropped while caches are
+ * disabled or the slot is being written by another thread.
+ *
+ * @param self Cache entry.
+ * @return @c true if stored.
+ */
+bool CObjCacheDispatch_put (const struct CObjCacheDispatch *self);
+__attribute__((warn_unused_result, nonnull(2), access(write_only, 2)))
+/**
+ * @memberof CObjCacheDispatch
+ * @brief Read the @p index -th entry of the cache.
+ *
+ * @param index Index of entry.
+ * @param[out] entry Cache entry.
+ * @return @c true if the entry is occupied.
+ */
+bool CObjCacheDispatch_at (unsigned index, struct CObjCacheDispatch *entry);
+
+__attribute__((warn_unused_result, nonnull))
+/**
+ * @memberof CObjTypeInfo
+ * @brief Look up cached type info.
+ *
+ * @param[in,out] self Type info, with CObjTypeInfo::self set.
+ * @return @c true if found.
+ */
+bool CObjCacheTypeInfo_get (struct CObjTypeInfo *self);
+__attribute__((nonnull, access(read_only, 1)))
+/**
+ * @memberof CObjTypeInfo
+ * @brief Store type info into the cache.
+ *
+ * @param self Type info.
+ */
+void CObjCacheTypeInfo_put (const struct CObjTypeInfo *self);
+
+__attribute__((warn_unused_result, nonnull))
+/**
+ * @memberof CObjTagBloom
+ * @brief Look up the slot filters of a tag set.
+ *
+ * @param[in,out] self Slot filters, with CObjTagBloom::self set.
+ * @return @c true if found.
+ */
+bool CObjCacheBloom_get (struct CObjTagBloom *self);
+__attribute__((nonnull, access(read_only, 1)))
+/**
+ * @memberof CObjTagBloom
+ * @brief Store slot filters into the cache.
+ *
+ * @param self Slot filters.
+ */
+void CObjCacheBloom_put (const struct CObjTagBloom *self);
+
+
+#endif
+
+#endif /* COBJ_CACHE_H */
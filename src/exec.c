@@ -0,0 +1,467 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "include/cexec.h"
+#include "utils/macro.h"
+
+
+/// initial capacity of a deque
+#define DEQUE_MIN_CAP 64
+
+
+struct CObjTaskEntry {
+  struct CObjTask task;
+  struct CObjTaskGroup *group;
+};
+
+/// Task deque of a worker; the owner takes from the back, thieves from the
+/// front.
+struct CObjDeque {
+  pthread_mutex_t lock;
+  /// ring buffer
+  struct CObjTaskEntry *data;
+  /// capacity of CObjDeque::data, a power of 2
+  size_t cap;
+  /// index of the front entry
+  size_t head;
+  /// number of entries
+  size_t len;
+} __attribute__((aligned(64)));
+
+struct CObjWorker {
+  struct CObjExecutor *executor;
+  struct CObjDeque deque;
+  pthread_t thread;
+  /// index in CObjExecutor::workers
+  int index;
+};
+
+struct CObjExecutor {
+  /// number of queued tasks in all deques
+  size_t queued;
+  /// number of workers going to sleep or asleep
+  int sleepers;
+  /// workers exit when there is no queued task
+  bool stop;
+  /// rotates the first worker of external submissions
+  unsigned next;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  int len;
+  struct CObjWorker workers[];
+};
+
+struct CObjTaskGroup {
+  struct CObjExecutor *executor;
+  /// unfinished tasks, plus 1 held until CObjTaskGroup_wait()
+  size_t pending;
+  /// number of failed tasks
+  size_t failed;
+  /// first nonzero status
+  int error;
+  /// set by the task that finishes last
+  bool done;
+  pthread_mutex_t lock;
+  pthread_cond_t finish;
+};
+
+
+/// worker of the current thread, if any
+static _Thread_local struct CObjWorker *current_worker;
+
+
+/******** deque ********/
+
+static int CObjDeque_init (struct CObjDeque *self) {
+  self->data = NULL;
+  self->cap = 0;
+  self->head = 0;
+  self->len = 0;
+  return pthread_mutex_init(&self->lock, NULL) == 0 ? 0 : -1;
+}
+
+
+static void CObjDeque_destroy (struct CObjDeque *self) {
+  free(self->data);
+  pthread_mutex_destroy(&self->lock);
+}
+
+
+// lock must be held
+static int CObjDeque_reserve (struct CObjDeque *self, size_t len) {
+  size_t need = self->len + len;
+  return_if (need <= self->cap) 0;
+
+  size_t cap = max(self->cap, DEQUE_MIN_CAP);
+  while (cap < need) {
+    return_if_fail (cap <= SIZE_MAX / 2 / sizeof(self->data[0])) -1;
+    cap *= 2;
+  }
+  struct CObjTaskEntry *data = malloc(sizeof(data[0]) * cap);
+  return_if_fail (data != NULL) -1;
+
+  // unwrap the ring
+  size_t first = min(self->len, self->cap - self->head);
+  if (self->len > 0) {
+    memcpy(data, self->data + self->head, sizeof(data[0]) * first);
+    memcpy(data + first, self->data, sizeof(data[0]) * (self->len - first));
+  }
+  free(self->data);
+  self->data = data;
+  self->cap = cap;
+  self->head = 0;
+  return 0;
+}
+
+
+// lock must be held, and space reserved
+static void CObjDeque_push (
+    struct CObjDeque *self, const struct CObjTask *tasks, size_t len,
+    struct CObjTaskGroup *group) {
+  for (size_t i = 0; i < len; i++) {
+    struct CObjTaskEntry *entry =
+      self->data + ((self->head + self->len + i) & (self->cap - 1));
+    entry->task = tasks[i];
+    entry->group = group;
+  }
+  __atomic_store_n(&self->len, self->len + len, __ATOMIC_RELAXED);
+}
+
+
+static bool CObjDeque_pop (
+    struct CObjDeque *self, bool back, struct CObjTaskEntry *entry) {
+  // racy peek, to avoid locking empty deques
+  return_if (__atomic_load_n(&self->len, __ATOMIC_RELAXED) == 0) false;
+
+  pthread_mutex_lock(&self->lock);
+  bool ret = self->len > 0;
+  if (ret) {
+    __atomic_store_n(&self->len, self->len - 1, __ATOMIC_RELAXED);
+    if (back) {
+      *entry = self->data[(self->head + self->len) & (self->cap - 1)];
+    } else {
+      *entry = self->data[self->head];
+      self->head = (self->head + 1) & (self->cap - 1);
+    }
+  }
+  pthread_mutex_unlock(&self->lock);
+  return ret;
+}
+
+
+/******** executor ********/
+
+// take a task, from the own deque of worker first if any, then from others
+static bool CObjExecutor_take (
+    struct CObjExecutor *self, struct CObjWorker *worker,
+    struct CObjTaskEntry *entry) {
+  int start = 0;
+  if (worker != NULL) {
+    if (CObjDeque_pop(&worker->deque, true, entry)) {
+      __atomic_fetch_sub(&self->queued, 1, __ATOMIC_RELAXED);
+      return true;
+    }
+    start = worker->index + 1;
+  }
+  for (int i = 0; i < self->len; i++) {
+    struct CObjWorker *victim = self->workers + (start + i) % self->len;
+    continue_if (victim == worker);
+    if (CObjDeque_pop(&victim->deque, false, entry)) {
+      __atomic_fetch_sub(&self->queued, 1, __ATOMIC_RELAXED);
+      return true;
+    }
+  }
+  return false;
+}
+
+
+static void CObjTaskEntry_run (struct CObjTaskEntry *self) {
+  struct CObjTask *task = &self->task;
+  struct CObjTaskGroup *group = self->group;
+
+  if (task->status == NULL) {
+    if (task->context.len >= 2) {
+      task->context.func(task->self, task->other, &task->context);
+    } else {
+      task->context.func(task->self, &task->context);
+    }
+  } else {
+    int status = task->context.len >= 2 ?
+      ((int (*) ()) task->context.func)(
+        task->self, task->other, &task->context) :
+      ((int (*) ()) task->context.func)(task->self, &task->context);
+    *task->status = status;
+    if (status != 0) {
+      __atomic_fetch_add(&group->failed, 1, __ATOMIC_RELAXED);
+      int expected = 0;
+      __atomic_compare_exchange_n(
+        &group->error, &expected, status, false, __ATOMIC_RELAXED,
+        __ATOMIC_RELAXED);
+    }
+  }
+
+  // the group may be freed as soon as this is not the last task
+  return_if (__atomic_sub_fetch(
+    &group->pending, 1, __ATOMIC_ACQ_REL) != 0);
+  pthread_mutex_lock(&group->lock);
+  group->done = true;
+  pthread_cond_broadcast(&group->finish);
+  pthread_mutex_unlock(&group->lock);
+}
+
+
+static void *CObjWorker_main (void *arg) {
+  struct CObjWorker *self = arg;
+  struct CObjExecutor *executor = self->executor;
+  current_worker = self;
+
+  while (1) {
+    struct CObjTaskEntry entry;
+    if (CObjExecutor_take(executor, self, &entry)) {
+      CObjTaskEntry_run(&entry);
+      continue;
+    }
+
+    // announce sleeping before the last check, so that a submitter either
+    // sees the sleeper or the sleeper sees the task
+    pthread_mutex_lock(&executor->lock);
+    __atomic_fetch_add(&executor->sleepers, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&executor->queued, __ATOMIC_SEQ_CST) == 0 &&
+           !executor->stop) {
+      pthread_cond_wait(&executor->wake, &executor->lock);
+    }
+    __atomic_fetch_sub(&executor->sleepers, 1, __ATOMIC_RELAXED);
+    bool stop = executor->stop &&
+      __atomic_load_n(&executor->queued, __ATOMIC_SEQ_CST) == 0;
+    pthread_mutex_unlock(&executor->lock);
+    break_if (stop);
+  }
+  return NULL;
+}
+
+
+static void CObjExecutor_notify (struct CObjExecutor *self, size_t len) {
+  return_if (__atomic_load_n(&self->sleepers, __ATOMIC_SEQ_CST) == 0);
+  pthread_mutex_lock(&self->lock);
+  if (len == 1) {
+    pthread_cond_signal(&self->wake);
+  } else {
+    pthread_cond_broadcast(&self->wake);
+  }
+  pthread_mutex_unlock(&self->lock);
+}
+
+
+// stop and join the first len workers, and release all workers
+static void CObjExecutor_shutdown (struct CObjExecutor *self, int len) {
+  pthread_mutex_lock(&self->lock);
+  self->stop = true;
+  pthread_cond_broadcast(&self->wake);
+  pthread_mutex_unlock(&self->lock);
+  for (int i = 0; i < len; i++) {
+    pthread_join(self->workers[i].thread, NULL);
+  }
+  for (int i = 0; i < self->len; i++) {
+    CObjDeque_destroy(&self->workers[i].deque);
+  }
+  pthread_cond_destroy(&self->wake);
+  pthread_mutex_destroy(&self->lock);
+  free(self);
+}
+
+
+struct CObjExecutor *CObjExecutor_new (int threads) {
+  if (threads <= 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? cpus : 1;
+  }
+
+  struct CObjExecutor *self =
+    calloc(1, sizeof(*self) + sizeof(self->workers[0]) * threads);
+  return_if_fail (self != NULL) NULL;
+  should (pthread_mutex_init(&self->lock, NULL) == 0) otherwise {
+    free(self);
+    errno = ENOMEM;
+    return NULL;
+  }
+  should (pthread_cond_init(&self->wake, NULL) == 0) otherwise {
+    pthread_mutex_destroy(&self->lock);
+    free(self);
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  for (int i = 0; i < threads; i++) {
+    struct CObjWorker *worker = self->workers + i;
+    worker->executor = self;
+    worker->index = i;
+    should (CObjDeque_init(&worker->deque) == 0) otherwise {
+      self->len = i;
+      CObjExecutor_shutdown(self, 0);
+      errno = ENOMEM;
+      return NULL;
+    }
+  }
+  self->len = threads;
+
+  for (int i = 0; i < threads; i++) {
+    int err = pthread_create(
+      &self->workers[i].thread, NULL, CObjWorker_main, self->workers + i);
+    should (err == 0) otherwise {
+      CObjExecutor_shutdown(self, i);
+      errno = err;
+      return NULL;
+    }
+  }
+  return self;
+}
+
+
+void CObjExecutor_free (struct CObjExecutor *self) {
+  return_if_fail (self != NULL);
+  CObjExecutor_shutdown(self, self->len);
+}
+
+
+int CObjExecutor_threads (const struct CObjExecutor *self) {
+  return self->len;
+}
+
+
+/******** task group ********/
+
+struct CObjTaskGroup *CObjTaskGroup_new (struct CObjExecutor *executor) {
+  struct CObjTaskGroup *self = malloc(sizeof(*self));
+  return_if_fail (self != NULL) NULL;
+  self->executor = executor;
+  self->pending = 1;
+  self->failed = 0;
+  self->error = 0;
+  self->done = false;
+  should (pthread_mutex_init(&self->lock, NULL) == 0) otherwise {
+    free(self);
+    errno = ENOMEM;
+    return NULL;
+  }
+  should (pthread_cond_init(&self->finish, NULL) == 0) otherwise {
+    pthread_mutex_destroy(&self->lock);
+    free(self);
+    errno = ENOMEM;
+    return NULL;
+  }
+  return self;
+}
+
+
+void CObjTaskGroup_free (struct CObjTaskGroup *self) {
+  return_if_fail (self != NULL);
+  (void) CObjTaskGroup_wait(self, NULL);
+  pthread_cond_destroy(&self->finish);
+  pthread_mutex_destroy(&self->lock);
+  free(self);
+}
+
+
+// the analyzer loses track of buffers stored into deques of computed index
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wanalyzer-malloc-leak"
+int CObjTaskGroup_submit (
+    struct CObjTaskGroup *self, const struct CObjTask *tasks, size_t len) {
+  return_if (len == 0) 0;
+  struct CObjExecutor *executor = self->executor;
+  struct CObjWorker *worker = current_worker;
+
+  if (worker != NULL && worker->executor == executor) {
+    // keep nested work local; idle workers steal it
+    struct CObjDeque *deque = &worker->deque;
+    pthread_mutex_lock(&deque->lock);
+    should (CObjDeque_reserve(deque, len) == 0) otherwise {
+      pthread_mutex_unlock(&deque->lock);
+      return -1;
+    }
+    __atomic_fetch_add(&self->pending, len, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&executor->queued, len, __ATOMIC_SEQ_CST);
+    CObjDeque_push(deque, tasks, len, self);
+    pthread_mutex_unlock(&deque->lock);
+  } else {
+    // spread evenly over n workers from a rotating start, one lock per worker;
+    // reserve all first so that a failure submits nothing
+    int n = min((size_t) executor->len, len);
+    unsigned start =
+      __atomic_fetch_add(&executor->next, n, __ATOMIC_RELAXED) %
+      executor->len;
+    // lock in index order, against concurrent submitters
+    for (int i = 0; i < executor->len; i++) {
+      unsigned offset = (i + executor->len - start) % executor->len;
+      continue_if (offset >= (unsigned) n);
+      pthread_mutex_lock(&executor->workers[i].deque.lock);
+    }
+    int res = 0;
+    for (int i = 0; i < n && res == 0; i++) {
+      struct CObjDeque *deque =
+        &executor->workers[(start + i) % executor->len].deque;
+      res = CObjDeque_reserve(deque, len * (i + 1) / n - len * i / n);
+    }
+    if (res == 0) {
+      __atomic_fetch_add(&self->pending, len, __ATOMIC_RELAXED);
+      __atomic_fetch_add(&executor->queued, len, __ATOMIC_SEQ_CST);
+      for (int i = 0; i < n; i++) {
+        struct CObjDeque *deque =
+          &executor->workers[(start + i) % executor->len].deque;
+        size_t begin = len * i / n;
+        CObjDeque_push(deque, tasks + begin, len * (i + 1) / n - begin, self);
+      }
+    }
+    for (int i = executor->len - 1; i >= 0; i--) {
+      unsigned offset = (i + executor->len - start) % executor->len;
+      continue_if (offset >= (unsigned) n);
+      pthread_mutex_unlock(&executor->workers[i].deque.lock);
+    }
+    return_if_fail (res == 0) -1;
+  }
+
+  CObjExecutor_notify(executor, len);
+  return 0;
+}
+#pragma GCC diagnostic pop
+
+
+size_t CObjTaskGroup_wait (struct CObjTaskGroup *self, int *error) {
+  struct CObjExecutor *executor = self->executor;
+  struct CObjWorker *worker = current_worker;
+  if (worker != NULL && worker->executor != executor) {
+    worker = NULL;
+  }
+
+  // help while tasks are pending
+  while (__atomic_load_n(&self->pending, __ATOMIC_ACQUIRE) > 1) {
+    struct CObjTaskEntry entry;
+    break_if (!CObjExecutor_take(executor, worker, &entry));
+    CObjTaskEntry_run(&entry);
+  }
+
+  // drop the reference of the group; if tasks remain, the last one signals
+  if (__atomic_sub_fetch(&self->pending, 1, __ATOMIC_ACQ_REL) != 0) {
+    pthread_mutex_lock(&self->lock);
+    while (!self->done) {
+      pthread_cond_wait(&self->finish, &self->lock);
+    }
+    pthread_mutex_unlock(&self->lock);
+  }
+
+  size_t ret = self->failed;
+  if (error != NULL) {
+    *error = self->error;
+  }
+  self->pending = 1;
+  self->failed = 0;
+  self->error = 0;
+  self->done = false;
+  return ret;
+}
@@ -0,0 +1,119 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "include/chuge.h"
+#include "utils/macro.h"
+
+
+/// bytes at the start of a mapping reserved for its header
+#define COBJ_HUGE_HEADER_SIZE 64
+/// size of transparent huge pages, below which they are not requested
+#define COBJ_HUGE_PAGE_SIZE ((size_t) 2 * 1024 * 1024)
+
+/// Header of a mapping.
+struct CObjHugeHeader {
+  /// length of the mapping
+  size_t len;
+  /// bytes of the mapping still backed by pages
+  size_t used;
+};
+
+_Static_assert(sizeof(struct CObjHugeHeader) <= COBJ_HUGE_HEADER_SIZE,
+               "mapping header too large");
+
+
+static inline struct CObjHugeHeader *CObjHuge_header (void *ptr) {
+  return (struct CObjHugeHeader *) ((char *) ptr - COBJ_HUGE_HEADER_SIZE);
+}
+
+
+// bytes to map for size bytes of memory, or 0 on overflow
+static inline size_t CObjHuge_len (size_t size) {
+  size_t page = sysconf(_SC_PAGESIZE);
+  return_if_fail (size <= SIZE_MAX - COBJ_HUGE_HEADER_SIZE - page) 0;
+  return (size + COBJ_HUGE_HEADER_SIZE + page - 1) & ~(page - 1);
+}
+
+
+static inline void CObjHuge_advise (void *mem, size_t len) {
+#ifdef MADV_HUGEPAGE
+  // only a hint; fails if transparent huge pages are disabled
+  if (len >= COBJ_HUGE_PAGE_SIZE) {
+    madvise(mem, len, MADV_HUGEPAGE);
+  }
+#else
+  (void) mem;
+  (void) len;
+#endif
+}
+
+
+void *CObjHuge_malloc (size_t size) {
+  size_t len = CObjHuge_len(size);
+  should (len != 0) otherwise {
+    errno = ENOMEM;
+    return NULL;
+  }
+  void *mem = mmap(
+    NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return_if_fail (mem != MAP_FAILED) NULL;
+  CObjHuge_advise(mem, len);
+  *(struct CObjHugeHeader *) mem = (struct CObjHugeHeader) {len, len};
+  return (char *) mem + COBJ_HUGE_HEADER_SIZE;
+}
+
+
+void *CObjHuge_realloc (void *ptr, size_t size) {
+  return_if_fail (ptr != NULL) CObjHuge_malloc(size);
+  struct CObjHugeHeader *header = CObjHuge_header(ptr);
+  size_t len = CObjHuge_len(size);
+  should (len != 0) otherwise {
+    errno = ENOMEM;
+    return NULL;
+  }
+
+  if (len <= header->len) {
+    // give back the pages of the tail, the mapping stays for regrowth
+    if (len < header->used) {
+      should (madvise((char *) header + len, header->used - len,
+                      MADV_DONTNEED) == 0) otherwise {
+        return ptr;
+      }
+    }
+    header->used = len;
+    return ptr;
+  }
+
+#ifdef MREMAP_MAYMOVE
+  void *mem = mremap(header, header->len, len, MREMAP_MAYMOVE);
+  return_if_fail (mem != MAP_FAILED) NULL;
+#else
+  void *mem = mmap(
+    NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return_if_fail (mem != MAP_FAILED) NULL;
+  memcpy(mem, header, header->used);
+  munmap(header, header->len);
+#endif
+  CObjHuge_advise(mem, len);
+  *(struct CObjHugeHeader *) mem = (struct CObjHugeHeader) {len, len};
+  return (char *) mem + COBJ_HUGE_HEADER_SIZE;
+}
+
+
+void CObjHuge_free (void *ptr) {
+  return_if_fail (ptr != NULL);
+  struct CObjHugeHeader *header = CObjHuge_header(ptr);
+  munmap(header, header->len);
+}
+
+
+const struct CObjAllocator CObjHuge_allocator = {
+  .malloc = CObjHuge_malloc,
+  .realloc = CObjHuge_realloc,
+  .free = CObjHuge_free,
+};
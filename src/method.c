@@ -1,9 +1,13 @@
 #include <stdarg.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "include/cmethod.h"
 #include "utils/macro.h"
+#include "cache.h"
 #include "slot.h"
+#include "stats.h"
+#include "trace.h"
 #include "variant.h"
 #include "method.h"
 
@@ -84,20 +88,48 @@ bool CObjTrait_match (
 
 bool CMethod_match (
     const struct CMethod *self, const struct CObjTag **types, int len) {
-  for (const struct CObjTrait *trait = self->traits;
-       !CObjTrait_isnull(trait); trait++) {
-    return_if_fail (CObjTrait_match(trait, types, len)) false;
+  return_if (self->traits == NULL) true;
+  for (const struct CObjTrait *trait = self->traits; ; trait++) {
+    if (CObjTrait_isnull(trait)) {
+      COBJ_STATS_RECORD(COBJ_STAT_DISPATCH_TRAITS, trait - self->traits);
+      return true;
+    }
+    if unlikely (!CObjTrait_match(trait, types, len)) {
+      COBJ_STATS_RECORD(COBJ_STAT_DISPATCH_TRAITS, trait - self->traits + 1);
+      return false;
+    }
+  }
+}
+
+
+static const struct CMethod *_CMethodArray_find (
+    const struct CMethod *self, const struct CObjTag **types, int len) {
+  for (const struct CMethod *method = self; ; method++) {
+    if unlikely (method->func == NULL) {
+      COBJ_STATS_RECORD(COBJ_STAT_DISPATCH_CANDIDATES, method - self);
+      return NULL;
+    }
+    if (CMethod_match(method, types, len)) {
+      COBJ_STATS_RECORD(COBJ_STAT_DISPATCH_CANDIDATES, method - self + 1);
+      return method;
+    }
   }
-  return true;
 }
 
 
 const struct CMethod *CMethodArray_find (
     const struct CMethod *self, const struct CObjTag **types, int len) {
-  for (; self->func != NULL; self++) {
-    return_if (CMethod_match(self, types, len)) self;
+  return_if_fail (0 <= len && len <= COBJ_CACHE_DISPATCH_MAXLEN)
+    _CMethodArray_find(self, types, len);
+  struct CObjCacheDispatch entry = {.methods = self, .len = len};
+  memcpy(entry.types, types, sizeof(types[0]) * len);
+  if (CObjCacheDispatch_get(&entry)) {
+    COBJ_STATS_RECORD(COBJ_STAT_DISPATCH_CACHE_HIT, 1);
+  } else {
+    entry.method = _CMethodArray_find(self, types, len);
+    CObjCacheDispatch_put(&entry);
   }
-  return NULL;
+  return entry.method;
 }
 
 
@@ -122,7 +154,7 @@ const struct CMethod *CMethodArray_finds (const struct CMethod *self, ...) {
 }
 
 
-int CMethodContext_init (
+static int _CMethodContext_init (
     struct CMethodContext *self, const struct CObjSlot *slot) {
   const struct CObjTag **types = self->types;
   int len = self->len;
@@ -152,3 +184,14 @@ int CMethodContext_init (
   }
   return 0;
 }
+
+
+int CMethodContext_init (
+    struct CMethodContext *self, const struct CObjSlot *slot) {
+  COBJ_TRACE_BEGIN(begin);
+  int ret = _CMethodContext_init(self, slot);
+  COBJ_TRACE_END(
+    begin, COBJ_TRACE_CONTEXT_INIT, context_init,
+    self->len > 0 ? self->types[0] : NULL, slot, ret);
+  return ret;
+}
@@ -31,7 +31,7 @@ __attribute__((pure, warn_unused_result, nonnull(1),
  * @param len Length of @p types.
  * @return @c true if match.
  */
-bool CMethod_match (
+COBJ_CORE_LOCAL bool CMethod_match (
   const struct CMethod *self, const struct CObjTag **types, int len);
 
 
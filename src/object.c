@@ -0,0 +1,44 @@
+#include <stdbool.h>
+
+#include "include/cobject.h"
+#include "utils/macro.h"
+#include "utils/seqlock.h"
+#include "slot.h"
+#include "stats.h"
+
+
+int CObj_context_init (
+    const void *self, const struct CObjSlot *slot,
+    struct CMethodContext *ctx) {
+  struct CObjType *type = ((const struct CObjHeader *) self)->type;
+  ctx->types = (const struct CObjTag **) &type->tags;
+  ctx->len = 1;
+
+  struct CObjTypeCacheEntry *entry =
+    type->cache + (CObjSlot_hash(slot) & (COBJ_TYPE_CACHE_SIZE - 1));
+  unsigned seq = seqlock_read_begin(&entry->seq);
+  struct CObjTypeCacheEntry data = *entry;
+  if (seqlock_read_end(&entry->seq, seq) &&
+      CObjSlot_equal(&data.slot, slot)) {
+    COBJ_STATS_RECORD(COBJ_STAT_DISPATCH_CACHE_HIT, 1);
+    ctx->func = data.func;
+    ctx->userdata = data.userdata;
+    ctx->traits = data.traits;
+    ctx->target = data.target;
+    ctx->offset = data.offset;
+    return 0;
+  }
+
+  int ret = CMethodContext_init(ctx, slot);
+  return_if_fail (ret == 0) ret;
+  if (seqlock_write_begin(&entry->seq, &seq)) {
+    entry->slot = *slot;
+    entry->func = ctx->func;
+    entry->userdata = ctx->userdata;
+    entry->traits = ctx->traits;
+    entry->target = ctx->target;
+    entry->offset = ctx->offset;
+    seqlock_write_end(&entry->seq, seq);
+  }
+  return 0;
+}
@@ -0,0 +1,423 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/cpool.h"
+#include "utils/macro.h"
+
+
+/// size and alignment of spans, which blocks are carved from
+#define COBJ_POOL_SPAN_SIZE ((size_t) 64 * 1024)
+/// bytes at the start of a span reserved for its header
+#define COBJ_POOL_HEADER_SIZE 64
+/// number of size classes
+#define COBJ_POOL_CLASSES 32
+/// largest size class
+#define COBJ_POOL_MAX_SIZE 8192
+/// bytes moved between a thread cache and the central pool at once
+#define COBJ_POOL_BATCH_BYTES 8192
+/// bounds of the number of blocks moved at once
+#define COBJ_POOL_BATCH_MIN 4
+#define COBJ_POOL_BATCH_MAX 64
+
+/// size class of blocks allocated by the system allocator
+#define COBJ_POOL_LARGE (-1)
+
+// 16-byte steps up to 128, then 4 classes per power of two
+static const unsigned pool_sizes[COBJ_POOL_CLASSES] = {
+  16, 32, 48, 64, 80, 96, 112, 128,
+  160, 192, 224, 256, 320, 384, 448, 512,
+  640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+  2560, 3072, 3584, 4096, 5120, 6144, 7168, 8192,
+};
+
+/// Header of a span.
+struct CObjPoolSpan {
+  /// size class, or #COBJ_POOL_LARGE
+  int cls;
+  /// usable size of a large block
+  size_t size;
+};
+
+_Static_assert(sizeof(struct CObjPoolSpan) <= COBJ_POOL_HEADER_SIZE,
+               "span header too large");
+
+/// Free block.
+struct CObjPoolBlock {
+  struct CObjPoolBlock *next;
+};
+
+/// Linked list of free blocks moved as a whole.
+struct CObjPoolBatch {
+  struct CObjPoolBlock *head;
+  unsigned len;
+};
+
+/// Central free blocks of a size class.
+struct CObjPoolCentral {
+  pthread_mutex_t lock;
+  struct CObjPoolBatch *batches;
+  size_t len;
+  size_t cap;
+} __attribute__((aligned(64)));
+
+/// Cache of a thread.
+struct CObjPoolCache {
+  struct CObjPoolBlock *free[COBJ_POOL_CLASSES];
+  unsigned len[COBJ_POOL_CLASSES];
+  /// statistics, written by the owning thread only; bytes freed are counted
+  ///  apart, as blocks may be freed by other threads than their owners
+  size_t allocs;
+  size_t frees;
+  size_t alloc_bytes;
+  size_t free_bytes;
+  size_t mapped;
+  /// list of registered caches
+  struct CObjPoolCache *next;
+  struct CObjPoolCache **prev;
+};
+
+/// central pool, initialized together with the key of thread caches
+static struct CObjPoolCentral pool_central[COBJ_POOL_CLASSES];
+
+/// registered caches, and statistics of exited threads
+static pthread_mutex_t pool_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct CObjPoolCache *pool_registry;
+static struct CObjPoolStats pool_retired;
+
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+static pthread_key_t pool_key;
+static bool pool_key_ok;
+
+static _Thread_local struct CObjPoolCache pool_cache;
+static _Thread_local bool pool_cache_registered;
+
+
+// store a counter of the own thread, read concurrently by CObjPool_stats()
+#define CObjPool_count(field, n) \
+  __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+
+
+static inline int CObjPool_class (size_t size) {
+  if (size <= 128) {
+    return size <= 16 ? 0 : (int) ((size - 1) / 16);
+  }
+  return_if_fail (size <= COBJ_POOL_MAX_SIZE) COBJ_POOL_LARGE;
+  // size in (2^log, 2^(log + 1)], 4 classes of 2^(log - 2) bytes
+  int log = 63 - __builtin_clzll(size - 1);
+  return 8 + (log - 7) * 4 + (int) ((size - 1) >> (log - 2)) - 4;
+}
+
+
+static inline unsigned CObjPool_batch (int cls) {
+  unsigned n = COBJ_POOL_BATCH_BYTES / pool_sizes[cls];
+  return min(max(n, COBJ_POOL_BATCH_MIN), COBJ_POOL_BATCH_MAX);
+}
+
+
+static inline struct CObjPoolSpan *CObjPool_span (const void *ptr) {
+  return (struct CObjPoolSpan *) (
+    (uintptr_t) ptr & ~(uintptr_t) (COBJ_POOL_SPAN_SIZE - 1));
+}
+
+
+static inline size_t CObjPool_usable (const struct CObjPoolSpan *span) {
+  return span->cls == COBJ_POOL_LARGE ? span->size : pool_sizes[span->cls];
+}
+
+
+// the analyzer loses track of spans only referred to by interior pointers
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wanalyzer-malloc-leak"
+
+
+// make room for n batches, with the lock of the size class held
+static int CObjPoolCentral_reserve (struct CObjPoolCentral *self, size_t n) {
+  return_if (self->len + n <= self->cap) 0;
+  size_t cap = max(self->cap * 2, max(self->len + n, 16));
+  struct CObjPoolBatch *batches = realloc(
+    self->batches, sizeof(batches[0]) * cap);
+  return_if_fail (batches != NULL) -1;
+  self->batches = batches;
+  self->cap = cap;
+  return 0;
+}
+
+
+// move all blocks of a cache to the central pool
+static void CObjPoolCache_flush (struct CObjPoolCache *self) {
+  for (int cls = 0; cls < COBJ_POOL_CLASSES; cls++) {
+    continue_if (self->free[cls] == NULL);
+    struct CObjPoolCentral *central = pool_central + cls;
+    pthread_mutex_lock(&central->lock);
+    should (CObjPoolCentral_reserve(central, 1) == 0) otherwise {
+      // keep the blocks in the cache
+      pthread_mutex_unlock(&central->lock);
+      continue;
+    }
+    central->batches[central->len++] = (struct CObjPoolBatch) {
+      self->free[cls], self->len[cls]};
+    pthread_mutex_unlock(&central->lock);
+    self->free[cls] = NULL;
+    self->len[cls] = 0;
+  }
+}
+
+
+static void CObjPoolCache_destroy (void *data) {
+  struct CObjPoolCache *self = data;
+  CObjPoolCache_flush(self);
+
+  pthread_mutex_lock(&pool_registry_lock);
+  pool_retired.allocs += self->allocs;
+  pool_retired.frees += self->frees;
+  pool_retired.bytes += self->alloc_bytes - self->free_bytes;
+  pool_retired.mapped += self->mapped;
+  *self->prev = self->next;
+  if (self->next != NULL) {
+    self->next->prev = self->prev;
+  }
+  pthread_mutex_unlock(&pool_registry_lock);
+
+  *self = (struct CObjPoolCache) {0};
+  pool_cache_registered = false;
+}
+
+
+static void CObjPool_init (void) {
+  for (int cls = 0; cls < COBJ_POOL_CLASSES; cls++) {
+    pthread_mutex_init(&pool_central[cls].lock, NULL);
+  }
+  pool_key_ok = pthread_key_create(&pool_key, CObjPoolCache_destroy) == 0;
+}
+
+
+// cache of the calling thread, registered on first use
+static inline struct CObjPoolCache *CObjPool_cache (void) {
+  struct CObjPoolCache *self = &pool_cache;
+  return_if (likely (pool_cache_registered)) self;
+
+  pthread_once(&pool_once, CObjPool_init);
+  // without the key, the cache is leaked on thread exit but still usable
+  if (pool_key_ok) {
+    pthread_setspecific(pool_key, self);
+  }
+  pthread_mutex_lock(&pool_registry_lock);
+  self->next = pool_registry;
+  self->prev = &pool_registry;
+  if (pool_registry != NULL) {
+    pool_registry->prev = &self->next;
+  }
+  pool_registry = self;
+  pthread_mutex_unlock(&pool_registry_lock);
+  pool_cache_registered = true;
+  return self;
+}
+
+
+// link consecutive blocks into a list
+static struct CObjPoolBlock *CObjPool_link (
+    char *mem, unsigned size, unsigned len) {
+  for (unsigned i = 1; i < len; i++) {
+    ((struct CObjPoolBlock *) (mem + (size_t) size * (i - 1)))->next =
+      (struct CObjPoolBlock *) (mem + (size_t) size * i);
+  }
+  ((struct CObjPoolBlock *) (mem + (size_t) size * (len - 1)))->next = NULL;
+  return (struct CObjPoolBlock *) mem;
+}
+
+
+// carve a new span into blocks, push all full batches but one to the central
+// pool and keep the rest
+static int CObjPoolCache_carve (struct CObjPoolCache *self, int cls) {
+  char *mem;
+  return_if_fail (posix_memalign(
+    (void **) &mem, COBJ_POOL_SPAN_SIZE, COBJ_POOL_SPAN_SIZE) == 0) -1;
+  CObjPool_count(self->mapped, COBJ_POOL_SPAN_SIZE);
+  *(struct CObjPoolSpan *) mem = (struct CObjPoolSpan) {.cls = cls};
+
+  unsigned size = pool_sizes[cls];
+  unsigned batch = CObjPool_batch(cls);
+  unsigned n = (COBJ_POOL_SPAN_SIZE - COBJ_POOL_HEADER_SIZE) / size;
+  unsigned keep = n % batch == 0 ? batch : n % batch;
+  unsigned batches = (n - keep) / batch;
+  char *first = mem + COBJ_POOL_HEADER_SIZE;
+
+  struct CObjPoolCentral *central = pool_central + cls;
+  pthread_mutex_lock(&central->lock);
+  if (CObjPoolCentral_reserve(central, batches) == 0) {
+    for (unsigned i = 0; i < batches; i++) {
+      central->batches[central->len++] = (struct CObjPoolBatch) {
+        CObjPool_link(first + (size_t) size * (keep + batch * i), size, batch),
+        batch};
+    }
+  } else {
+    // keep everything in the cache
+    keep = n;
+  }
+  pthread_mutex_unlock(&central->lock);
+
+  self->free[cls] = CObjPool_link(first, size, keep);
+  self->len[cls] = keep;
+  return 0;
+}
+
+
+// refill an empty free list from the central pool, or from a new span
+static int CObjPoolCache_refill (struct CObjPoolCache *self, int cls) {
+  struct CObjPoolCentral *central = pool_central + cls;
+  pthread_mutex_lock(&central->lock);
+  if (central->len > 0) {
+    struct CObjPoolBatch batch = central->batches[--central->len];
+    pthread_mutex_unlock(&central->lock);
+    self->free[cls] = batch.head;
+    self->len[cls] = batch.len;
+    return 0;
+  }
+  pthread_mutex_unlock(&central->lock);
+  return CObjPoolCache_carve(self, cls);
+}
+
+
+// return a batch of a full free list to the central pool
+static void CObjPoolCache_drain (struct CObjPoolCache *self, int cls) {
+  unsigned batch = CObjPool_batch(cls);
+  struct CObjPoolBlock *head = self->free[cls];
+  struct CObjPoolBlock *tail = head;
+  for (unsigned i = 1; i < batch; i++) {
+    tail = tail->next;
+  }
+
+  struct CObjPoolCentral *central = pool_central + cls;
+  pthread_mutex_lock(&central->lock);
+  should (CObjPoolCentral_reserve(central, 1) == 0) otherwise {
+    // try again on the next free
+    pthread_mutex_unlock(&central->lock);
+    return;
+  }
+  central->batches[central->len++] = (struct CObjPoolBatch) {head, batch};
+  pthread_mutex_unlock(&central->lock);
+
+  self->free[cls] = tail->next;
+  tail->next = NULL;
+  self->len[cls] -= batch;
+}
+
+
+static void *CObjPool_malloc_large (struct CObjPoolCache *cache, size_t size) {
+  should (size <= SIZE_MAX - COBJ_POOL_HEADER_SIZE) otherwise {
+    errno = ENOMEM;
+    return NULL;
+  }
+  void *mem;
+  int err = posix_memalign(
+    &mem, COBJ_POOL_SPAN_SIZE, COBJ_POOL_HEADER_SIZE + size);
+  should (err == 0) otherwise {
+    errno = err;
+    return NULL;
+  }
+  *(struct CObjPoolSpan *) mem = (struct CObjPoolSpan) {
+    .cls = COBJ_POOL_LARGE, .size = size};
+  CObjPool_count(cache->mapped, COBJ_POOL_HEADER_SIZE + size);
+  CObjPool_count(cache->allocs, 1);
+  CObjPool_count(cache->alloc_bytes, size);
+  return (char *) mem + COBJ_POOL_HEADER_SIZE;
+}
+
+
+void *CObjPool_malloc (size_t size) {
+  struct CObjPoolCache *cache = CObjPool_cache();
+  int cls = CObjPool_class(size);
+  return_if_fail (cls != COBJ_POOL_LARGE) CObjPool_malloc_large(cache, size);
+
+  if unlikely (cache->free[cls] == NULL) {
+    should (CObjPoolCache_refill(cache, cls) == 0) otherwise {
+      errno = ENOMEM;
+      return NULL;
+    }
+  }
+  struct CObjPoolBlock *block = cache->free[cls];
+  cache->free[cls] = block->next;
+  cache->len[cls]--;
+  CObjPool_count(cache->allocs, 1);
+  CObjPool_count(cache->alloc_bytes, pool_sizes[cls]);
+  return block;
+}
+
+
+void CObjPool_free (void *ptr) {
+  return_if_fail (ptr != NULL);
+  struct CObjPoolCache *cache = CObjPool_cache();
+  struct CObjPoolSpan *span = CObjPool_span(ptr);
+  CObjPool_count(cache->frees, 1);
+  CObjPool_count(cache->free_bytes, CObjPool_usable(span));
+  if unlikely (span->cls == COBJ_POOL_LARGE) {
+    // counted as unmapped by the freeing thread
+    CObjPool_count(cache->mapped, -(COBJ_POOL_HEADER_SIZE + span->size));
+    free(span);
+    return;
+  }
+
+  int cls = span->cls;
+  struct CObjPoolBlock *block = ptr;
+  block->next = cache->free[cls];
+  cache->free[cls] = block;
+  cache->len[cls]++;
+  if unlikely (cache->len[cls] >= 2 * CObjPool_batch(cls)) {
+    CObjPoolCache_drain(cache, cls);
+  }
+}
+
+
+void *CObjPool_realloc (void *ptr, size_t size) {
+  return_if_fail (ptr != NULL) CObjPool_malloc(size);
+  struct CObjPoolSpan *span = CObjPool_span(ptr);
+  size_t usable = CObjPool_usable(span);
+  // keep the block unless it shrinks to a smaller class
+  if (size <= usable) {
+    int cls = CObjPool_class(size);
+    return_if (span->cls == COBJ_POOL_LARGE ? cls == COBJ_POOL_LARGE :
+               cls == span->cls) ptr;
+  }
+
+  void *ret = CObjPool_malloc(size);
+  return_if_fail (ret != NULL) NULL;
+  memcpy(ret, ptr, min(size, usable));
+  CObjPool_free(ptr);
+  return ret;
+}
+
+
+void CObjPool_flush (void) {
+  return_if_fail (pool_cache_registered);
+  CObjPoolCache_flush(&pool_cache);
+}
+
+
+void CObjPool_stats (struct CObjPoolStats *stats) {
+  pthread_mutex_lock(&pool_registry_lock);
+  *stats = pool_retired;
+  for (const struct CObjPoolCache *cache = pool_registry; cache != NULL;
+       cache = cache->next) {
+    stats->allocs += __atomic_load_n(&cache->allocs, __ATOMIC_RELAXED);
+    stats->frees += __atomic_load_n(&cache->frees, __ATOMIC_RELAXED);
+    stats->bytes += __atomic_load_n(&cache->alloc_bytes, __ATOMIC_RELAXED) -
+      __atomic_load_n(&cache->free_bytes, __ATOMIC_RELAXED);
+    stats->mapped += __atomic_load_n(&cache->mapped, __ATOMIC_RELAXED);
+  }
+  pthread_mutex_unlock(&pool_registry_lock);
+}
+
+
+#pragma GCC diagnostic pop
+
+
+const struct CObjAllocator CObjPool_allocator = {
+  .malloc = CObjPool_malloc,
+  .realloc = CObjPool_realloc,
+  .free = CObjPool_free,
+};
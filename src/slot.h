@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "include/cobj.h"
@@ -51,6 +52,22 @@ static inline bool CObjSlot_equal_static (
   strncpy(other.name, name, sizeof(other.name));
   return memcmp(self, &other, sizeof(*self)) == 0;
 }
+__attribute__((pure, warn_unused_result, access(read_only, 1)))
+/**
+ * @memberof CObjSlot
+ * @brief Calculate hash value of slot.
+ *
+ * @param self Slot.
+ * @return Hash value.
+ */
+static inline uint64_t CObjSlot_hash (const struct CObjSlot *self) {
+  uint64_t a;
+  uint64_t b;
+  memcpy(&a, self, sizeof(a));
+  memcpy(&b, (const char *) self + sizeof(a), sizeof(b));
+  uint64_t h = (a ^ (b * 0x9e3779b97f4a7c15)) * 0xbf58476d1ce4e5b9;
+  return h ^ (h >> 31);
+}
 
 
 #endif /* COBJ_SLOT_H */
@@ -0,0 +1,355 @@
+#define _GNU_SOURCE
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <link.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "include/ccache.h"
+#include "utils/macro.h"
+#include "cache.h"
+
+
+#define COBJ_SNAPSHOT_MAGIC "CObjSnap"
+#define COBJ_SNAPSHOT_VERSION 1
+#define COBJ_SNAPSHOT_MAX_MODULES 256
+#define COBJ_BUILD_ID_MAXLEN 32
+#define COBJ_SNAPSHOT_PTR_SHIFT 48
+
+
+/* on-disk structures */
+
+struct CObjSnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t nmodule;
+  uint32_t nresolve;
+  uint32_t ndispatch;
+};
+
+struct CObjSnapshotModule {
+  unsigned char build_id[COBJ_BUILD_ID_MAXLEN];
+  uint32_t build_id_len;
+  uint32_t reserved;
+};
+
+// pointers are encoded as ((module index + 1) << 48 | offset), 0 for NULL
+struct CObjSnapshotResolve {
+  uint64_t self;
+  uint64_t v;
+  uint64_t target;
+  struct CObjSlot slot;
+  int32_t offset;
+  uint32_t reserved;
+};
+
+struct CObjSnapshotDispatch {
+  uint64_t methods;
+  uint64_t method;
+  uint64_t types[COBJ_CACHE_DISPATCH_MAXLEN];
+  int32_t len;
+  uint32_t reserved;
+};
+
+
+/* loaded modules */
+
+struct CObjModule {
+  struct CObjSnapshotModule id;
+  uintptr_t bias;
+  uintptr_t start;
+  uintptr_t end;
+};
+
+struct CObjModuleTable {
+  struct CObjModule modules[COBJ_SNAPSHOT_MAX_MODULES];
+  unsigned len;
+};
+
+
+static bool CObjModule_read_build_id (
+    struct CObjModule *self, const char *notes, size_t size) {
+  const size_t align = 4;
+  while (size >= sizeof(ElfW(Nhdr))) {
+    const ElfW(Nhdr) *nhdr = (const void *) notes;
+    size_t namesz = (nhdr->n_namesz + align - 1) & ~(align - 1);
+    size_t descsz = (nhdr->n_descsz + align - 1) & ~(align - 1);
+    size_t len = sizeof(*nhdr) + namesz + descsz;
+    break_if_fail (len <= size);
+    if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 &&
+        memcmp(notes + sizeof(*nhdr), "GNU", 4) == 0 &&
+        0 < nhdr->n_descsz && nhdr->n_descsz <= COBJ_BUILD_ID_MAXLEN) {
+      memcpy(self->id.build_id, notes + sizeof(*nhdr) + namesz,
+             nhdr->n_descsz);
+      self->id.build_id_len = nhdr->n_descsz;
+      return true;
+    }
+    notes += len;
+    size -= len;
+  }
+  return false;
+}
+
+
+static int CObjModuleTable_add (
+    struct dl_phdr_info *info, size_t size, void *data) {
+  (void) size;
+  struct CObjModuleTable *self = data;
+  return_if_fail (self->len < COBJ_SNAPSHOT_MAX_MODULES) 1;
+
+  struct CObjModule *module = self->modules + self->len;
+  memset(module, 0, sizeof(*module));
+  module->bias = info->dlpi_addr;
+  module->start = UINTPTR_MAX;
+  bool has_build_id = false;
+  for (ElfW(Half) i = 0; i < info->dlpi_phnum; i++) {
+    const ElfW(Phdr) *phdr = info->dlpi_phdr + i;
+    uintptr_t start = info->dlpi_addr + phdr->p_vaddr;
+    if (phdr->p_type == PT_LOAD) {
+      module->start = min(module->start, start);
+      module->end = max(module->end, start + phdr->p_memsz);
+    } else if (phdr->p_type == PT_NOTE && !has_build_id) {
+      has_build_id = CObjModule_read_build_id(
+        module, (const char *) start, phdr->p_memsz);
+    }
+  }
+  if (has_build_id && module->start < module->end) {
+    self->len++;
+  }
+  return 0;
+}
+
+
+static void CObjModuleTable_init (struct CObjModuleTable *self) {
+  self->len = 0;
+  dl_iterate_phdr(CObjModuleTable_add, self);
+}
+
+
+static bool CObjModuleTable_encode (
+    const struct CObjModuleTable *self, const void *ptr, uint64_t *out) {
+  if (ptr == NULL) {
+    *out = 0;
+    return true;
+  }
+  for (unsigned i = 0; i < self->len; i++) {
+    const struct CObjModule *module = self->modules + i;
+    if (module->start <= (uintptr_t) ptr && (uintptr_t) ptr < module->end) {
+      *out = (uint64_t) (i + 1) << COBJ_SNAPSHOT_PTR_SHIFT |
+             ((uintptr_t) ptr - module->bias);
+      return true;
+    }
+  }
+  return false;
+}
+
+
+// modules of snapshot file mapped to loaded ones
+struct CObjModuleMap {
+  const struct CObjModuleTable *table;
+  unsigned len;
+  int map[COBJ_SNAPSHOT_MAX_MODULES];
+};
+
+
+static void CObjModuleMap_init (
+    struct CObjModuleMap *self, const struct CObjModuleTable *table,
+    const struct CObjSnapshotModule *ids, unsigned len) {
+  self->table = table;
+  self->len = len;
+  for (unsigned i = 0; i < len; i++) {
+    self->map[i] = -1;
+    for (unsigned j = 0; j < table->len; j++) {
+      const struct CObjSnapshotModule *id = &table->modules[j].id;
+      if (id->build_id_len == ids[i].build_id_len &&
+          memcmp(id->build_id, ids[i].build_id, id->build_id_len) == 0) {
+        self->map[i] = j;
+        break;
+      }
+    }
+  }
+}
+
+
+static bool CObjModuleMap_decode (
+    const struct CObjModuleMap *self, uint64_t in, const void **ptr) {
+  if (in == 0) {
+    *ptr = NULL;
+    return true;
+  }
+  unsigned index = (in >> COBJ_SNAPSHOT_PTR_SHIFT) - 1;
+  return_if_fail (index < self->len && self->map[index] >= 0) false;
+  const struct CObjModule *module = self->table->modules + self->map[index];
+  uintptr_t addr =
+    module->bias + (in & (((uint64_t) 1 << COBJ_SNAPSHOT_PTR_SHIFT) - 1));
+  return_if_fail (module->start <= addr && addr < module->end) false;
+  *ptr = (const void *) addr;
+  return true;
+}
+
+
+/* snapshot */
+
+int CObjCache_save (const char *path) {
+  struct {
+    struct CObjModuleTable modules;
+    struct CObjSnapshotResolve resolves[COBJ_CACHE_RESOLVE_SIZE];
+    struct CObjSnapshotDispatch dispatches[COBJ_CACHE_DISPATCH_SIZE];
+  } *buf = malloc(sizeof(*buf));
+  return_if_fail (buf != NULL) -1;
+  struct CObjModuleTable *modules = &buf->modules;
+  struct CObjSnapshotResolve *resolves = buf->resolves;
+  struct CObjSnapshotDispatch *dispatches = buf->dispatches;
+  CObjModuleTable_init(modules);
+
+  struct CObjSnapshotHeader header = {
+    .magic = COBJ_SNAPSHOT_MAGIC, .version = COBJ_SNAPSHOT_VERSION,
+    .nmodule = modules->len};
+  for (unsigned i = 0; i < COBJ_CACHE_RESOLVE_SIZE; i++) {
+    struct CObjCacheResolve entry;
+    continue_if_not (CObjCacheResolve_at(i, &entry));
+    struct CObjSnapshotResolve *record = resolves + header.nresolve;
+    memset(record, 0, sizeof(*record));
+    continue_if_not (
+      CObjModuleTable_encode(modules, entry.self, &record->self) &&
+      CObjModuleTable_encode(modules, entry.v, &record->v) &&
+      CObjModuleTable_encode(modules, entry.target, &record->target));
+    record->slot = entry.slot;
+    record->offset = entry.offset;
+    header.nresolve++;
+  }
+  for (unsigned i = 0; i < COBJ_CACHE_DISPATCH_SIZE; i++) {
+    struct CObjCacheDispatch entry;
+    continue_if_not (CObjCacheDispatch_at(i, &entry));
+    struct CObjSnapshotDispatch *record = dispatches + header.ndispatch;
+    memset(record, 0, sizeof(*record));
+    bool ok =
+      CObjModuleTable_encode(modules, entry.methods, &record->methods) &&
+      CObjModuleTable_encode(modules, entry.method, &record->method);
+    for (int j = 0; ok && j < entry.len; j++) {
+      ok = CObjModuleTable_encode(modules, entry.types[j], record->types + j);
+    }
+    continue_if_not (ok);
+    record->len = entry.len;
+    header.ndispatch++;
+  }
+
+  int ret = -1;
+  FILE *f = fopen(path, "wb");
+  if (f != NULL) {
+    for (unsigned i = 0; i < modules->len; i++) {
+      modules->modules[i].id.reserved = 0;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    for (unsigned i = 0; ok && i < modules->len; i++) {
+      ok = fwrite(&modules->modules[i].id, sizeof(struct CObjSnapshotModule),
+                  1, f) == 1;
+    }
+    ok = ok && fwrite(resolves, sizeof(resolves[0]), header.nresolve, f) ==
+                 header.nresolve;
+    ok = ok && fwrite(dispatches, sizeof(dispatches[0]), header.ndispatch,
+                      f) == header.ndispatch;
+    ok = fclose(f) == 0 && ok;
+    if (ok) {
+      ret = header.nresolve + header.ndispatch;
+    }
+  }
+  free(buf);
+  return ret;
+}
+
+
+int CObjCache_load (const char *path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  return_if_fail (fd >= 0) -1;
+  struct stat st;
+  should (fstat(fd, &st) == 0) otherwise {
+    close(fd);
+    return -1;
+  }
+  should ((size_t) st.st_size >= sizeof(struct CObjSnapshotHeader)) otherwise {
+    close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  return_if_fail (map != MAP_FAILED) -1;
+
+  int ret = -1;
+  struct CObjModuleTable *modules = NULL;
+  const struct CObjSnapshotHeader *header = map;
+  const struct CObjSnapshotModule *file_modules = (const void *) (header + 1);
+  const struct CObjSnapshotResolve *resolves =
+    (const void *) (file_modules + header->nmodule);
+  const struct CObjSnapshotDispatch *dispatches =
+    (const void *) (resolves + header->nresolve);
+  do_once {
+    should (memcmp(header->magic, COBJ_SNAPSHOT_MAGIC,
+                   sizeof(header->magic)) == 0 &&
+            header->version == COBJ_SNAPSHOT_VERSION &&
+            header->nmodule <= COBJ_SNAPSHOT_MAX_MODULES &&
+            header->nresolve <= COBJ_CACHE_RESOLVE_SIZE &&
+            header->ndispatch <= COBJ_CACHE_DISPATCH_SIZE &&
+            (size_t) st.st_size == (size_t) ((const char *) (
+              dispatches + header->ndispatch) - (const char *) map)) otherwise {
+      errno = EINVAL;
+      break;
+    }
+
+    modules = malloc(sizeof(*modules));
+    break_if_fail (modules != NULL);
+    CObjModuleTable_init(modules);
+    struct CObjModuleMap module_map;
+    CObjModuleMap_init(&module_map, modules, file_modules, header->nmodule);
+
+    ret = 0;
+    for (unsigned i = 0; i < header->nresolve; i++) {
+      const struct CObjSnapshotResolve *record = resolves + i;
+      const void *ptrs[3];
+      continue_if_not (
+        CObjModuleMap_decode(&module_map, record->self, ptrs) &&
+        CObjModuleMap_decode(&module_map, record->v, ptrs + 1) &&
+        CObjModuleMap_decode(&module_map, record->target, ptrs + 2) &&
+        ptrs[0] != NULL);
+      struct CObjCacheResolve entry = {
+        .self = ptrs[0], .slot = record->slot, .v = ptrs[1],
+        .target = ptrs[2], .offset = record->offset};
+      if (CObjCacheResolve_put(&entry)) {
+        ret++;
+      }
+    }
+    for (unsigned i = 0; i < header->ndispatch; i++) {
+      const struct CObjSnapshotDispatch *record = dispatches + i;
+      continue_if_fail (
+        0 <= record->len && record->len <= COBJ_CACHE_DISPATCH_MAXLEN);
+      const void *ptrs[2 + COBJ_CACHE_DISPATCH_MAXLEN];
+      bool ok = CObjModuleMap_decode(&module_map, record->methods, ptrs) &&
+                CObjModuleMap_decode(&module_map, record->method, ptrs + 1) &&
+                ptrs[0] != NULL;
+      for (int j = 0; ok && j < record->len; j++) {
+        ok = CObjModuleMap_decode(&module_map, record->types[j], ptrs + 2 + j);
+      }
+      continue_if_not (ok);
+      struct CObjCacheDispatch entry = {
+        .methods = ptrs[0], .method = ptrs[1], .len = record->len};
+      for (int j = 0; j < record->len; j++) {
+        entry.types[j] = ptrs[2 + j];
+      }
+      if (CObjCacheDispatch_put(&entry)) {
+        ret++;
+      }
+    }
+  }
+
+  free(modules);
+  munmap(map, st.st_size);
+  return ret;
+}
@@ -0,0 +1,141 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/cstats.h"
+#include "utils/macro.h"
+#include "stats.h"
+
+
+const char *CObjStat_name (enum CObjStat stat) {
+  static const char * const names[] = {
+    [COBJ_STAT_FIND] = "find",
+    [COBJ_STAT_RESOLVE_DEPTH] = "resolve_depth",
+    [COBJ_STAT_RESOLVE_MISS] = "resolve_miss",
+    [COBJ_STAT_RESOLVE_CACHE_HIT] = "resolve_cache_hit",
+    [COBJ_STAT_DISPATCH_CANDIDATES] = "dispatch_candidates",
+    [COBJ_STAT_DISPATCH_TRAITS] = "dispatch_traits",
+    [COBJ_STAT_DISPATCH_CACHE_HIT] = "dispatch_cache_hit",
+    [COBJ_STAT_COPY_MEMCPY] = "copy_memcpy",
+    [COBJ_STAT_COPY_METHOD] = "copy_method",
+    [COBJ_STAT_BLOOM_SKIP] = "bloom_skip",
+  };
+  return (unsigned) stat < arraysize(names) ? names[stat] : NULL;
+}
+
+
+#ifdef COBJ_STATS
+
+struct CObjStatsBlock {
+  struct CObjStats stats;
+  struct CObjStatsBlock *next;
+};
+
+_Thread_local struct CObjStats *CObjStats_local;
+
+static pthread_mutex_t blocks_lock = PTHREAD_MUTEX_INITIALIZER;
+// live blocks of all threads
+static struct CObjStatsBlock *blocks;
+// statistics of exited threads
+static struct CObjStats retired;
+// statistics at the time of the last reset
+static struct CObjStats baseline;
+static pthread_key_t blocks_key;
+static pthread_once_t blocks_key_once = PTHREAD_ONCE_INIT;
+
+
+static void CObjStats_add (struct CObjStats *self, struct CObjStats *other) {
+  for (int i = 0; i < COBJ_STAT_MAX; i++) {
+    struct CObjStatMetric *dst = self->metrics + i;
+    struct CObjStatMetric *src = other->metrics + i;
+    dst->events += __atomic_load_n(&src->events, __ATOMIC_RELAXED);
+    dst->total += __atomic_load_n(&src->total, __ATOMIC_RELAXED);
+    for (int j = 0; j < COBJ_STAT_BUCKETS; j++) {
+      dst->buckets[j] += __atomic_load_n(src->buckets + j, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+
+// called with blocks_lock held
+static void CObjStats_merge (struct CObjStats *self) {
+  *self = retired;
+  for (struct CObjStatsBlock *block = blocks; block != NULL;
+       block = block->next) {
+    CObjStats_add(self, &block->stats);
+  }
+}
+
+
+static void CObjStatsBlock_retire (void *data) {
+  struct CObjStatsBlock *self = data;
+  pthread_mutex_lock(&blocks_lock);
+  for (struct CObjStatsBlock **p = &blocks; *p != NULL; p = &(*p)->next) {
+    if (*p == self) {
+      *p = self->next;
+      break;
+    }
+  }
+  CObjStats_add(&retired, &self->stats);
+  pthread_mutex_unlock(&blocks_lock);
+  free(self);
+}
+
+
+static void CObjStats_key_init (void) {
+  pthread_key_create(&blocks_key, CObjStatsBlock_retire);
+}
+
+
+struct CObjStats *CObjStats_local_init (void) {
+  struct CObjStatsBlock *block = calloc(1, sizeof(*block));
+  return_if_fail (block != NULL) NULL;
+  pthread_once(&blocks_key_once, CObjStats_key_init);
+  pthread_setspecific(blocks_key, block);
+
+  pthread_mutex_lock(&blocks_lock);
+  block->next = blocks;
+  blocks = block;
+  pthread_mutex_unlock(&blocks_lock);
+
+  CObjStats_local = &block->stats;
+  return CObjStats_local;
+}
+
+
+bool CObjStats_snapshot (struct CObjStats *stats) {
+  pthread_mutex_lock(&blocks_lock);
+  CObjStats_merge(stats);
+  for (int i = 0; i < COBJ_STAT_MAX; i++) {
+    struct CObjStatMetric *metric = stats->metrics + i;
+    const struct CObjStatMetric *base = baseline.metrics + i;
+    metric->events -= base->events;
+    metric->total -= base->total;
+    for (int j = 0; j < COBJ_STAT_BUCKETS; j++) {
+      metric->buckets[j] -= base->buckets[j];
+    }
+  }
+  pthread_mutex_unlock(&blocks_lock);
+  return true;
+}
+
+
+void CObjStats_reset (void) {
+  pthread_mutex_lock(&blocks_lock);
+  CObjStats_merge(&baseline);
+  pthread_mutex_unlock(&blocks_lock);
+}
+
+#else
+
+bool CObjStats_snapshot (struct CObjStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+  return false;
+}
+
+
+void CObjStats_reset (void) { }
+
+#endif
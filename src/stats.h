@@ -0,0 +1,67 @@
+#ifndef COBJ_STATS_H
+#define COBJ_STATS_H
+
+#include <stdint.h>
+
+#include "include/cstats.h"
+#include "utils/macro.h"
+
+
+#ifdef COBJ_STATS
+
+/// statistics of the current thread, or @c NULL if not yet registered
+extern _Thread_local struct CObjStats *CObjStats_local;
+
+__attribute__((warn_unused_result))
+/**
+ * @memberof CObjStats
+ * @brief Register statistics block of the current thread.
+ *
+ * @return Statistics of the current thread, or @c NULL if out of memory.
+ */
+struct CObjStats *CObjStats_local_init (void);
+
+__attribute__((const, warn_unused_result))
+/**
+ * @memberof CObjStatMetric
+ * @brief Get histogram bucket of a value.
+ *
+ * @param value Value.
+ * @return Bucket index.
+ */
+static inline int CObjStatMetric_bucket (uint64_t value) {
+  return value == 0 ? 0 :
+    min(64 - __builtin_clzll(value), COBJ_STAT_BUCKETS - 1);
+}
+
+/**
+ * @memberof CObjStats
+ * @brief Record an event for the current thread.
+ *
+ * @param stat Metric.
+ * @param value Event value.
+ */
+static inline void CObjStats_record (enum CObjStat stat, uint64_t value) {
+  struct CObjStats *stats = CObjStats_local;
+  if unlikely (stats == NULL) {
+    stats = CObjStats_local_init();
+    return_if_fail (stats != NULL);
+  }
+  // only the owner thread writes, readers may run concurrently
+  struct CObjStatMetric *metric = stats->metrics + stat;
+  uint64_t *bucket = metric->buckets + CObjStatMetric_bucket(value);
+  __atomic_store_n(&metric->events, metric->events + 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&metric->total, metric->total + value, __ATOMIC_RELAXED);
+  __atomic_store_n(bucket, *bucket + 1, __ATOMIC_RELAXED);
+}
+
+#define COBJ_STATS_RECORD(stat, value) CObjStats_record(stat, value)
+
+#else
+
+#define COBJ_STATS_RECORD(stat, value) ((void) 0)
+
+#endif
+
+
+#endif /* COBJ_STATS_H */
@@ -1,19 +1,32 @@
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "include/cobj.h"
 #include "utils/macro.h"
 #include "utils/error.h"
+#include "cache.h"
 #include "slot.h"
+#include "stats.h"
+#include "trace.h"
 #include "variant.h"
 #include "tag.h"
 
 
 static const struct CObjTag *_CObjTagArray_find (
     const struct CObjTag *self, const struct CObjSlot *slot) {
-  for (; !CObjTag_isnull(self); self++) {
-    return_if (CObjTag_match(self, slot)) self;
+  for (const struct CObjTag *tag = self; ; tag++) {
+    if unlikely (CObjTag_isnull(tag)) {
+      COBJ_STATS_RECORD(COBJ_STAT_FIND, tag - self);
+      return NULL;
+    }
+    if (CObjTag_match(tag, slot)) {
+      COBJ_STATS_RECORD(COBJ_STAT_FIND, tag - self + 1);
+      return tag;
+    }
   }
-  return NULL;
 }
 
 
@@ -39,59 +52,295 @@ static const struct CObjTag *CObjTagArray_next_public (
 }
 
 
-// non-recursively resolve single slot
+/// bits of a slot in a slot filter; all of them lie in the same block
+struct CObjTagBloomKey {
+  unsigned word;
+  uint64_t mask;
+};
+
+
+static inline struct CObjTagBloomKey CObjTagBloomKey_new (
+    const struct CObjSlot *slot) {
+  uint64_t h = CObjSlot_hash(slot);
+  return (struct CObjTagBloomKey) {
+    .word = h & (COBJ_BLOOM_WORDS - 1),
+    .mask = (UINT64_C(1) << ((h >> 8) & 63)) |
+            (UINT64_C(1) << ((h >> 16) & 63)) |
+            (UINT64_C(1) << ((h >> 24) & 63)),
+  };
+}
+
+
+static inline bool CObjTagBloomKey_test (
+    struct CObjTagBloomKey self, const uint64_t *filter) {
+  return (filter[self.word] & self.mask) == self.mask;
+}
+
+
+// get slot filters of tag set into bloom, computing them if needed; false if
+// unavailable. Filters are only stored while caches are enabled
+static bool CObjTagArray_bloom (
+    const struct CObjTag *self, struct CObjTagBloom *bloom, int depth) {
+#ifdef COBJ_HEADER_ONLY
+  (void) self;
+  (void) bloom;
+  (void) depth;
+  return false;
+#else
+  bloom->self = self;
+  return_if (CObjCacheBloom_get(bloom)) true;
+
+  *bloom = (struct CObjTagBloom) {.self = self};
+  // unvalidated public tag sets may form a cycle; past the depth limit,
+  // filters let every slot pass
+  if unlikely (depth >= COBJ_TAG_VALIDATE_DEPTH) {
+    memset(bloom->own, 0xff, sizeof(bloom->own));
+    memset(bloom->all, 0xff, sizeof(bloom->all));
+    CObjCacheBloom_put(bloom);
+    return true;
+  }
+
+  for (const struct CObjTag *tag = self; !CObjTag_isnull(tag); tag++) {
+    struct CObjTagBloomKey key = CObjTagBloomKey_new(&tag->slot);
+    bloom->own[key.word] |= key.mask;
+  }
+  memcpy(bloom->all, bloom->own, sizeof(bloom->all));
+  for (const struct CObjTag *super = CObjTagArray_find_public(self);
+       super != NULL; super = CObjTagArray_next_public(super)) {
+    struct CObjTagBloom sub;
+    return_if_fail (CObjTagArray_bloom(super->tags, &sub, depth + 1)) false;
+    for (int j = 0; j < COBJ_BLOOM_WORDS; j++) {
+      bloom->all[j] |= sub.all[j];
+    }
+  }
+  CObjCacheBloom_put(bloom);
+  return true;
+#endif
+}
+
+
+// non-recursively resolve single slot; bloom, if not NULL, are the slot filters
+// of self, and key the bits of slot
 static const struct CObjTag *CObjTagArray_resolve_simple (
     const struct CObjTag *self, const struct CObjSlot *slot,
-    const struct CObjTag **target, int *offset, int cur_offset) {
+    const struct CObjTagBloom *bloom, struct CObjTagBloomKey key,
+    const struct CObjTag **target, int *offset, int cur_offset, int depth) {
+  if (bloom != NULL && !CObjTagBloomKey_test(key, bloom->all)) {
+    COBJ_STATS_RECORD(COBJ_STAT_BLOOM_SKIP, 1);
+    return NULL;
+  }
+
   // find in self
-  const struct CObjTag *tag = _CObjTagArray_find(self, slot);
-  if (tag != NULL) {
-    if (target != NULL) {
-      *target = self;
+  if (bloom == NULL || CObjTagBloomKey_test(key, bloom->own)) {
+    const struct CObjTag *tag = _CObjTagArray_find(self, slot);
+    if (tag != NULL) {
+      COBJ_STATS_RECORD(COBJ_STAT_RESOLVE_DEPTH, depth);
+      if (target != NULL) {
+        *target = self;
+      }
+      if (offset != NULL) {
+        *offset = cur_offset;
+      }
+      return tag;
     }
-    if (offset != NULL) {
-      *offset = cur_offset;
-    }
-    return tag;
   }
 
   // find in super class(es)
   const struct CObjTag *super = CObjTagArray_next_public(self - 1);
   return_if_fail (super != NULL) NULL;
-  for (const struct CObjTag *next_super = super; ; super = next_super) {
-    next_super = CObjTagArray_next_public(next_super);
+  for (int i = 0; ; i++) {
+    const struct CObjTag *next_super = CObjTagArray_next_public(super);
+    // filters of public tag sets are looked up as they are visited; without
+    // caches they would be rebuilt on every level, so only self is filtered
+    struct CObjTagBloom buf;
+    const struct CObjTagBloom *sub = bloom != NULL && CObjCache_isenabled() &&
+      CObjTagArray_bloom(super->tags, &buf, depth + 1) ? &buf : NULL;
     return_if_fail (next_super != NULL) CObjTagArray_resolve_simple(
-      super, slot, target, offset, cur_offset + super->offset);
+      super->tags, slot, sub, key, target, offset,
+      cur_offset + super->offset, depth + 1);
     const struct CObjTag *tag = CObjTagArray_resolve_simple(
-      super, slot, target, offset, cur_offset + super->offset);
+      super->tags, slot, sub, key, target, offset,
+      cur_offset + super->offset, depth + 1);
     return_if (tag != NULL) tag;
+    super = next_super;
   }
 }
 
 
+#ifdef COBJ_HEADER_ONLY
+
+// CObjCache_clear() of the library cannot reach a table of the inlined core,
+// so tag sets are never considered validated here
+bool CObjTagArray_isvalidated (const struct CObjTag *self) {
+  (void) self;
+  return false;
+}
+
+
+void CObjTagArray_clear_validated (void) { }
+
+
+static inline void CObjTagArray_set_validated (const struct CObjTag *self) {
+  (void) self;
+}
+
+#else
+
+static const struct CObjTag *validated[COBJ_TAG_VALIDATED_SIZE];
+
+
+static inline unsigned CObjTagArray_validated_index (
+    const struct CObjTag *self) {
+  uint64_t h = (uintptr_t) self * 0x9e3779b97f4a7c15;
+  return (h ^ (h >> 29)) & (COBJ_TAG_VALIDATED_SIZE - 1);
+}
+
+
+bool CObjTagArray_isvalidated (const struct CObjTag *self) {
+  unsigned i = CObjTagArray_validated_index(self);
+  for (unsigned probe = 0; probe < COBJ_TAG_VALIDATED_PROBE; probe++) {
+    const struct CObjTag *entry = __atomic_load_n(
+      validated + ((i + probe) & (COBJ_TAG_VALIDATED_SIZE - 1)),
+      __ATOMIC_ACQUIRE);
+    return_if (entry == self) true;
+    return_if (entry == NULL) false;
+  }
+  return false;
+}
+
+
+void CObjTagArray_clear_validated (void) {
+  for (unsigned i = 0; i < COBJ_TAG_VALIDATED_SIZE; i++) {
+    __atomic_store_n(validated + i, NULL, __ATOMIC_RELEASE);
+  }
+}
+
+
+// mark tag set as validated; silently gives up if its probe sequence is full
+static void CObjTagArray_set_validated (const struct CObjTag *self) {
+  unsigned i = CObjTagArray_validated_index(self);
+  for (unsigned probe = 0; probe < COBJ_TAG_VALIDATED_PROBE; probe++) {
+    const struct CObjTag **entry =
+      validated + ((i + probe) & (COBJ_TAG_VALIDATED_SIZE - 1));
+    const struct CObjTag *expected = NULL;
+    return_if (__atomic_compare_exchange_n(
+      entry, &expected, self, false, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+    return_if (expected == self);
+  }
+}
+
+#endif
+
+
 // recursively resolve slot name
-const struct CObjVariant *CObjTagArray_resolve (
+static const struct CObjVariant *_CObjTagArray_resolve (
     const struct CObjTag *self, const struct CObjSlot *slot,
+    const struct CObjTagBloom *bloom, struct CObjTagBloomKey key,
     const struct CObjTag **target, int *offset) {
-  const struct CObjTag *tgt;
-  if (target == NULL) {
-    target = &tgt;
+  const struct CObjTag *tag = CObjTagArray_resolve_simple(
+    self, slot, bloom, key, target, offset, 0, 0);
+  if unlikely (tag == NULL) {
+    COBJ_STATS_RECORD(COBJ_STAT_RESOLVE_MISS, 1);
+    return NULL;
+  }
+  const struct CObjVariant *v = &tag->data;
+  return_if_fail (!CObjVariant_isvalid(v)) v;
+  if (!CObjTagArray_isvalidated(self)) {
+    should (v->path != NULL && !CObjSlot_isnull(v->path)) otherwise {
+      CObjTagArray_TypeError(*target, "Alias tag %s@%d has invalid path",
+                             slot->name, slot->ns);
+    }
+    should (!CObjSlot_equal(slot, v->path)) otherwise {
+      CObjTagArray_TypeError(*target, "Alias tag %s@%d points to itself",
+                             slot->name, slot->ns);
+    }
+  }
+  // non-virtual alias is resolved relative to the tag set which owns it
+  int base = tag->virtual_ ? 0 : *offset;
+  v = CObjTagArray_resolves(
+    tag->virtual_ ? self : *target, v->path, target, offset);
+  if (v != NULL) {
+    *offset += base;
   }
+  return v;
+}
+
+
+// check-free counterpart of _CObjTagArray_resolve(); budget is the number of
+// aliases which may still be followed
+static const struct CObjVariant *CObjTagArray_resolve_bounded (
+    const struct CObjTag *self, const struct CObjSlot *slot,
+    const struct CObjTag **target, int *offset, int *budget) {
   const struct CObjTag *tag = CObjTagArray_resolve_simple(
-    self, slot, target, offset, 0);
+    self, slot, NULL, (struct CObjTagBloomKey) {0}, target, offset, 0, 0);
   return_if_fail (tag != NULL) NULL;
   const struct CObjVariant *v = &tag->data;
   return_if_fail (!CObjVariant_isvalid(v)) v;
-  should (v->path != NULL && !CObjSlot_isnull(v->path)) otherwise {
-    CObjTagArray_TypeError(*target, "Alias tag %s@%d has invalid path",
-                    slot->name, slot->ns);
+  return_if_fail (v->path != NULL && !CObjSlot_isnull(v->path)) NULL;
+  return_if_fail ((*budget)-- > 0) NULL;
+
+  int base = tag->virtual_ ? 0 : *offset;
+  const struct CObjTag *tags = tag->virtual_ ? self : *target;
+  for (const struct CObjSlot *path = v->path; ; path++) {
+    v = CObjTagArray_resolve_bounded(tags, path, target, offset, budget);
+    return_if_fail (v != NULL) NULL;
+    break_if (CObjSlot_isnull(path + 1));
+    return_if_fail (v->type == COBJ_TYPE_TAGS && v->tags != NULL) NULL;
+    tags = v->tags;
+  }
+  *offset += base;
+  return v;
+}
+
+
+const struct CObjVariant *CObjTagArray_resolve_unchecked (
+    const struct CObjTag *self, const struct CObjSlot *slot,
+    const struct CObjTag **target, int *offset) {
+  int budget = COBJ_TAG_VALIDATE_DEPTH;
+  return CObjTagArray_resolve_bounded(self, slot, target, offset, &budget);
+}
+
+
+const struct CObjVariant *CObjTagArray_resolve (
+    const struct CObjTag *self, const struct CObjSlot *slot,
+    const struct CObjTag **target, int *offset) {
+  COBJ_TRACE_BEGIN(begin);
+  struct CObjCacheResolve entry = {.self = self, .slot = *slot};
+  int outcome = 1;
+  if (CObjCacheResolve_get(&entry)) {
+    COBJ_STATS_RECORD(COBJ_STAT_RESOLVE_CACHE_HIT, 1);
+  } else {
+    struct CObjTagBloom buf;
+    const struct CObjTagBloom *bloom =
+      CObjTagArray_bloom(self, &buf, 0) ? &buf : NULL;
+    struct CObjTagBloomKey key = {0};
+    if (bloom != NULL) {
+      key = CObjTagBloomKey_new(slot);
+    }
+    if (bloom != NULL && !CObjTagBloomKey_test(key, bloom->all)) {
+      // most misses are answered by the slot filter alone
+      COBJ_STATS_RECORD(COBJ_STAT_BLOOM_SKIP, 1);
+      COBJ_STATS_RECORD(COBJ_STAT_RESOLVE_MISS, 1);
+    } else {
+      entry.v = _CObjTagArray_resolve(
+        self, slot, bloom, key, &entry.target, &entry.offset);
+      CObjCacheResolve_put(&entry);
+      outcome = 0;
+    }
+  }
+  if (entry.v == NULL) {
+    outcome = -1;
   }
-  should (!CObjSlot_equal(slot, v->path)) otherwise {
-    CObjTagArray_TypeError(*target, "Alias tag %s@%d points to itself",
-                    slot->name, slot->ns);
+  COBJ_TRACE_END(
+    begin, COBJ_TRACE_RESOLVE, resolve, self, slot, outcome);
+  return_if_fail (entry.v != NULL) NULL;
+  if (target != NULL) {
+    *target = entry.target;
   }
-  return CObjTagArray_resolves(
-    tgt->virtual_ ? self : *target, v->path, target, offset);
+  if (offset != NULL) {
+    *offset = entry.offset;
+  }
+  return entry.v;
 }
 
 
@@ -99,7 +348,7 @@ const struct CObjVariant *CObjTagArray_resolve (
 const struct CObjVariant *CObjTagArray_resolves (
     const struct CObjTag *self, const struct CObjSlot *path,
     const struct CObjTag **target, int *offset) {
-  return_if_fail (CObjSlot_isnull(path)) NULL;
+  return_if_fail (!CObjSlot_isnull(path)) NULL;
   for (; ; path++) {
     const struct CObjVariant *v = CObjTagArray_resolve(
       self, path, target, offset);
@@ -110,15 +359,16 @@ const struct CObjVariant *CObjTagArray_resolves (
 }
 
 
-bool _CObjTagArray_is_derived (
+static bool _CObjTagArray_is_derived (
     const struct CObjTag *self, const struct CObjTag *base) {
   const struct CObjTag *super = CObjTagArray_next_public(self - 1);
   return_if_fail (super != NULL) false;
   for (const struct CObjTag *next_super = super; ; super = next_super) {
     next_super = CObjTagArray_next_public(next_super);
-    return_if_fail (next_super != NULL) _CObjTagArray_is_derived(super, base);
-    return_if_fail (self != base) true;
-    return_if (_CObjTagArray_is_derived(super, base)) true;
+    return_if_fail (super->tags != base) true;
+    return_if_fail (next_super != NULL)
+      _CObjTagArray_is_derived(super->tags, base);
+    return_if (_CObjTagArray_is_derived(super->tags, base)) true;
   }
 }
 
@@ -129,3 +379,176 @@ bool CObjTagArray_is_derived (
   return_if_fail (self != NULL) false;
   return _CObjTagArray_is_derived(self, base);
 }
+
+
+struct CObjTagValidator {
+  /// tag set being validated
+  const struct CObjTag *self;
+  struct CObjTagError *errors;
+  int n;
+  /// number of found defects
+  int count;
+  /// alias tags and public tags being followed
+  const struct CObjTag *stack[COBJ_TAG_VALIDATE_DEPTH];
+  int depth;
+};
+
+
+static void CObjTagValidator_report (
+    struct CObjTagValidator *self, int kind, const struct CObjTag *tags,
+    const struct CObjTag *tag) {
+  // the same defect is reached from every alias passing through it
+  for (int i = 0; i < min(self->count, self->n); i++) {
+    return_if (self->errors[i].kind == kind && self->errors[i].tags == tags &&
+               self->errors[i].tag == tag);
+  }
+  if (self->count < self->n) {
+    self->errors[self->count] =
+      (struct CObjTagError) {.kind = kind, .tags = tags, .tag = tag};
+  }
+  self->count++;
+}
+
+
+// push tag onto the stack, or report a cycle
+static bool CObjTagValidator_push (
+    struct CObjTagValidator *self, const struct CObjTag *tags,
+    const struct CObjTag *tag) {
+  for (int i = 0; i < self->depth; i++) {
+    should (self->stack[i] != tag) otherwise {
+      CObjTagValidator_report(self, COBJ_TAG_ERROR_CYCLE, tags, tag);
+      return false;
+    }
+  }
+  should (self->depth < COBJ_TAG_VALIDATE_DEPTH) otherwise {
+    CObjTagValidator_report(self, COBJ_TAG_ERROR_CYCLE, tags, tag);
+    return false;
+  }
+  self->stack[self->depth++] = tag;
+  return true;
+}
+
+
+static const struct CObjTag *CObjTagValidator_alias (
+    struct CObjTagValidator *self, const struct CObjTag *tags,
+    const struct CObjTag *tag);
+
+
+// check-free counterpart of _CObjTagArray_resolve()
+static const struct CObjTag *CObjTagValidator_resolve (
+    struct CObjTagValidator *self, const struct CObjTag *tags,
+    const struct CObjSlot *slot) {
+  const struct CObjTag *target;
+  const struct CObjTag *tag = CObjTagArray_resolve_simple(
+    tags, slot, NULL, (struct CObjTagBloomKey) {0}, &target, NULL, 0, 0);
+  return_if_fail (tag != NULL) NULL;
+  return_if (CObjVariant_isvalid(&tag->data)) tag;
+  return CObjTagValidator_alias(self, target, tag);
+}
+
+
+// follow alias tag, which belongs to tag set tags
+static const struct CObjTag *CObjTagValidator_alias (
+    struct CObjTagValidator *self, const struct CObjTag *tags,
+    const struct CObjTag *tag) {
+  should (tag->path != NULL && !CObjSlot_isnull(tag->path)) otherwise {
+    CObjTagValidator_report(self, COBJ_TAG_ERROR_PATH, tags, tag);
+    return NULL;
+  }
+  return_if_fail (CObjTagValidator_push(self, tags, tag)) NULL;
+
+  int count = self->count;
+  const struct CObjTag *base = tag->virtual_ ? self->self : tags;
+  const struct CObjTag *ret;
+  for (const struct CObjSlot *path = tag->path; ; path++) {
+    ret = CObjTagValidator_resolve(self, base, path);
+    break_if (ret == NULL || CObjSlot_isnull(path + 1));
+    should (ret->type == COBJ_TYPE_TAGS && ret->tags != NULL) otherwise {
+      ret = NULL;
+      break;
+    }
+    base = ret->tags;
+  }
+  self->depth--;
+
+  // report only the innermost defect of a chain
+  if (ret == NULL && self->count == count) {
+    CObjTagValidator_report(self, COBJ_TAG_ERROR_DANGLING, tags, tag);
+  }
+  return ret;
+}
+
+
+// get static size of tag set, 0 if dynamic, or -1 if missing
+static long CObjTagValidator_size (
+    struct CObjTagValidator *self, const struct CObjTag *tags) {
+  static const struct CObjSlot slot_size = {.name = "size"};
+  int count = self->count;
+  const struct CObjTag *tag = CObjTagValidator_resolve(self, tags, &slot_size);
+  if (tag == NULL) {
+    if (self->count == count) {
+      CObjTagValidator_report(self, COBJ_TAG_ERROR_SIZE, tags, NULL);
+    }
+    return -1;
+  }
+  switch (tag->type) {
+    case COBJ_TYPE_CMETHODS:
+    case COBJ_TYPE_FUNC:
+      return 0;
+    case COBJ_TYPE_UNDEFINED:
+      return_if (tag->value > 0) tag->value;
+      // fall through
+    default:
+      CObjTagValidator_report(self, COBJ_TAG_ERROR_SIZE, tags, tag);
+      return -1;
+  }
+}
+
+
+static void CObjTagValidator_visit (
+    struct CObjTagValidator *self, const struct CObjTag *tags) {
+  long size = CObjTagValidator_size(self, tags);
+  for (const struct CObjTag *tag = tags; !CObjTag_isnull(tag); tag++) {
+    switch (tag->type) {
+      case COBJ_TYPE_PATH:
+        (void) CObjTagValidator_alias(self, tags, tag);
+        break;
+      case COBJ_TYPE_TAGS:
+        continue_if_not (tag->public_ && tag->tags != NULL);
+        long super_size = CObjTagValidator_size(self, tag->tags);
+        if (size > 0 && super_size > 0 && tag->offset + super_size > size) {
+          CObjTagValidator_report(self, COBJ_TAG_ERROR_OFFSET, tags, tag);
+        }
+        CObjTagValidator_visit(self, tag->tags);
+        break;
+    }
+  }
+}
+
+
+// check that public tag sets do not form a cycle, which would make resolving
+// recurse forever
+static void CObjTagValidator_visit_supers (
+    struct CObjTagValidator *self, const struct CObjTag *tags) {
+  for (const struct CObjTag *super = CObjTagArray_find_public(tags);
+       super != NULL; super = CObjTagArray_next_public(super)) {
+    continue_if_fail (CObjTagValidator_push(self, tags, super));
+    CObjTagValidator_visit_supers(self, super->tags);
+    self->depth--;
+  }
+}
+
+
+int CObjTagArray_validate (
+    const struct CObjTag *self, struct CObjTagError *errors, int n) {
+  struct CObjTagValidator validator = {
+    .self = self, .errors = errors, .n = errors == NULL ? 0 : max(n, 0)};
+  CObjTagValidator_visit_supers(&validator, self);
+  if (validator.count == 0) {
+    CObjTagValidator_visit(&validator, self);
+  }
+  if (validator.count == 0) {
+    CObjTagArray_set_validated(self);
+  }
+  return validator.count;
+}
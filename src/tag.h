@@ -7,6 +7,13 @@
 #include "slot.h"
 
 
+/// number of tag sets which can be marked as validated, must be power of 2
+#define COBJ_TAG_VALIDATED_SIZE 1024
+/// maximum number of entries probed for a tag set marked as validated
+#define COBJ_TAG_VALIDATED_PROBE 8
+/// maximum nesting of aliases and public tag sets followed by validation
+#define COBJ_TAG_VALIDATE_DEPTH 64
+
 __attribute__((copy(CObjSlot_isnull)))
 /**
  * @memberof CObjTag
@@ -54,7 +61,8 @@ __attribute__((pure, warn_unused_result, nonnull, access(read_only, 1)))
  * @param self Tag set.
  * @return First public tag, or @c NULL if not found.
  */
-const struct CObjTag *CObjTagArray_find_public (const struct CObjTag *self);
+COBJ_CORE_LOCAL const struct CObjTag *CObjTagArray_find_public (
+  const struct CObjTag *self);
 __attribute__((pure, warn_unused_result, access(read_only, 1),
                access(read_only, 2)))
 /**
@@ -65,8 +73,47 @@ __attribute__((pure, warn_unused_result, access(read_only, 1),
  * @param base Base tag set.
  * @return @c true if @p base is a subtype of @p self.
  */
-bool CObjTagArray_is_derived (
+COBJ_CORE_LOCAL bool CObjTagArray_is_derived (
   const struct CObjTag *self, const struct CObjTag *base);
+__attribute__((warn_unused_result, nonnull, access(read_only, 1),
+               access(read_only, 2), access(write_only, 3),
+               access(write_only, 4)))
+/**
+ * @memberof CObjTagArray
+ * @brief Resolve a slot name like CObjTagArray_resolve(), but without caches
+ *  and alias checks, for tag sets which may not pass CObjTagArray_validate().
+ *
+ * Defective aliases, and chains of more than #COBJ_TAG_VALIDATE_DEPTH aliases,
+ * resolve to @c NULL instead of raising a type error.
+ *
+ * @param self Tag set.
+ * @param slot Slot name.
+ * @param[out] target The target tag set.
+ * @param[out] offset Offset of the target tag set.
+ * @return Tag data, or @c NULL if not found.
+ */
+COBJ_CORE_LOCAL const struct CObjVariant *CObjTagArray_resolve_unchecked (
+  const struct CObjTag *self, const struct CObjSlot *slot,
+  const struct CObjTag **target, int *offset);
+
+__attribute__((warn_unused_result, nonnull, access(read_only, 1)))
+/**
+ * @memberof CObjTagArray
+ * @brief Test if tag set has passed CObjTagArray_validate().
+ *
+ * @param self Tag set.
+ * @return @c true if validated.
+ */
+COBJ_CORE_LOCAL bool CObjTagArray_isvalidated (
+  const struct CObjTag *self);
+/**
+ * @memberof CObjTagArray
+ * @brief Forget all tag sets marked as validated.
+ *
+ * Called by CObjCache_clear(), since a freed tag set may be followed by an
+ * unvalidated one at the same address.
+ */
+COBJ_CORE_LOCAL void CObjTagArray_clear_validated (void);
 
 
 #endif /* COBJ_TAG_H */
@@ -0,0 +1,254 @@
+#define _GNU_SOURCE
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "include/ctrace.h"
+#include "utils/error.h"
+#include "utils/macro.h"
+#include "utils/seqlock.h"
+#include "trace.h"
+
+
+#ifdef COBJ_TRACE
+
+struct CObjTraceEvent {
+  /// sequence number of the event in its ring
+  uint64_t index;
+  uint64_t begin;
+  uint64_t end;
+  /// name of the type, as printed by CObjTagArray_putname(), truncated
+  char type[COBJ_TRACE_NAME_SIZE];
+  struct CObjSlot slot;
+  int outcome;
+  int kind;
+};
+
+struct CObjTraceSlot {
+  unsigned seq;
+  struct CObjTraceEvent event;
+};
+
+struct CObjTraceRing {
+  struct CObjTraceRing *next;
+  /// number of events ever recorded, only written by the owner thread
+  uint64_t head;
+  /// events before this are cleared
+  uint64_t tail;
+  pid_t tid;
+  /// whether the owner thread has exited
+  bool retired;
+  /// stream writing into CObjTraceRing::name, used by the owner thread
+  FILE *name_stream;
+  char name[COBJ_TRACE_NAME_SIZE];
+  struct CObjTraceSlot slots[COBJ_TRACE_RING_SIZE];
+};
+
+bool CObjTrace_enabled;
+
+static _Thread_local struct CObjTraceRing *local_ring;
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct CObjTraceRing *rings;
+static pthread_key_t rings_key;
+static pthread_once_t rings_key_once = PTHREAD_ONCE_INIT;
+
+
+static void CObjTraceRing_retire (void *data) {
+  struct CObjTraceRing *self = data;
+  fclose(self->name_stream);
+  // kept until CObjTrace_clear(), so that its events can still be exported
+  __atomic_store_n(&self->retired, true, __ATOMIC_RELEASE);
+}
+
+
+static void CObjTraceRing_key_init (void) {
+  pthread_key_create(&rings_key, CObjTraceRing_retire);
+}
+
+
+static struct CObjTraceRing *CObjTraceRing_local (void) {
+  return_if (local_ring != NULL) local_ring;
+
+  struct CObjTraceRing *ring = calloc(1, sizeof(*ring));
+  return_if_fail (ring != NULL) NULL;
+  ring->name_stream = fmemopen(ring->name, sizeof(ring->name), "w");
+  should (ring->name_stream != NULL) otherwise {
+    free(ring);
+    return NULL;
+  }
+  ring->tid = gettid();
+  pthread_once(&rings_key_once, CObjTraceRing_key_init);
+  pthread_setspecific(rings_key, ring);
+
+  pthread_mutex_lock(&rings_lock);
+  ring->next = rings;
+  rings = ring;
+  pthread_mutex_unlock(&rings_lock);
+
+  local_ring = ring;
+  return ring;
+}
+
+
+uint64_t CObjTrace_now (void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+// print name of type into name, truncated
+static void CObjTraceRing_putname (
+    struct CObjTraceRing *self, const struct CObjTag *type, char *name) {
+  memset(self->name, 0, sizeof(self->name));
+  rewind(self->name_stream);
+  CObjTagArray_putname(type, self->name_stream);
+  fflush(self->name_stream);
+  memcpy(name, self->name, sizeof(self->name) - 1);
+  name[sizeof(self->name) - 1] = '\0';
+}
+
+
+void CObjTrace_record (
+    int kind, uint64_t begin, const struct CObjTag *type,
+    const struct CObjSlot *slot, int outcome) {
+  uint64_t end = CObjTrace_now();
+  struct CObjTraceRing *ring = CObjTraceRing_local();
+  return_if_fail (ring != NULL);
+
+  // the type may be freed before events are exported
+  struct CObjTraceEvent event = {
+    .begin = begin, .end = end, .slot = *slot, .outcome = outcome,
+    .kind = kind};
+  if (type != NULL) {
+    CObjTraceRing_putname(ring, type, event.type);
+  }
+
+  uint64_t index = ring->head;
+  event.index = index;
+  struct CObjTraceSlot *entry =
+    ring->slots + (index & (COBJ_TRACE_RING_SIZE - 1));
+  unsigned seq;
+  return_if_fail (seqlock_write_begin(&entry->seq, &seq));
+  entry->event = event;
+  seqlock_write_end(&entry->seq, seq);
+  __atomic_store_n(&ring->head, index + 1, __ATOMIC_RELEASE);
+}
+
+
+static void json_putstr (const char *s, size_t len, FILE *stream) {
+  for (size_t i = 0; i < len && s[i] != '\0'; i++) {
+    unsigned char c = s[i];
+    if (c == '"' || c == '\\') {
+      fputc('\\', stream);
+      fputc(c, stream);
+    } else if (c < 0x20) {
+      fprintf(stream, "\\u%04x", c);
+    } else {
+      fputc(c, stream);
+    }
+  }
+}
+
+
+static void CObjTraceEvent_put (
+    const struct CObjTraceEvent *self, pid_t pid, pid_t tid, FILE *stream) {
+  static const char * const kind_names[] = {
+    [COBJ_TRACE_CONTEXT_INIT] = "context_init",
+    [COBJ_TRACE_RESOLVE] = "resolve",
+    [COBJ_TRACE_ARRAY] = "array",
+  };
+  const char *kind = (unsigned) self->kind < arraysize(kind_names) ?
+    kind_names[self->kind] : "unknown";
+
+  fprintf(stream, "{\"name\": \"%s ", kind);
+  json_putstr(self->slot.name, sizeof(self->slot.name), stream);
+  fprintf(stream, "\", \"cat\": \"cobj\", \"ph\": \"X\", "
+          "\"ts\": %" PRIu64 ".%03u, \"dur\": %" PRIu64 ".%03u, "
+          "\"pid\": %d, \"tid\": %d, \"args\": {\"type\": \"",
+          self->begin / 1000, (unsigned) (self->begin % 1000),
+          (self->end - self->begin) / 1000,
+          (unsigned) ((self->end - self->begin) % 1000), (int) pid, (int) tid);
+  json_putstr(self->type, sizeof(self->type), stream);
+  fputs("\", \"slot\": \"", stream);
+  json_putstr(self->slot.name, sizeof(self->slot.name), stream);
+  fprintf(stream, "@%d\", \"outcome\": %d}}",
+          self->slot.ns, self->outcome);
+}
+
+
+bool CObjTrace_enable (bool enable) {
+  return __atomic_exchange_n(&CObjTrace_enabled, enable, __ATOMIC_RELAXED);
+}
+
+
+void CObjTrace_clear (void) {
+  pthread_mutex_lock(&rings_lock);
+  for (struct CObjTraceRing **p = &rings; *p != NULL; ) {
+    struct CObjTraceRing *ring = *p;
+    if (__atomic_load_n(&ring->retired, __ATOMIC_ACQUIRE)) {
+      *p = ring->next;
+      free(ring);
+    } else {
+      __atomic_store_n(
+        &ring->tail, __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE),
+        __ATOMIC_RELAXED);
+      p = &ring->next;
+    }
+  }
+  pthread_mutex_unlock(&rings_lock);
+}
+
+
+int CObjTrace_export (FILE *stream) {
+  pid_t pid = getpid();
+  int n = 0;
+  fputs("{\"traceEvents\": [", stream);
+  pthread_mutex_lock(&rings_lock);
+  for (struct CObjTraceRing *ring = rings; ring != NULL; ring = ring->next) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    if (head > COBJ_TRACE_RING_SIZE) {
+      tail = max(tail, head - COBJ_TRACE_RING_SIZE);
+    }
+    for (uint64_t i = tail; i < head; i++) {
+      const struct CObjTraceSlot *entry =
+        ring->slots + (i & (COBJ_TRACE_RING_SIZE - 1));
+      unsigned seq = seqlock_read_begin(&entry->seq);
+      struct CObjTraceEvent event = entry->event;
+      // skip events being overwritten
+      continue_if_fail (seqlock_read_end(&entry->seq, seq) &&
+                        event.index == i);
+      fputs(n == 0 ? "\n" : ",\n", stream);
+      CObjTraceEvent_put(&event, pid, ring->tid, stream);
+      n++;
+    }
+  }
+  pthread_mutex_unlock(&rings_lock);
+  fputs("\n], \"displayTimeUnit\": \"ns\"}\n", stream);
+  return ferror(stream) ? -1 : n;
+}
+
+#else
+
+bool CObjTrace_enable (bool enable) {
+  (void) enable;
+  return false;
+}
+
+
+void CObjTrace_clear (void) { }
+
+
+int CObjTrace_export (FILE *stream) {
+  fputs("{\"traceEvents\": [], \"displayTimeUnit\": \"ns\"}\n", stream);
+  return ferror(stream) ? -1 : 0;
+}
+
+#endif
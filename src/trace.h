@@ -0,0 +1,67 @@
+#ifndef COBJ_TRACE_H
+#define COBJ_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "include/ctrace.h"
+#include "utils/macro.h"
+
+
+#ifdef COBJ_TRACE
+
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define COBJ_TRACE_PROBE(probe, type, slot, outcome) \
+  DTRACE_PROBE3(cobj, probe, type, slot, outcome)
+#else
+#define COBJ_TRACE_PROBE(probe, type, slot, outcome) ((void) 0)
+#endif
+
+/// whether events are recorded
+extern bool CObjTrace_enabled;
+
+__attribute__((warn_unused_result))
+/**
+ * @brief Get current timestamp.
+ *
+ * @return Timestamp in nanoseconds.
+ */
+uint64_t CObjTrace_now (void);
+
+__attribute__((nonnull(4)))
+/**
+ * @brief Record an event for the current thread.
+ *
+ * @param kind Event kind, see #CObjTraceKind.
+ * @param begin Timestamp when the event began.
+ * @param type Tag set, or @c NULL if unknown.
+ * @param slot Slot.
+ * @param outcome Outcome.
+ */
+void CObjTrace_record (
+  int kind, uint64_t begin, const struct CObjTag *type,
+  const struct CObjSlot *slot, int outcome);
+
+/// begin an event, declaring @p var to hold its timestamp
+#define COBJ_TRACE_BEGIN(var) \
+  uint64_t var = likely (!__atomic_load_n( \
+    &CObjTrace_enabled, __ATOMIC_RELAXED)) ? 0 : CObjTrace_now()
+/// end an event begun by COBJ_TRACE_BEGIN()
+#define COBJ_TRACE_END(var, kind, probe, type, slot, outcome) do { \
+  COBJ_TRACE_PROBE(probe, type, slot, outcome); \
+  if unlikely (var != 0) { \
+    CObjTrace_record(kind, var, type, slot, outcome); \
+  } \
+} while (0)
+
+#else
+
+#define COBJ_TRACE_BEGIN(var)
+#define COBJ_TRACE_END(var, kind, probe, type, slot, outcome) \
+  ((void) (slot), (void) (outcome))
+
+#endif
+
+
+#endif /* COBJ_TRACE_H */
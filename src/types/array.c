@@ -4,38 +4,9 @@
 #include "include/cmethod.h"
 #include "utils/macro.h"
 #include "allocator.h"
-
-
-
-static const struct CObjSlot slot_size = {.name = "size"};
-static const struct CObjSlot slot_isnull = {.name = "isnull"};
-static const struct CObjSlot slot_allocator = {.name = "allocator"};
-static const struct CObjSlot slot_super = {.name = "super"};
-static const struct CObjSlot slot_init = {.name = "init"};
-static const struct CObjSlot slot_destroy = {.name = "destroy"};
-
-static const struct CObjSlot path_1_super_size[] = {
-  {.name = {1}}, {.name = "super"}, {.name = "size"}, {{0}}};
-static const struct CObjSlot path_1_super[] = {
-  {.name = {1}}, {.name = "super"}, {{0}}};
-static const struct CObjSlot path_2_super[] = {
-  {.name = {2}}, {.name = "super"}, {{0}}};
-static const struct CObjSlot path_2_super_super[] = {
-  {.name = {2}}, {.name = "super"}, {.name = "super"}, {{0}}};
-
-static const struct CObjTrait trait_AsuperPeqBsuper_AsuperIsize[] = {
-  {.path = path_1_super, .value = {.path = path_2_super},
-   .cmp = COBJ_TRAIT_EQUAL},
-  {.path = path_1_super_size},
-  {0}
-};
-#define trait_AsuperIsize (trait_AsuperPeqBsuper_AsuperIsize + 1)
-static const struct CObjTrait trait_AsuperPeqBsuperIsuper_AsuperIsize[] = {
-  {.path = path_1_super, .value = {.path = path_2_super_super},
-   .cmp = COBJ_TRAIT_EQUAL},
-  {.path = path_1_super_size},
-  {0}
-};
+#include "stats.h"
+#include "trace.h"
+#include "type.h"
 
 
 const struct CObjTag *CMethodContext_super (const struct CMethodContext *self) {
@@ -49,86 +20,94 @@ const struct CObjTag *CMethodContext_super (const struct CMethodContext *self) {
 
 
 static bool memnull (const void *self, int len) {
+  const char *p = self;
   int i;
-  for (i = 0; i < (len & ~7); i += 8) {
-    return_if_fail (((const uint64_t *) self)[i] == 0) false;
+  for (i = 0; i + 8 <= len; i += 8) {
+    uint64_t word;
+    memcpy(&word, p + i, sizeof(word));
+    return_if_fail (word == 0) false;
   }
-  i -= 8;
   for (; i < len; i++) {
-    return_if_fail (((const char *) self)[i] == 0) false;
+    return_if_fail (p[i] == 0) false;
   }
   return true;
 }
 
 
-static int CMethodContext_init_copyer (
-    struct CMethodContext *self, const struct CObjTag *type,
-    struct CObjMsg *msg) {
-  const struct CObjTag *types[] = {type, type};
-  self->types = types;
-  self->len = 2;
-  self->msg = msg;
-  return CMethodContext_init(self, &slot_init);
-}
-
-
 int Pointer_init_copy (
     void **self, const void **other, const struct CMethodContext *ctx) {
-  const struct CObjTag *super = CMethodContext_super(ctx);
-  return_if_fail (super != NULL) 255;
+  return CObjDeep_copy_(
+    self, other, ctx->types[0], COBJ_DEEP_POINTER, ctx->msg);
+}
+const struct CMethod PointerType_init[] = {
+  {.func = (CObjFunc) Pointer_init_copy,
+   .traits = trait_AsuperPeqBsuper_AsuperIsize},
+  {0}
+};
 
-  int size = CObjTagArray_get0(super, &slot_size, *other);
-  return_if_fail (size >= 0) 255;
 
-  if unlikely (size == 0) {
-    *self = NULL;
-  } else {
-    const struct CObjAllocator *allocator =
-      (void *) CObjTagArray_get0(super, &slot_allocator, self);
-    *self = CObjAllocator_malloc(allocator, size);
-    return_if_fail (*self != NULL) -1;
-    struct CMethodContext context;
-    if (CMethodContext_init_copyer(&context, super, ctx->msg) != 0) {
-      memcpy(*self, *other, size);
-    } else {
-      int res = ((int (*) ()) context.func)(*self, *other, &context);
-      should (res == 0) otherwise {
-        CObjAllocator_free(allocator, *self);
-        return res;
-      }
-    }
-  }
+int Pointer_move (void **self, void **other, const struct CMethodContext *ctx) {
+  (void) ctx;
+  *self = *other;
+  *other = NULL;
   return 0;
 }
-const struct CMethod PointerType_init[] = {
-  {.func = (CObjFunc) Pointer_init_copy,
+const struct CMethod PointerType_move[] = {
+  {.func = (CObjFunc) Pointer_move,
    .traits = trait_AsuperPeqBsuper_AsuperIsize},
   {0}
 };
 
 
-static int Array_len_ (
-    const void *self, int size, const struct CObjTag *super,
+void Pointer_destroy (void **self, const struct CMethodContext *ctx) {
+  CObjDeep_destroy_(self, ctx->types[0], COBJ_DEEP_POINTER, ctx->msg);
+}
+const struct CMethod PointerType_destroy[] = {
+  {.func = (CObjFunc) Pointer_destroy, .traits = trait_AsuperIsize},
+  {0}
+};
+
+
+long Pointer_deep_size (void *const *self, const struct CMethodContext *ctx) {
+  return CObjDeep_size_(self, ctx->types[0], COBJ_DEEP_POINTER, ctx->msg);
+}
+const struct CMethod PointerType_deep_size[] = {
+  {.func = (CObjFunc) Pointer_deep_size, .traits = trait_AsuperIsize},
+  {0}
+};
+
+
+int Array_len_ (
+    const void *self, int size, const struct CObjTypeInfo *info,
     struct CObjMsg *msg) {
   struct CMethodContext context;
-  context.types = &super;
-  context.len = 1;
-  context.msg = msg;
-  bool has_isnull = CMethodContext_init(&context, &slot_isnull) == 0;
+  const struct CObjTag *types[2];
+  bool has_isnull = CObjTypeInfo_context(
+    info, COBJ_TYPE_METHOD_ISNULL, &context, types, msg) == 0;
   int n;
   for (n = 0; has_isnull ?
         !((bool (*) ()) context.func)((char *) self + size * n, &context) :
         !memnull((char *) self + size * n, size); n++) { }
   return n;
 }
-int Array_len (const void *self, const struct CMethodContext *ctx) {
-  const struct CObjTag *super = CMethodContext_super(ctx);
-  return_if_fail (super != NULL) -1;
-
-  int size = CObjTagArray_get0(super, &slot_size, self);
+static int _Array_len (
+    const void *self, const struct CMethodContext *ctx) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info =
+    CObjTypeInfo_get(&buf, CMethodContext_super(ctx));
+  return_if_fail (info != NULL) -1;
+
+  int size = CObjTypeInfo_size(info, self);
   return_if_fail (size > 0) -1;
 
-  return Array_len_(self, size, super, ctx->msg);
+  return Array_len_(self, size, info, ctx->msg);
+}
+int Array_len (const void *self, const struct CMethodContext *ctx) {
+  COBJ_TRACE_BEGIN(begin);
+  int ret = _Array_len(self, ctx);
+  COBJ_TRACE_END(
+    begin, COBJ_TRACE_ARRAY, array, ctx->types[0], &slot_len, ret);
+  return ret;
 }
 const struct CMethod ArrayType_len[] = {
   {.func = (CObjFunc) Array_len, .traits = trait_AsuperIsize},
@@ -136,43 +115,51 @@ const struct CMethod ArrayType_len[] = {
 };
 
 
-int Array_size (const void *self, const struct CMethodContext *ctx) {
-  const struct CObjTag *super = CMethodContext_super(ctx);
-  return_if_fail (super != NULL) -1;
+static int _Array_size (
+    const void *self, const struct CMethodContext *ctx) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info =
+    CObjTypeInfo_get(&buf, CMethodContext_super(ctx));
+  return_if_fail (info != NULL) -1;
 
-  int size = CObjTagArray_get0(super, &slot_size, self);
+  int size = CObjTypeInfo_size(info, self);
   return_if_fail (size > 0) -1;
 
-  int n = Array_len_(self, size, super, ctx->msg);
+  int n = Array_len_(self, size, info, ctx->msg);
   return_if_fail (n >= 0) -1;
 
   return size * n;
 }
+int Array_size (const void *self, const struct CMethodContext *ctx) {
+  COBJ_TRACE_BEGIN(begin);
+  int ret = _Array_size(self, ctx);
+  COBJ_TRACE_END(
+    begin, COBJ_TRACE_ARRAY, array, ctx->types[0], &slot_size, ret);
+  return ret;
+}
 const struct CMethod ArrayType_size[] = {
   {.func = (CObjFunc) Array_size, .traits = trait_AsuperIsize},
   {0}
 };
 
 
-static void Array_destroy_ (void *self, int size, struct CMethodContext *ctx) {
-  ctx->len = 1;
-  if (CMethodContext_init(ctx, &slot_destroy) != 0) {
-    for (int i = 0; i < size; i++) {
-      ctx->func((char *) self + size * i, ctx);
+void Array_destroy_ (
+    void *self, int size, int n, const struct CObjTypeInfo *info,
+    struct CObjMsg *msg) {
+  struct CMethodContext context;
+  const struct CObjTag *types[2];
+  if (CObjTypeInfo_context(
+        info, COBJ_TYPE_METHOD_DESTROY, &context, types, msg) == 0) {
+    for (int i = 0; i < n; i++) {
+      context.func((char *) self + size * i, &context);
     }
   }
 }
 void Array_destroy (void *self, struct CMethodContext *ctx) {
-  const struct CObjTag *super = CMethodContext_super(ctx);
-  return_if_fail (super != NULL);
-
-  int size = CObjTagArray_get0(super, &slot_size, self);
-  return_if_fail (size > 0);
-
-  struct CMethodContext context;
-  context.types = &super;
-  context.msg = ctx->msg;
-  Array_destroy_(self, size, &context);
+  COBJ_TRACE_BEGIN(begin);
+  CObjDeep_destroy_(self, ctx->types[0], COBJ_DEEP_ARRAY, ctx->msg);
+  COBJ_TRACE_END(
+    begin, COBJ_TRACE_ARRAY, array, ctx->types[0], &slot_destroy, 0);
 }
 const struct CMethod ArrayType_destroy[] = {
   {.func = (CObjFunc) Array_destroy, .traits = trait_AsuperIsize},
@@ -180,26 +167,55 @@ const struct CMethod ArrayType_destroy[] = {
 };
 
 
+long Array_deep_size (const void *self, const struct CMethodContext *ctx) {
+  return CObjDeep_size_(self, ctx->types[0], COBJ_DEEP_ARRAY, ctx->msg);
+}
+const struct CMethod ArrayType_deep_size[] = {
+  {.func = (CObjFunc) Array_deep_size, .traits = trait_AsuperIsize},
+  {0}
+};
+
+
 int Array_init_copy (
     void *self, const void *other, const struct CMethodContext *ctx) {
-  const struct CObjTag *super = CMethodContext_super(ctx);
-  return_if_fail (super != NULL) 255;
+  COBJ_TRACE_BEGIN(begin);
+  int ret = CObjDeep_copy_(
+    self, other, ctx->types[0], COBJ_DEEP_ARRAY, ctx->msg);
+  COBJ_TRACE_END(
+    begin, COBJ_TRACE_ARRAY, array, ctx->types[0], &slot_init, ret);
+  return ret;
+}
+static int _Array_init_flatten (
+    void *self, const void **other, const struct CMethodContext *ctx) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info =
+    CObjTypeInfo_get(&buf, CMethodContext_super(ctx));
+  return_if_fail (info != NULL) 255;
 
-  int size = CObjTagArray_get0(super, &slot_size, other);
+  int size = CObjTypeInfo_size(info, other[0]);
   return_if_fail (size > 0) 255;
 
-  int n = Array_len_(other, size, super, ctx->msg);
+  int n;
+  for (n = 0; other[n] != NULL; n++) { }
   return_if (n == 0) 0;
 
   struct CMethodContext context;
-  if (CMethodContext_init_copyer(&context, super, ctx->msg) != 0) {
-    memcpy(self, other, size * n);
+  const struct CObjTag *types[2];
+  bool has_copyer = CObjTypeInfo_context(
+    info, COBJ_TYPE_METHOD_INIT, &context, types, ctx->msg) == 0;
+  if (has_copyer) {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_METHOD, n);
   } else {
-    for (int i = 0; i < n; i++) {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_MEMCPY, size * n);
+  }
+  for (int i = 0; i < n; i++) {
+    if (!has_copyer) {
+      memcpy((char *) self + size * i, other[i], size);
+    } else {
       int res = ((int (*) ()) context.func)(
-        (char *) self + size * i, (char *) other + size * i, &context);
+        (char *) self + size * i, other[i], &context);
       should (res == 0) otherwise {
-        Array_destroy_(self, size, &context);
+        Array_destroy_(self, size, i, info, ctx->msg);
         return res;
       }
     }
@@ -208,36 +224,126 @@ int Array_init_copy (
 }
 int Array_init_flatten (
     void *self, const void **other, const struct CMethodContext *ctx) {
-  const struct CObjTag *super = CMethodContext_super(ctx);
-  return_if_fail (super != NULL) 255;
+  COBJ_TRACE_BEGIN(begin);
+  int ret = _Array_init_flatten(self, other, ctx);
+  COBJ_TRACE_END(
+    begin, COBJ_TRACE_ARRAY, array, ctx->types[0], &slot_init, ret);
+  return ret;
+}
+const struct CMethod ArrayType_init[] = {
+  {.func = (CObjFunc) Array_init_copy,
+   .traits = trait_AsuperPeqBsuper_AsuperIsize},
+  {.func = (CObjFunc) Array_init_flatten,
+   .traits = trait_AsuperPeqBsuperIsuper_AsuperIsize},
+  {0}
+};
+
+
+// move the first n elements of self back into other, which holds len elements,
+// after a failed move; should that fail too, the elements not moved back are
+// destroyed, and other is terminated before them
+static void Array_restore_ (
+    void *self, void *other, int size, int n, int len,
+    const struct CObjTypeInfo *info, const struct CMethodContext *move,
+    struct CObjMsg *msg) {
+  struct CMethodContext destroy;
+  const struct CObjTag *types[2];
+  bool has_destroy = CObjTypeInfo_context(
+    info, COBJ_TYPE_METHOD_DESTROY, &destroy, types, msg) == 0;
+
+  for (int i = 0; i < n; i++) {
+    char *dst = (char *) other + size * i;
+    char *src = (char *) self + size * i;
+    // the moved-from element is destroyed before being overwritten
+    if (has_destroy) {
+      destroy.func(dst, &destroy);
+    }
+    continue_if (((int (*) ()) move->func)(dst, src, move) == 0);
+    Array_destroy_(src, size, n - i, info, msg);
+    Array_destroy_(dst + size, size, len - i - 1, info, msg);
+    memcpy(dst, (char *) other + size * len, size);
+    return;
+  }
+}
+
+
+static int _Array_move (
+    void *self, void *other, const struct CMethodContext *ctx) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info =
+    CObjTypeInfo_get(&buf, CMethodContext_super(ctx));
+  return_if_fail (info != NULL) 255;
 
-  int size = CObjTagArray_get0(super, &slot_size, other[0]);
+  int size = CObjTypeInfo_size(info, other);
   return_if_fail (size > 0) 255;
 
-  int n;
-  for (n = 0; other[n] != NULL; n++) { }
+  int n = Array_len_(other, size, info, ctx->msg);
   return_if (n == 0) 0;
 
   struct CMethodContext context;
-  bool has_copyer = CMethodContext_init_copyer(&context, super, ctx->msg) != 0;
-  for (int i = 0; i < n; i++) {
-    if (!has_copyer) {
-      memcpy((char *) self + size * i, other[i], size);
-    } else {
+  const struct CObjTag *types[2];
+  if (CObjTypeInfo_context(
+        info, COBJ_TYPE_METHOD_MOVE, &context, types, ctx->msg) == 0) {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_METHOD, n);
+    for (int i = 0; i < n; i++) {
       int res = ((int (*) ()) context.func)(
-        (char *) self + size * i, other[i], &context);
+        (char *) self + size * i, (char *) other + size * i, &context);
       should (res == 0) otherwise {
-        Array_destroy_(self, size, &context);
+        Array_restore_(self, other, size, i, n, info, &context, ctx->msg);
         return res;
       }
     }
+    return 0;
+  }
+
+  COBJ_STATS_RECORD(COBJ_STAT_COPY_MEMCPY, size * n);
+  memcpy(self, other, size * n);
+  // elements with a destructor own resources; relocate them by leaving the
+  // source empty, with a copy of its own terminator, which is null even if
+  // not all zero bytes
+  if (info->methods[COBJ_TYPE_METHOD_DESTROY].res == 0) {
+    memcpy(other, (char *) other + size * n, size);
   }
   return 0;
 }
-const struct CMethod ArrayType_init[] = {
-  {.func = (CObjFunc) Array_init_copy,
+int Array_move (void *self, void *other, const struct CMethodContext *ctx) {
+  COBJ_TRACE_BEGIN(begin);
+  int ret = _Array_move(self, other, ctx);
+  COBJ_TRACE_END(
+    begin, COBJ_TRACE_ARRAY, array, ctx->types[0], &slot_move, ret);
+  return ret;
+}
+const struct CMethod ArrayType_move[] = {
+  {.func = (CObjFunc) Array_move,
    .traits = trait_AsuperPeqBsuper_AsuperIsize},
-  {.func = (CObjFunc) Array_init_flatten,
-   .traits = trait_AsuperPeqBsuperIsuper_AsuperIsize},
+  {0}
+};
+
+
+static int Array_sort_ (
+    void *self, int flags, const struct CMethodContext *ctx) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info =
+    CObjTypeInfo_get(&buf, CMethodContext_super(ctx));
+  return_if_fail (info != NULL) 255;
+
+  int size = CObjTypeInfo_size(info, self);
+  return_if_fail (size > 0) 255;
+
+  int n = Array_len_(self, size, info, ctx->msg);
+  return CObjArray_sort(self, n, info->self, flags, 1, ctx->msg);
+}
+int Array_sort (void *self, const struct CMethodContext *ctx) {
+  return Array_sort_(self, 0, ctx);
+}
+const struct CMethod ArrayType_sort[] = {
+  {.func = (CObjFunc) Array_sort, .traits = trait_AsuperIsize},
+  {0}
+};
+int Array_stable_sort (void *self, const struct CMethodContext *ctx) {
+  return Array_sort_(self, COBJ_SORT_STABLE, ctx);
+}
+const struct CMethod ArrayType_stable_sort[] = {
+  {.func = (CObjFunc) Array_stable_sort, .traits = trait_AsuperIsize},
   {0}
 };
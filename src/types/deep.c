@@ -0,0 +1,426 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include/cmethod.h"
+#include "utils/macro.h"
+#include "allocator.h"
+#include "stats.h"
+#include "type.h"
+
+
+/// number of nodes kept on the C stack before the work stack is allocated
+#define COBJ_DEEP_INLINE 16
+
+static const struct CObjSlot slot_deep_size = {.name = "deep_size"};
+
+/// Pointer or array being traversed.
+struct CObjDeepNode {
+  /// CObjDeepKind, either pointer or array
+  int kind;
+  /// CObjDeepKind of the pointee or elements
+  int super_kind;
+  /// object
+  void *self;
+  /// source object when copying, otherwise @c NULL
+  const void *other;
+  /// pointee or element type
+  const struct CObjTag *super;
+  /// size of the pointee or elements
+  long size;
+  /// allocator of the pointee
+  const struct CObjAllocator *allocator;
+  /// number of elements
+  int n;
+  /// number of elements visited, or whether the pointee is visited
+  int i;
+};
+
+/// Explicit stack of nodes.
+struct CObjDeepStack {
+  struct CObjDeepNode *nodes;
+  size_t len;
+  size_t cap;
+  struct CObjDeepNode inline_[COBJ_DEEP_INLINE];
+};
+
+
+int CObjDeep_kind (const struct CObjTypeInfo *info) {
+  CObjFunc init = info->methods[COBJ_TYPE_METHOD_INIT].func;
+  CObjFunc destroy = info->methods[COBJ_TYPE_METHOD_DESTROY].func;
+  return_if (init == (CObjFunc) Pointer_init_copy ||
+             destroy == (CObjFunc) Pointer_destroy) COBJ_DEEP_POINTER;
+  return_if (init == (CObjFunc) Array_init_copy ||
+             destroy == (CObjFunc) Array_destroy) COBJ_DEEP_ARRAY;
+  return COBJ_DEEP_LEAF;
+}
+
+
+static void CObjDeepStack_init (struct CObjDeepStack *self) {
+  self->nodes = self->inline_;
+  self->len = 0;
+  self->cap = COBJ_DEEP_INLINE;
+}
+
+
+static void CObjDeepStack_destroy (struct CObjDeepStack *self) {
+  if (self->nodes != self->inline_) {
+    free(self->nodes);
+  }
+}
+
+
+static inline struct CObjDeepNode *CObjDeepStack_top (
+    struct CObjDeepStack *self) {
+  return self->nodes + self->len - 1;
+}
+
+
+// size of a terminated array pointee, or -1 if invalid
+static long CObjDeep_array_size (
+    const void *self, const struct CObjTypeInfo *info, struct CObjMsg *msg) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *elem_info = CObjTypeInfo_get(&buf, info->super);
+  return_if_fail (elem_info != NULL) -1;
+  long size = CObjTypeInfo_size(elem_info, self);
+  return_if_fail (size > 0) -1;
+  return size * (Array_len_(self, size, elem_info, msg) + 1);
+}
+
+
+// push a node of the given kind, or of the kind of type if COBJ_DEEP_LEAF
+static int CObjDeepStack_push (
+    struct CObjDeepStack *self, void *obj, const void *other,
+    const struct CObjTag *type, int kind, struct CObjMsg *msg) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info = CObjTypeInfo_get(&buf, type);
+  return_if_fail (info != NULL) 255;
+  if (kind == COBJ_DEEP_LEAF) {
+    kind = CObjDeep_kind(info);
+  }
+  const struct CObjTypeInfo *super_info = CObjTypeInfo_get(&buf, info->super);
+  return_if_fail (super_info != NULL) 255;
+
+  struct CObjDeepNode node = {
+    .kind = kind, .super_kind = CObjDeep_kind(super_info), .self = obj,
+    .other = other, .super = super_info->self};
+  const void *src = other != NULL ? other : obj;
+  if (kind == COBJ_DEEP_POINTER) {
+    const void *pointee = *(void *const *) src;
+    // arrays are allocated with their terminator
+    node.size = pointee == NULL ? 0 :
+      node.super_kind == COBJ_DEEP_ARRAY ?
+        CObjDeep_array_size(pointee, super_info, msg) :
+        CObjTypeInfo_size(super_info, pointee);
+    return_if_fail (node.size >= 0) 255;
+    node.allocator = CObjTypeInfo_allocator(super_info, obj);
+  } else {
+    node.size = CObjTypeInfo_size(super_info, src);
+    return_if_fail (node.size > 0) 255;
+    node.n = Array_len_(src, node.size, super_info, msg);
+  }
+
+  if (self->len >= self->cap) {
+    size_t cap = self->cap * 2;
+    struct CObjDeepNode *nodes = malloc(sizeof(nodes[0]) * cap);
+    return_if_fail (nodes != NULL) -1;
+    memcpy(nodes, self->nodes, sizeof(nodes[0]) * self->len);
+    CObjDeepStack_destroy(self);
+    self->nodes = nodes;
+    self->cap = cap;
+  }
+  self->nodes[self->len++] = node;
+  return 0;
+}
+
+
+// copy n leaves, destroying the copied ones on failure
+static int CObjDeep_copy_leaves (
+    void *self, const void *other, int n, long size,
+    const struct CObjTag *type, struct CObjMsg *msg) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info = CObjTypeInfo_get(&buf, type);
+  return_if_fail (info != NULL) 255;
+
+  struct CMethodContext context;
+  const struct CObjTag *types[2];
+  if (CObjTypeInfo_context(
+        info, COBJ_TYPE_METHOD_INIT, &context, types, msg) != 0) {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_MEMCPY, size * n);
+    memcpy(self, other, size * n);
+    return 0;
+  }
+  COBJ_STATS_RECORD(COBJ_STAT_COPY_METHOD, n);
+  for (int i = 0; i < n; i++) {
+    int res = ((int (*) ()) context.func)(
+      (char *) self + size * i, (const char *) other + size * i, &context);
+    should (res == 0) otherwise {
+      Array_destroy_(self, size, i, info, msg);
+      return res;
+    }
+  }
+  return 0;
+}
+
+
+static void CObjDeep_destroy_leaves (
+    void *self, int n, long size, const struct CObjTag *type,
+    struct CObjMsg *msg) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info = CObjTypeInfo_get(&buf, type);
+  return_if_fail (info != NULL);
+  Array_destroy_(self, size, n, info, msg);
+}
+
+
+static long CObjDeep_size_leaves (
+    const void *self, int n, long size, const struct CObjTag *type,
+    struct CObjMsg *msg) {
+  struct CMethodContext context;
+  context.types = &type;
+  context.len = 1;
+  context.msg = msg;
+  return_if_fail (CMethodContext_init(&context, &slot_deep_size) == 0) 0;
+  long ret = 0;
+  for (int i = 0; i < n; i++) {
+    long res = ((long (*) ()) context.func)(
+      (const char *) self + size * i, &context);
+    return_if_fail (res >= 0) -1;
+    ret += res;
+  }
+  return ret;
+}
+
+
+int CObjDeep_copy_ (
+    void *self, const void *other, const struct CObjTag *type, int kind,
+    struct CObjMsg *msg) {
+  struct CObjDeepStack stack;
+  CObjDeepStack_init(&stack);
+  // result of the last finished node
+  int res = CObjDeepStack_push(&stack, self, other, type, kind, msg);
+
+  while (stack.len > 0) {
+    struct CObjDeepNode *node = CObjDeepStack_top(&stack);
+    if (node->kind == COBJ_DEEP_POINTER) {
+      void **dst = node->self;
+      void *const *src = node->other;
+      if (node->i > 0) {
+        // pointee finished
+        if (res != 0) {
+          CObjAllocator_free(node->allocator, *dst);
+          *dst = NULL;
+        }
+        stack.len--;
+        continue;
+      }
+      node->i = 1;
+      if (*src == NULL || node->size == 0) {
+        *dst = NULL;
+        res = 0;
+        stack.len--;
+        continue;
+      }
+      *dst = CObjAllocator_malloc(node->allocator, node->size);
+      if (*dst == NULL) {
+        res = -1;
+        stack.len--;
+        continue;
+      }
+      if (node->super_kind == COBJ_DEEP_LEAF) {
+        res = CObjDeep_copy_leaves(*dst, *src, 1, node->size, node->super, msg);
+      } else {
+        if (node->super_kind == COBJ_DEEP_ARRAY) {
+          memset(*dst, 0, node->size);
+        }
+        res = CObjDeepStack_push(
+          &stack, *dst, *src, node->super, node->super_kind, msg);
+        continue_if (res == 0);
+      }
+      // pointee finished, or could not be started
+      if (res != 0) {
+        CObjAllocator_free(node->allocator, *dst);
+        *dst = NULL;
+      }
+      stack.len--;
+      continue;
+    }
+
+    if (node->super_kind == COBJ_DEEP_LEAF) {
+      res = CObjDeep_copy_leaves(
+        node->self, node->other, node->n, node->size, node->super, msg);
+      stack.len--;
+      continue;
+    }
+    if ((node->i > 0 && res != 0) || node->i >= node->n) {
+      // the last element failed, or all are copied
+      if (res != 0) {
+        for (int i = 0; i < node->i - 1; i++) {
+          CObjDeep_destroy_(
+            (char *) node->self + node->size * i, node->super,
+            node->super_kind, msg);
+        }
+      }
+      stack.len--;
+      continue;
+    }
+    // an element which cannot be started counts as failed
+    int i = node->i++;
+    res = CObjDeepStack_push(
+      &stack, (char *) node->self + node->size * i,
+      (const char *) node->other + node->size * i, node->super,
+      node->super_kind, msg);
+  }
+
+  CObjDeepStack_destroy(&stack);
+  return res;
+}
+
+
+void CObjDeep_destroy_ (
+    void *self, const struct CObjTag *type, int kind, struct CObjMsg *msg) {
+  struct CObjDeepStack stack;
+  CObjDeepStack_init(&stack);
+  return_if_fail (CObjDeepStack_push(&stack, self, NULL, type, kind, msg) == 0);
+
+  while (stack.len > 0) {
+    struct CObjDeepNode *node = CObjDeepStack_top(&stack);
+    void *child;
+    if (node->kind == COBJ_DEEP_POINTER) {
+      void **ptr = node->self;
+      if (node->i > 0 || *ptr == NULL) {
+        // pointee destroyed
+        CObjAllocator_free(node->allocator, *ptr);
+        *ptr = NULL;
+        stack.len--;
+        continue;
+      }
+      node->i = 1;
+      if (node->super_kind == COBJ_DEEP_LEAF) {
+        CObjDeep_destroy_leaves(*ptr, 1, node->size, node->super, msg);
+        continue;
+      }
+      child = *ptr;
+    } else {
+      if (node->super_kind == COBJ_DEEP_LEAF) {
+        CObjDeep_destroy_leaves(
+          node->self, node->n, node->size, node->super, msg);
+        stack.len--;
+        continue;
+      }
+      if (node->i >= node->n) {
+        stack.len--;
+        continue;
+      }
+      child = (char *) node->self + node->size * node->i++;
+    }
+
+    const struct CObjTag *super = node->super;
+    int super_kind = node->super_kind;
+    if (CObjDeepStack_push(&stack, child, NULL, super, super_kind, msg) < 0) {
+      // out of memory; fall back to recursion, which has its own stack
+      CObjDeep_destroy_(child, super, super_kind, msg);
+    }
+  }
+
+  CObjDeepStack_destroy(&stack);
+}
+
+
+long CObjDeep_size_ (
+    const void *self, const struct CObjTag *type, int kind,
+    struct CObjMsg *msg) {
+  struct CObjDeepStack stack;
+  CObjDeepStack_init(&stack);
+  int res = CObjDeepStack_push(
+    &stack, (void *) self, NULL, type, kind, msg);
+  return_if_fail (res == 0) res < 0 ? -1 : 0;
+
+  long ret = 0;
+  while (stack.len > 0) {
+    struct CObjDeepNode *node = CObjDeepStack_top(&stack);
+    const void *child;
+    if (node->kind == COBJ_DEEP_POINTER) {
+      void *const *ptr = node->self;
+      if (node->i > 0 || *ptr == NULL) {
+        stack.len--;
+        continue;
+      }
+      node->i = 1;
+      ret += node->size;
+      if (node->super_kind == COBJ_DEEP_LEAF) {
+        long size = CObjDeep_size_leaves(*ptr, 1, node->size, node->super, msg);
+        goto_if_fail (size >= 0) fail;
+        ret += size;
+        continue;
+      }
+      child = *ptr;
+    } else {
+      if (node->super_kind == COBJ_DEEP_LEAF) {
+        long size = CObjDeep_size_leaves(
+          node->self, node->n, node->size, node->super, msg);
+        goto_if_fail (size >= 0) fail;
+        ret += size;
+        stack.len--;
+        continue;
+      }
+      if (node->i >= node->n) {
+        stack.len--;
+        continue;
+      }
+      child = (const char *) node->self + node->size * node->i++;
+    }
+
+    res = CObjDeepStack_push(
+      &stack, (void *) child, NULL, node->super, node->super_kind, msg);
+    goto_if_fail (res >= 0) fail;
+  }
+
+  CObjDeepStack_destroy(&stack);
+  return ret;
+
+fail:
+  CObjDeepStack_destroy(&stack);
+  return -1;
+}
+
+
+int CObjDeep_copy (
+    void *self, const void *other, const struct CObjTag *type,
+    struct CObjMsg *msg) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info = CObjTypeInfo_get(&buf, type);
+  return_if_fail (info != NULL) 255;
+  int kind = CObjDeep_kind(info);
+  return_if (kind != COBJ_DEEP_LEAF)
+    CObjDeep_copy_(self, other, type, kind, msg);
+  long size = CObjTypeInfo_size(info, other);
+  return_if_fail (size > 0) 255;
+  return CObjDeep_copy_leaves(self, other, 1, size, type, msg);
+}
+
+
+void CObjDeep_destroy (
+    void *self, const struct CObjTag *type, struct CObjMsg *msg) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info = CObjTypeInfo_get(&buf, type);
+  return_if_fail (info != NULL);
+  int kind = CObjDeep_kind(info);
+  if (kind != COBJ_DEEP_LEAF) {
+    CObjDeep_destroy_(self, type, kind, msg);
+  } else {
+    CObjDeep_destroy_leaves(self, 1, 0, type, msg);
+  }
+}
+
+
+long CObjDeep_size (
+    const void *self, const struct CObjTag *type, struct CObjMsg *msg) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info = CObjTypeInfo_get(&buf, type);
+  return_if_fail (info != NULL) 0;
+  int kind = CObjDeep_kind(info);
+  return kind != COBJ_DEEP_LEAF ? CObjDeep_size_(self, type, kind, msg) :
+    CObjDeep_size_leaves(self, 1, 0, type, msg);
+}
@@ -1,13 +1,123 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
 #include "include/cmethod.h"
+#include "kernel.h"
+#include "type.h"
+
+
+static inline uint64_t mix_hash (uint64_t h) {
+  h *= 0x9e3779b97f4a7c15;
+  return h ^ (h >> 29);
+}
+
+
+// compare as unsigned integers of n bytes, in native byte order
+static inline int Imm_compare (const void *a, const void *b, unsigned n) {
+  uint64_t x[2] = {0};
+  uint64_t y[2] = {0};
+  memcpy(x, a, n);
+  memcpy(y, b, n);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  int high = n > 8;
+#else
+  int high = 0;
+#endif
+  if (x[high] != y[high]) {
+    return x[high] < y[high] ? -1 : 1;
+  }
+  return x[!high] < y[!high] ? -1 : x[!high] > y[!high];
+}
+
+
+static inline uint64_t Imm_hash (const void *self, unsigned n) {
+  uint64_t x[2] = {0};
+  memcpy(x, self, n);
+  return mix_hash(x[0] ^ mix_hash(x[1] + n));
+}
 
 
 #define COBJ_TYPEDEF_IMM(n) \
+  static bool Imm ## n ## _equal ( \
+      const void *self, const void *other, \
+      const struct CMethodContext *ctx) { \
+    (void) ctx; \
+    return memcmp(self, other, n) == 0; \
+  } \
+  static int Imm ## n ## _compare ( \
+      const void *self, const void *other, \
+      const struct CMethodContext *ctx) { \
+    (void) ctx; \
+    return Imm_compare(self, other, n); \
+  } \
+  static uint64_t Imm ## n ## _hash ( \
+      const void *self, const struct CMethodContext *ctx) { \
+    (void) ctx; \
+    return Imm_hash(self, n); \
+  } \
+  static ptrdiff_t Imm ## n ## _find ( \
+      const void *data, size_t len, const void *value, \
+      const struct CMethodContext *ctx) { \
+    (void) ctx; \
+    return CObjKernels_get()->find(data, len, value, n); \
+  } \
+  static void Imm ## n ## _fill ( \
+      void *data, size_t len, const void *value, \
+      const struct CMethodContext *ctx) { \
+    (void) ctx; \
+    CObjKernels_get()->fill(data, len, value, n); \
+  } \
+  static bool Imm ## n ## _array_equal ( \
+      const void *self, const void *other, size_t len, \
+      const struct CMethodContext *ctx) { \
+    (void) ctx; \
+    return CObjKernels_get()->equal(self, other, n * len); \
+  } \
+  static uint64_t Imm ## n ## _array_hash ( \
+      const void *data, size_t len, const struct CMethodContext *ctx) { \
+    (void) ctx; \
+    return CObjKernels_get()->hash(data, n * len); \
+  } \
+  static const struct CMethod Imm ## n ## _methods[][2] = { \
+    {{.func = (CObjFunc) Imm ## n ## _equal}, {0}}, \
+    {{.func = (CObjFunc) Imm ## n ## _compare}, {0}}, \
+    {{.func = (CObjFunc) Imm ## n ## _hash}, {0}}, \
+    {{.func = (CObjFunc) Imm ## n ## _find}, {0}}, \
+    {{.func = (CObjFunc) Imm ## n ## _fill}, {0}}, \
+    {{.func = (CObjFunc) Imm ## n ## _array_equal}, {0}}, \
+    {{.func = (CObjFunc) Imm ## n ## _array_hash}, {0}}, \
+  }; \
   const struct CObjTag Imm ## n ## Type[] = { \
     COBJ_TAG_SIZE(n), \
     COBJ_TAG_NAME("Imm" # n), \
+    {.name = "equal", .methods = Imm ## n ## _methods[0], \
+     .type = COBJ_TYPE_CMETHODS}, \
+    {.name = "compare", .methods = Imm ## n ## _methods[1], \
+     .type = COBJ_TYPE_CMETHODS}, \
+    {.name = "hash", .methods = Imm ## n ## _methods[2], \
+     .type = COBJ_TYPE_CMETHODS}, \
+    {.name = "find", .methods = Imm ## n ## _methods[3], \
+     .type = COBJ_TYPE_CMETHODS}, \
+    {.name = "fill", .methods = Imm ## n ## _methods[4], \
+     .type = COBJ_TYPE_CMETHODS}, \
+    {.name = "array_equal", .methods = Imm ## n ## _methods[5], \
+     .type = COBJ_TYPE_CMETHODS}, \
+    {.name = "array_hash", .methods = Imm ## n ## _methods[6], \
+     .type = COBJ_TYPE_CMETHODS}, \
+    COBJ_TAG_END \
   }
 COBJ_TYPEDEF_IMM(1);
 COBJ_TYPEDEF_IMM(2);
 COBJ_TYPEDEF_IMM(4);
 COBJ_TYPEDEF_IMM(8);
 COBJ_TYPEDEF_IMM(16);
+
+
+unsigned Imm_radix_width (CObjFunc func) {
+  return func == (CObjFunc) Imm1_compare ? 1 :
+    func == (CObjFunc) Imm2_compare ? 2 :
+    func == (CObjFunc) Imm4_compare ? 4 :
+    func == (CObjFunc) Imm8_compare ? 8 : 0;
+}
@@ -0,0 +1,76 @@
+#include <stdbool.h>
+
+#include "include/cmethod.h"
+#include "utils/macro.h"
+#include "type.h"
+
+
+// constant value of a property, or whether it is computed by a getter
+static long CObjTypeInfo_property (
+    const struct CObjTag *type, const struct CObjSlot *slot, bool *getter) {
+  const struct CObjTag *target;
+  int offset;
+  const struct CObjVariant *v =
+    CObjTagArray_resolve(type, slot, &target, &offset);
+  *getter = false;
+  return_if_fail (v != NULL) 0;
+  switch (v->type) {
+    case COBJ_TYPE_UNDEFINED:
+      return v->value;
+    case COBJ_TYPE_FUNC:
+      *getter = true;
+      return 0;
+    default:
+      return 0;
+  }
+}
+
+
+static void CObjTypeInfo_resolve (struct CObjTypeInfo *self) {
+  static const struct CObjSlot *const slots[COBJ_TYPE_METHOD_MAX] = {
+    [COBJ_TYPE_METHOD_ISNULL] = &slot_isnull,
+    [COBJ_TYPE_METHOD_LEN] = &slot_len,
+    [COBJ_TYPE_METHOD_INIT] = &slot_init,
+    [COBJ_TYPE_METHOD_DESTROY] = &slot_destroy,
+    [COBJ_TYPE_METHOD_MOVE] = &slot_move,
+  };
+
+  const struct CObjTag *type = self->self;
+  const struct CObjVariant *v = CObjTagArray_find(type, &slot_super);
+  self->super = v != NULL && v->type == COBJ_TYPE_TAGS ? v->tags : NULL;
+  self->size = CObjTypeInfo_property(type, &slot_size, &self->size_getter);
+  self->allocator = (void *) CObjTypeInfo_property(
+    type, &slot_allocator, &self->allocator_getter);
+
+  for (int i = 0; i < COBJ_TYPE_METHOD_MAX; i++) {
+    struct CObjTypeInfoMethod *m = self->methods + i;
+    struct CMethodContext context;
+    const struct CObjTag *types[2] = {type, type};
+    context.types = types;
+    context.len = i == COBJ_TYPE_METHOD_INIT || i == COBJ_TYPE_METHOD_MOVE ?
+      2 : 1;
+    context.msg = NULL;
+    m->res = CMethodContext_init(&context, slots[i]);
+    if (m->res == 0) {
+      m->func = context.func;
+      m->userdata = context.userdata;
+      m->traits = context.traits;
+      m->target = context.target;
+      m->offset = context.offset;
+    } else {
+      *m = (struct CObjTypeInfoMethod) {.res = m->res};
+    }
+  }
+}
+
+
+const struct CObjTypeInfo *CObjTypeInfo_get (
+    struct CObjTypeInfo *buf, const struct CObjTag *type) {
+  return_if_fail (type != NULL) NULL;
+  buf->self = type;
+  return_if (CObjCacheTypeInfo_get(buf)) buf;
+
+  CObjTypeInfo_resolve(buf);
+  CObjCacheTypeInfo_put(buf);
+  return buf;
+}
@@ -0,0 +1,498 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined __x86_64__ || defined __i386__
+#include <immintrin.h>
+#endif
+
+#include "utils/macro.h"
+#include "kernel.h"
+
+
+static inline uint64_t mix_hash (uint64_t h) {
+  h *= 0x9e3779b97f4a7c15;
+  return h ^ (h >> 29);
+}
+
+
+static inline uint64_t load64 (const unsigned char *p) {
+  uint64_t word;
+  memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+
+// widths a vector of 16 or 32 bytes holds a whole number of
+static inline bool width_isvector (unsigned width) {
+  return width <= 16 && (width & (width - 1)) == 0;
+}
+
+
+// repeat value to fill pattern, of a vector width
+static inline void broadcast (
+    unsigned char *pattern, size_t size, const void *value, unsigned width) {
+  // constant sizes let memcpy be inlined
+  switch (width) {
+#define BROADCAST_CASE(n) \
+    case n: \
+      for (size_t i = 0; i < size; i += n) { \
+        memcpy(pattern + i, value, n); \
+      } \
+      break;
+    BROADCAST_CASE(1)
+    BROADCAST_CASE(2)
+    BROADCAST_CASE(4)
+    BROADCAST_CASE(8)
+    BROADCAST_CASE(16)
+#undef BROADCAST_CASE
+    default:
+      // callers pass vector widths only; keep the pattern defined regardless
+      memset(pattern, 0, size);
+      break;
+  }
+}
+
+
+/******** scalar ********/
+
+static ptrdiff_t find_scalar (
+    const void *data, size_t n, const void *value, unsigned width) {
+  const unsigned char *p = data;
+  switch (width) {
+    case 1: {
+      const unsigned char *found =
+        memchr(p, *(const unsigned char *) value, n);
+      return found == NULL ? -1 : found - p;
+    }
+#define FIND_SCALAR_CASE(bits) \
+    case bits / 8: { \
+      uint ## bits ## _t v; \
+      memcpy(&v, value, sizeof(v)); \
+      for (size_t i = 0; i < n; i++) { \
+        uint ## bits ## _t x; \
+        memcpy(&x, p + sizeof(x) * i, sizeof(x)); \
+        return_if (x == v) i; \
+      } \
+      return -1; \
+    }
+    FIND_SCALAR_CASE(16)
+    FIND_SCALAR_CASE(32)
+    FIND_SCALAR_CASE(64)
+#undef FIND_SCALAR_CASE
+    default:
+      for (size_t i = 0; i < n; i++) {
+        return_if (memcmp(p + width * i, value, width) == 0) i;
+      }
+      return -1;
+  }
+}
+
+
+static void fill_scalar (
+    void *data, size_t n, const void *value, unsigned width) {
+  return_if (n == 0);
+  unsigned char *p = data;
+  size_t size = width * n;
+  memcpy(p, value, width);
+  // double the filled prefix
+  for (size_t filled = width; filled < size; ) {
+    size_t chunk = min(filled, size - filled);
+    memcpy(p + filled, p, chunk);
+    filled += chunk;
+  }
+}
+
+
+static bool equal_scalar (const void *a, const void *b, size_t size) {
+  return memcmp(a, b, size) == 0;
+}
+
+
+static const uint64_t hash_keys[4] = {
+  0xbe4ba423396cfeb8, 0x1cad21f72c81017c,
+  0xdb979083e96dd4de, 0x1f67b3b7a4a44072,
+};
+
+// mix the lanes and the bytes left after the last stripe
+static uint64_t hash_finish (
+    const uint64_t acc[4], const unsigned char *p, size_t rest, size_t size) {
+  uint64_t h = mix_hash(size);
+  for (int l = 0; l < 4; l++) {
+    h = mix_hash(h ^ acc[l]);
+  }
+  size_t i;
+  for (i = 0; i + 8 <= rest; i += 8) {
+    h = mix_hash(h ^ load64(p + i));
+  }
+  if (i < rest) {
+    uint64_t word = 0;
+    memcpy(&word, p + i, rest - i);
+    h = mix_hash(h ^ word);
+  }
+  return mix_hash(h);
+}
+
+// 4 lanes of 64 bits over 32-byte stripes; lane l also takes the data of
+// lane l ^ 1, as the vector versions swap adjacent lanes
+static uint64_t hash_scalar (const void *data, size_t size) {
+  const unsigned char *p = data;
+  uint64_t acc[4] = {hash_keys[0], hash_keys[1], hash_keys[2], hash_keys[3]};
+  size_t i;
+  for (i = 0; i + 32 <= size; i += 32) {
+    uint64_t d[4];
+    for (int l = 0; l < 4; l++) {
+      d[l] = load64(p + i + 8 * l);
+    }
+    for (int l = 0; l < 4; l++) {
+      uint64_t dk = d[l] ^ hash_keys[l];
+      acc[l] += d[l ^ 1] + (dk & 0xffffffff) * (dk >> 32);
+    }
+  }
+  return hash_finish(acc, p + i, size - i, size);
+}
+
+
+const struct CObjKernels CObjKernels_scalar = {
+  .name = "scalar",
+  .find = find_scalar,
+  .fill = fill_scalar,
+  .equal = equal_scalar,
+  .hash = hash_scalar,
+};
+
+
+#if defined __x86_64__ || defined __i386__
+
+/******** SSE2 ********/
+
+// lanes of elements equal to v become all ones
+__attribute__((target("sse2"), always_inline))
+static inline __m128i match_sse2 (__m128i x, __m128i v, unsigned width) {
+  switch (width) {
+    case 1:
+      return _mm_cmpeq_epi8(x, v);
+    case 2:
+      return _mm_cmpeq_epi16(x, v);
+    case 4:
+      return _mm_cmpeq_epi32(x, v);
+    default: {
+      __m128i c = _mm_cmpeq_epi32(x, v);
+      c = _mm_and_si128(c, _mm_shuffle_epi32(c, _MM_SHUFFLE(2, 3, 0, 1)));
+      if (width == 16) {
+        c = _mm_and_si128(c, _mm_shuffle_epi32(c, _MM_SHUFFLE(1, 0, 3, 2)));
+      }
+      return c;
+    }
+  }
+}
+
+
+// search whole vectors, 4 at a time; *done is set to the bytes searched
+__attribute__((target("sse2"), always_inline))
+static inline ptrdiff_t find_sse2_width (
+    const unsigned char *p, size_t size, __m128i v, unsigned width,
+    size_t *done) {
+  size_t i;
+  for (i = 0; i + 64 <= size; i += 64) {
+    const __m128i *x = (const __m128i *) (p + i);
+    __m128i m[4] = {
+      match_sse2(_mm_loadu_si128(x), v, width),
+      match_sse2(_mm_loadu_si128(x + 1), v, width),
+      match_sse2(_mm_loadu_si128(x + 2), v, width),
+      match_sse2(_mm_loadu_si128(x + 3), v, width),
+    };
+    __m128i any = _mm_or_si128(_mm_or_si128(m[0], m[1]),
+                               _mm_or_si128(m[2], m[3]));
+    continue_if (_mm_movemask_epi8(any) == 0);
+    for (int k = 0; k < 4; k++) {
+      unsigned mask = _mm_movemask_epi8(m[k]);
+      return_if (mask != 0) (i + 16 * k + __builtin_ctz(mask)) / width;
+    }
+  }
+  for (; i + 16 <= size; i += 16) {
+    unsigned mask = _mm_movemask_epi8(match_sse2(
+      _mm_loadu_si128((const __m128i *) (p + i)), v, width));
+    return_if (mask != 0) (i + __builtin_ctz(mask)) / width;
+  }
+  *done = i;
+  return -1;
+}
+
+
+__attribute__((target("sse2")))
+static ptrdiff_t find_sse2 (
+    const void *data, size_t n, const void *value, unsigned width) {
+  // bytes are best left to memchr
+  return_if_fail (width_isvector(width) && width > 1)
+    find_scalar(data, n, value, width);
+  unsigned char pattern[16];
+  broadcast(pattern, sizeof(pattern), value, width);
+  __m128i v = _mm_loadu_si128((const __m128i *) pattern);
+
+  const unsigned char *p = data;
+  size_t size = width * n;
+  size_t i = 0;
+  ptrdiff_t j;
+  switch (width) {
+    case 2:
+      j = find_sse2_width(p, size, v, 2, &i);
+      break;
+    case 4:
+      j = find_sse2_width(p, size, v, 4, &i);
+      break;
+    case 8:
+      j = find_sse2_width(p, size, v, 8, &i);
+      break;
+    default:
+      j = find_sse2_width(p, size, v, 16, &i);
+      break;
+  }
+  return_if (j >= 0) j;
+  j = find_scalar(p + i, (size - i) / width, value, width);
+  return j < 0 ? j : (ptrdiff_t) (i / width) + j;
+}
+
+
+__attribute__((target("sse2")))
+static void fill_sse2 (
+    void *data, size_t n, const void *value, unsigned width) {
+  should (width_isvector(width)) otherwise {
+    fill_scalar(data, n, value, width);
+    return;
+  }
+  unsigned char pattern[16];
+  broadcast(pattern, sizeof(pattern), value, width);
+  __m128i v = _mm_loadu_si128((const __m128i *) pattern);
+
+  unsigned char *p = data;
+  size_t size = width * n;
+  size_t i;
+  for (i = 0; i + 16 <= size; i += 16) {
+    _mm_storeu_si128((__m128i *) (p + i), v);
+  }
+  memcpy(p + i, pattern, size - i);
+}
+
+
+__attribute__((target("sse2")))
+static bool equal_sse2 (const void *a, const void *b, size_t size) {
+  const unsigned char *p = a;
+  const unsigned char *q = b;
+  size_t i;
+  for (i = 0; i + 16 <= size; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *) (p + i));
+    __m128i y = _mm_loadu_si128((const __m128i *) (q + i));
+    return_if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) != 0xffff) false;
+  }
+  return memcmp(p + i, q + i, size - i) == 0;
+}
+
+
+__attribute__((target("sse2")))
+static uint64_t hash_sse2 (const void *data, size_t size) {
+  const unsigned char *p = data;
+  __m128i keys[2] = {
+    _mm_loadu_si128((const __m128i *) hash_keys),
+    _mm_loadu_si128((const __m128i *) (hash_keys + 2)),
+  };
+  __m128i acc[2] = {keys[0], keys[1]};
+  size_t i;
+  for (i = 0; i + 32 <= size; i += 32) {
+    for (int h = 0; h < 2; h++) {
+      __m128i d = _mm_loadu_si128((const __m128i *) (p + i + 16 * h));
+      __m128i dk = _mm_xor_si128(d, keys[h]);
+      __m128i product = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+      __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+      acc[h] = _mm_add_epi64(acc[h], _mm_add_epi64(product, swapped));
+    }
+  }
+  uint64_t lanes[4];
+  _mm_storeu_si128((__m128i *) lanes, acc[0]);
+  _mm_storeu_si128((__m128i *) (lanes + 2), acc[1]);
+  return hash_finish(lanes, p + i, size - i, size);
+}
+
+
+const struct CObjKernels CObjKernels_sse2 = {
+  .name = "sse2",
+  .find = find_sse2,
+  .fill = fill_sse2,
+  .equal = equal_sse2,
+  .hash = hash_sse2,
+};
+
+
+/******** AVX2 ********/
+
+// lanes of elements equal to v become all ones
+__attribute__((target("avx2"), always_inline))
+static inline __m256i match_avx2 (__m256i x, __m256i v, unsigned width) {
+  switch (width) {
+    case 1:
+      return _mm256_cmpeq_epi8(x, v);
+    case 2:
+      return _mm256_cmpeq_epi16(x, v);
+    case 4:
+      return _mm256_cmpeq_epi32(x, v);
+    case 8:
+      return _mm256_cmpeq_epi64(x, v);
+    default: {
+      __m256i c = _mm256_cmpeq_epi64(x, v);
+      return _mm256_and_si256(
+        c, _mm256_shuffle_epi32(c, _MM_SHUFFLE(1, 0, 3, 2)));
+    }
+  }
+}
+
+
+// search whole vectors, 4 at a time; *done is set to the bytes searched
+__attribute__((target("avx2"), always_inline))
+static inline ptrdiff_t find_avx2_width (
+    const unsigned char *p, size_t size, __m256i v, unsigned width,
+    size_t *done) {
+  size_t i;
+  for (i = 0; i + 128 <= size; i += 128) {
+    const __m256i *x = (const __m256i *) (p + i);
+    __m256i m[4] = {
+      match_avx2(_mm256_loadu_si256(x), v, width),
+      match_avx2(_mm256_loadu_si256(x + 1), v, width),
+      match_avx2(_mm256_loadu_si256(x + 2), v, width),
+      match_avx2(_mm256_loadu_si256(x + 3), v, width),
+    };
+    __m256i any = _mm256_or_si256(_mm256_or_si256(m[0], m[1]),
+                                  _mm256_or_si256(m[2], m[3]));
+    continue_if (_mm256_testz_si256(any, any));
+    for (int k = 0; k < 4; k++) {
+      unsigned mask = _mm256_movemask_epi8(m[k]);
+      return_if (mask != 0) (i + 32 * k + __builtin_ctz(mask)) / width;
+    }
+  }
+  for (; i + 32 <= size; i += 32) {
+    unsigned mask = _mm256_movemask_epi8(match_avx2(
+      _mm256_loadu_si256((const __m256i *) (p + i)), v, width));
+    return_if (mask != 0) (i + __builtin_ctz(mask)) / width;
+  }
+  *done = i;
+  return -1;
+}
+
+
+__attribute__((target("avx2")))
+static ptrdiff_t find_avx2 (
+    const void *data, size_t n, const void *value, unsigned width) {
+  // bytes are best left to memchr
+  return_if_fail (width_isvector(width) && width > 1)
+    find_scalar(data, n, value, width);
+  unsigned char pattern[32];
+  broadcast(pattern, sizeof(pattern), value, width);
+  __m256i v = _mm256_loadu_si256((const __m256i *) pattern);
+
+  const unsigned char *p = data;
+  size_t size = width * n;
+  size_t i = 0;
+  ptrdiff_t j;
+  switch (width) {
+    case 2:
+      j = find_avx2_width(p, size, v, 2, &i);
+      break;
+    case 4:
+      j = find_avx2_width(p, size, v, 4, &i);
+      break;
+    case 8:
+      j = find_avx2_width(p, size, v, 8, &i);
+      break;
+    default:
+      j = find_avx2_width(p, size, v, 16, &i);
+      break;
+  }
+  return_if (j >= 0) j;
+  j = find_sse2(p + i, (size - i) / width, value, width);
+  return j < 0 ? j : (ptrdiff_t) (i / width) + j;
+}
+
+
+__attribute__((target("avx2")))
+static void fill_avx2 (
+    void *data, size_t n, const void *value, unsigned width) {
+  should (width_isvector(width)) otherwise {
+    fill_scalar(data, n, value, width);
+    return;
+  }
+  unsigned char pattern[32];
+  broadcast(pattern, sizeof(pattern), value, width);
+  __m256i v = _mm256_loadu_si256((const __m256i *) pattern);
+
+  unsigned char *p = data;
+  size_t size = width * n;
+  size_t i;
+  for (i = 0; i + 32 <= size; i += 32) {
+    _mm256_storeu_si256((__m256i *) (p + i), v);
+  }
+  memcpy(p + i, pattern, size - i);
+}
+
+
+__attribute__((target("avx2")))
+static bool equal_avx2 (const void *a, const void *b, size_t size) {
+  const unsigned char *p = a;
+  const unsigned char *q = b;
+  size_t i;
+  for (i = 0; i + 32 <= size; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *) (p + i));
+    __m256i y = _mm256_loadu_si256((const __m256i *) (q + i));
+    return_if ((uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)) !=
+               0xffffffff) false;
+  }
+  return equal_sse2(p + i, q + i, size - i);
+}
+
+
+__attribute__((target("avx2")))
+static uint64_t hash_avx2 (const void *data, size_t size) {
+  const unsigned char *p = data;
+  __m256i keys = _mm256_loadu_si256((const __m256i *) hash_keys);
+  __m256i acc = keys;
+  size_t i;
+  for (i = 0; i + 32 <= size; i += 32) {
+    __m256i d = _mm256_loadu_si256((const __m256i *) (p + i));
+    __m256i dk = _mm256_xor_si256(d, keys);
+    __m256i product = _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32));
+    __m256i swapped = _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+    acc = _mm256_add_epi64(acc, _mm256_add_epi64(product, swapped));
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i *) lanes, acc);
+  return hash_finish(lanes, p + i, size - i, size);
+}
+
+
+const struct CObjKernels CObjKernels_avx2 = {
+  .name = "avx2",
+  .find = find_avx2,
+  .fill = fill_avx2,
+  .equal = equal_avx2,
+  .hash = hash_avx2,
+};
+
+#endif
+
+
+const struct CObjKernels *CObjKernels_get (void) {
+  static const struct CObjKernels *selected;
+  const struct CObjKernels *ret = __atomic_load_n(&selected, __ATOMIC_RELAXED);
+  if unlikely (ret == NULL) {
+    ret = &CObjKernels_scalar;
+#if defined __x86_64__ || defined __i386__
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      ret = &CObjKernels_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+      ret = &CObjKernels_sse2;
+    }
+#endif
+    __atomic_store_n(&selected, ret, __ATOMIC_RELAXED);
+  }
+  return ret;
+}
@@ -0,0 +1,43 @@
+#ifndef COBJ_TYPES_KERNEL_H
+#define COBJ_TYPES_KERNEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/// Bulk kernels on arrays of fixed-width elements.
+struct CObjKernels {
+  /// name of the instruction set
+  const char *name;
+  /// index of the first element of @p width bytes equal to @p value, or -1
+  ptrdiff_t (*find) (
+    const void *data, size_t n, const void *value, unsigned width);
+  /// set @p n elements of @p width bytes to @p value
+  void (*fill) (void *data, size_t n, const void *value, unsigned width);
+  /// test if @p size bytes are equal
+  bool (*equal) (const void *a, const void *b, size_t size);
+  /// hash @p size bytes; all implementations give the same result
+  uint64_t (*hash) (const void *data, size_t size);
+};
+
+__attribute__((returns_nonnull, warn_unused_result))
+/**
+ * @memberof CObjKernels
+ * @brief Get the kernels for the running CPU, chosen on first use.
+ *
+ * @return Kernels.
+ */
+const struct CObjKernels *CObjKernels_get (void);
+
+/// portable kernels
+extern const struct CObjKernels CObjKernels_scalar;
+#if defined __x86_64__ || defined __i386__
+/// SSE2 kernels
+extern const struct CObjKernels CObjKernels_sse2;
+/// AVX2 kernels
+extern const struct CObjKernels CObjKernels_avx2;
+#endif
+
+
+#endif /* COBJ_TYPES_KERNEL_H */
@@ -0,0 +1,539 @@
+#include <errno.h>
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "include/cmap.h"
+#include "utils/macro.h"
+#include "allocator.h"
+#include "stats.h"
+#include "type.h"
+
+
+static const struct CObjSlot slot_key = {.name = "key"};
+static const struct CObjSlot slot_value = {.name = "value"};
+static const struct CObjSlot slot_hash = {.name = "hash"};
+static const struct CObjSlot slot_equal = {.name = "equal"};
+
+
+/// control byte of an empty entry
+#define CTRL_EMPTY ((unsigned char) 0x80)
+/// control byte of a removed entry
+#define CTRL_DELETED ((unsigned char) 0xfe)
+/// smallest capacity, at least the group width
+#define COBJ_HASH_MAP_MIN_CAP 16
+
+
+#ifdef __SSE2__
+
+#define GROUP_WIDTH 16
+// one bit per control byte
+#define GROUP_SHIFT 0
+typedef unsigned GroupMask;
+
+struct Group {
+  __m128i ctrl;
+};
+
+static inline struct Group Group_load (const unsigned char *ctrl) {
+  return (struct Group) {_mm_loadu_si128((const __m128i *) ctrl)};
+}
+
+static inline GroupMask Group_match (struct Group self, unsigned char h2) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), self.ctrl));
+}
+
+static inline GroupMask Group_match_empty (struct Group self) {
+  return _mm_movemask_epi8(
+    _mm_cmpeq_epi8(_mm_set1_epi8((char) CTRL_EMPTY), self.ctrl));
+}
+
+static inline GroupMask Group_match_free (struct Group self) {
+  // empty and deleted have the sign bit set
+  return _mm_movemask_epi8(self.ctrl);
+}
+
+#else
+
+#define GROUP_WIDTH 8
+// the high bit of each control byte
+#define GROUP_SHIFT 3
+typedef uint64_t GroupMask;
+
+#define GROUP_LSBS 0x0101010101010101
+#define GROUP_MSBS 0x8080808080808080
+
+struct Group {
+  uint64_t ctrl;
+};
+
+static inline struct Group Group_load (const unsigned char *ctrl) {
+  uint64_t word;
+  memcpy(&word, ctrl, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  word = __builtin_bswap64(word);
+#endif
+  return (struct Group) {word};
+}
+
+static inline GroupMask Group_match (struct Group self, unsigned char h2) {
+  // may report false positives next to a true match; keys are compared anyway
+  uint64_t x = self.ctrl ^ (GROUP_LSBS * h2);
+  return (x - GROUP_LSBS) & ~x & GROUP_MSBS;
+}
+
+static inline GroupMask Group_match_empty (struct Group self) {
+  // high bit set and bit 1 clear
+  return self.ctrl & (~self.ctrl << 6) & GROUP_MSBS;
+}
+
+static inline GroupMask Group_match_free (struct Group self) {
+  return self.ctrl & GROUP_MSBS;
+}
+
+#endif
+
+// number of control bytes before the first match
+static inline unsigned GroupMask_first (GroupMask mask) {
+  return __builtin_ctzll(mask) >> GROUP_SHIFT;
+}
+
+// number of control bytes after the last match
+static inline unsigned GroupMask_leading (GroupMask mask) {
+  return (__builtin_clzll(mask) - (64 - (GROUP_WIDTH << GROUP_SHIFT))) >>
+    GROUP_SHIFT;
+}
+
+
+struct CObjHashMap {
+  /// map type
+  const struct CObjTag *type;
+  /// memory allocator
+  const struct CObjAllocator *allocator;
+
+  /// argument types of key methods
+  const struct CObjTag *key_types[2];
+  /// argument types of value methods
+  const struct CObjTag *value_types[2];
+  /// size of key
+  size_t key_size;
+  /// size of value, 0 if the map is a set
+  size_t value_size;
+  /// offset of value in an entry
+  size_t value_offset;
+  /// size of an entry
+  size_t entry_size;
+
+  /// resolved methods, with CMethodContext::func set to @c NULL if not found
+  struct CMethodContext hash;
+  struct CMethodContext equal;
+  struct CMethodContext key_init;
+  struct CMethodContext key_destroy;
+  struct CMethodContext value_init;
+  struct CMethodContext value_destroy;
+
+  /// control bytes, followed by a copy of the first group; owns the storage
+  unsigned char *ctrl;
+  /// entries
+  char *entries;
+  /// number of entries, 0 or power of 2
+  size_t cap;
+  /// number of used entries
+  size_t len;
+  /// number of entries that can be filled before rehashing
+  size_t growth_left;
+};
+
+
+static void CObjHashMap_resolve (
+    struct CMethodContext *context, const struct CObjTag **types, int len,
+    const struct CObjSlot *slot, struct CObjMsg *msg) {
+  context->types = types;
+  context->len = len;
+  context->msg = msg;
+  if (CMethodContext_init(context, slot) != 0) {
+    context->func = NULL;
+  }
+}
+
+
+static size_t size_align (size_t size) {
+  // the largest power of 2 dividing size, up to max_align_t
+  size_t align = size & -size;
+  return min(align, alignof(max_align_t));
+}
+
+
+struct CObjHashMap *CObjHashMap_new (
+    const struct CObjTag *type, struct CObjMsg *msg) {
+  const struct CObjVariant *key_v = CObjTagArray_find(type, &slot_key);
+  const struct CObjVariant *value_v = CObjTagArray_find(type, &slot_value);
+  should (key_v != NULL && key_v->type == COBJ_TYPE_TAGS && (
+      value_v == NULL || value_v->type == COBJ_TYPE_TAGS)) otherwise {
+    errno = EINVAL;
+    return NULL;
+  }
+  const struct CObjTag *key = key_v->tags;
+  const struct CObjTag *value = value_v != NULL ? value_v->tags : NULL;
+
+  long key_size = CObjTagArray_get0(key, &slot_size, type);
+  long value_size =
+    value == NULL ? 0 : CObjTagArray_get0(value, &slot_size, type);
+  should (key_size > 0 && value_size >= 0) otherwise {
+    errno = EINVAL;
+    return NULL;
+  }
+
+  const struct CObjAllocator *allocator =
+    (void *) CObjTagArray_get0(type, &slot_allocator, type);
+  struct CObjHashMap *self = CObjAllocator_malloc(allocator, sizeof(*self));
+  return_if_fail (self != NULL) NULL;
+  *self = (struct CObjHashMap) {
+    .type = type,
+    .allocator = allocator,
+    .key_types = {key, key},
+    .value_types = {value, value},
+    .key_size = key_size,
+    .value_size = value_size,
+  };
+
+  size_t align = size_align(key_size);
+  size_t end = key_size;
+  if (value_size > 0) {
+    size_t value_align = size_align(value_size);
+    self->value_offset = (key_size + value_align - 1) & -value_align;
+    end = self->value_offset + value_size;
+    align = max(align, value_align);
+  }
+  self->entry_size = (end + align - 1) & -align;
+
+  CObjHashMap_resolve(&self->hash, self->key_types, 1, &slot_hash, msg);
+  CObjHashMap_resolve(&self->equal, self->key_types, 2, &slot_equal, msg);
+  CObjHashMap_resolve(&self->key_init, self->key_types, 2, &slot_init, msg);
+  CObjHashMap_resolve(
+    &self->key_destroy, self->key_types, 1, &slot_destroy, msg);
+  if (value_size > 0) {
+    CObjHashMap_resolve(
+      &self->value_init, self->value_types, 2, &slot_init, msg);
+    CObjHashMap_resolve(
+      &self->value_destroy, self->value_types, 1, &slot_destroy, msg);
+  }
+  return self;
+}
+
+
+static inline char *CObjHashMap_entry (
+    const struct CObjHashMap *self, size_t i) {
+  return self->entries + self->entry_size * i;
+}
+
+
+static inline uint64_t mix_hash (uint64_t h) {
+  h *= 0x9e3779b97f4a7c15;
+  return h ^ (h >> 29);
+}
+
+
+static uint64_t memhash (const void *key, size_t size) {
+  const unsigned char *p = key;
+  uint64_t h = size;
+  size_t i;
+  for (i = 0; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, p + i, sizeof(word));
+    h = mix_hash(h ^ word);
+  }
+  if (i < size) {
+    uint64_t word = 0;
+    memcpy(&word, p + i, size - i);
+    h = mix_hash(h ^ word);
+  }
+  return mix_hash(h);
+}
+
+
+static inline uint64_t CObjHashMap_hash (
+    const struct CObjHashMap *self, const void *key) {
+  return self->hash.func == NULL ? memhash(key, self->key_size) :
+    mix_hash(((CObjHashFunc) self->hash.func)(key, &self->hash));
+}
+
+
+static inline bool CObjHashMap_equal (
+    const struct CObjHashMap *self, const void *a, const void *b) {
+  return self->equal.func == NULL ? memcmp(a, b, self->key_size) == 0 :
+    ((CObjEqualFunc) self->equal.func)(a, b, &self->equal);
+}
+
+
+// the high 7 bits go to control bytes, the rest selects the first group
+static inline unsigned char H2 (uint64_t hash) {
+  return hash >> 57;
+}
+
+
+static inline void CObjHashMap_set_ctrl (
+    struct CObjHashMap *self, size_t i, unsigned char ctrl) {
+  self->ctrl[i] = ctrl;
+  if (i < GROUP_WIDTH) {
+    self->ctrl[self->cap + i] = ctrl;
+  }
+}
+
+
+// index of the entry holding key, or -1
+static ptrdiff_t CObjHashMap_find (
+    const struct CObjHashMap *self, const void *key, uint64_t hash) {
+  return_if (self->cap == 0) -1;
+  size_t mask = self->cap - 1;
+  size_t pos = hash & mask;
+  unsigned char h2 = H2(hash);
+  for (size_t stride = GROUP_WIDTH; ; stride += GROUP_WIDTH) {
+    struct Group group = Group_load(self->ctrl + pos);
+    for (GroupMask match = Group_match(group, h2); match != 0;
+         match &= match - 1) {
+      size_t i = (pos + GroupMask_first(match)) & mask;
+      return_if (CObjHashMap_equal(
+        self, key, CObjHashMap_entry(self, i))) i;
+    }
+    return_if (Group_match_empty(group) != 0) -1;
+    pos = (pos + stride) & mask;
+  }
+}
+
+
+// index of the first empty or deleted entry on the probe sequence
+static size_t CObjHashMap_find_free (
+    const struct CObjHashMap *self, uint64_t hash) {
+  size_t mask = self->cap - 1;
+  size_t pos = hash & mask;
+  for (size_t stride = GROUP_WIDTH; ; stride += GROUP_WIDTH) {
+    GroupMask match = Group_match_free(Group_load(self->ctrl + pos));
+    return_if (match != 0) (pos + GroupMask_first(match)) & mask;
+    pos = (pos + stride) & mask;
+  }
+}
+
+
+static inline size_t cap_to_growth (size_t cap) {
+  return cap - cap / 8;
+}
+
+
+// move all entries into a table of cap entries; entries are relocated bitwise
+static int CObjHashMap_rehash (struct CObjHashMap *self, size_t cap) {
+  size_t ctrl_size =
+    (cap + GROUP_WIDTH + alignof(max_align_t) - 1) & -alignof(max_align_t);
+  return_if_fail (cap <= (PTRDIFF_MAX - ctrl_size) / self->entry_size) -1;
+  unsigned char *ctrl = CObjAllocator_malloc(
+    self->allocator, ctrl_size + self->entry_size * cap);
+  return_if_fail (ctrl != NULL) -1;
+  memset(ctrl, CTRL_EMPTY, cap + GROUP_WIDTH);
+
+  struct CObjHashMap old = *self;
+  self->ctrl = ctrl;
+  self->entries = (char *) ctrl + ctrl_size;
+  self->cap = cap;
+  self->growth_left = cap_to_growth(cap) - self->len;
+
+  if (old.len > 0) {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_MEMCPY, old.entry_size * old.len);
+  }
+  for (size_t i = 0; i < old.cap; i++) {
+    continue_if (old.ctrl[i] & CTRL_EMPTY);
+    const char *entry = CObjHashMap_entry(&old, i);
+    uint64_t hash = CObjHashMap_hash(self, entry);
+    size_t j = CObjHashMap_find_free(self, hash);
+    CObjHashMap_set_ctrl(self, j, H2(hash));
+    memcpy(CObjHashMap_entry(self, j), entry, self->entry_size);
+  }
+  CObjAllocator_free(self->allocator, old.ctrl);
+  return 0;
+}
+
+
+int CObjHashMap_reserve (struct CObjHashMap *self, size_t n) {
+  return_if (n <= self->len + self->growth_left) 0;
+  size_t cap = COBJ_HASH_MAP_MIN_CAP;
+  while (cap_to_growth(cap) < n) {
+    return_if_fail (cap <= SIZE_MAX / 4) -1;
+    cap *= 2;
+  }
+  return CObjHashMap_rehash(self, cap);
+}
+
+
+size_t CObjHashMap_len (const struct CObjHashMap *self) {
+  return self->len;
+}
+
+
+static void CObjHashMap_destroy_entry (
+    const struct CObjHashMap *self, char *entry) {
+  if (self->key_destroy.func != NULL) {
+    self->key_destroy.func(entry, &self->key_destroy);
+  }
+  if (self->value_destroy.func != NULL) {
+    self->value_destroy.func(entry + self->value_offset, &self->value_destroy);
+  }
+}
+
+
+void CObjHashMap_free (struct CObjHashMap *self) {
+  return_if (self == NULL);
+  if (self->key_destroy.func != NULL || self->value_destroy.func != NULL) {
+    for (size_t i = 0; i < self->cap; i++) {
+      continue_if (self->ctrl[i] & CTRL_EMPTY);
+      CObjHashMap_destroy_entry(self, CObjHashMap_entry(self, i));
+    }
+  }
+  CObjAllocator_free(self->allocator, self->ctrl);
+  CObjAllocator_free(self->allocator, self);
+}
+
+
+void *CObjHashMap_get (const struct CObjHashMap *self, const void *key) {
+  ptrdiff_t i = CObjHashMap_find(self, key, CObjHashMap_hash(self, key));
+  return_if_fail (i >= 0) NULL;
+  return CObjHashMap_entry(self, i) + self->value_offset;
+}
+
+
+static int CObjHashMap_copy (
+    const struct CMethodContext *context, size_t size, void *dst,
+    const void *src) {
+  if (context->func == NULL) {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_MEMCPY, size);
+    memcpy(dst, src, size);
+    return 0;
+  }
+  COBJ_STATS_RECORD(COBJ_STAT_COPY_METHOD, 1);
+  return ((int (*) ()) context->func)(dst, src, context);
+}
+
+
+// replace the value of an entry with a copy of value, keeping the old value if
+// copying fails
+static int CObjHashMap_replace (
+    struct CObjHashMap *self, char *entry, const void *value) {
+  char *dst = entry + self->value_offset;
+  if (self->value_init.func == NULL) {
+    if (self->value_destroy.func != NULL) {
+      self->value_destroy.func(dst, &self->value_destroy);
+    }
+    return CObjHashMap_copy(&self->value_init, self->value_size, dst, value);
+  }
+
+  // copy aside first; values are relocated bit by bit, as on rehashing
+  alignas(max_align_t) char buf[64];
+  char *tmp = buf;
+  if (self->value_size > sizeof(buf)) {
+    tmp = CObjAllocator_malloc(self->allocator, self->value_size);
+    return_if_fail (tmp != NULL) -1;
+  }
+  int res = CObjHashMap_copy(&self->value_init, self->value_size, tmp, value);
+  if (res == 0) {
+    if (self->value_destroy.func != NULL) {
+      self->value_destroy.func(dst, &self->value_destroy);
+    }
+    memcpy(dst, tmp, self->value_size);
+  }
+  if (tmp != buf) {
+    CObjAllocator_free(self->allocator, tmp);
+  }
+  return res;
+}
+
+
+static void CObjHashMap_erase (struct CObjHashMap *self, size_t i) {
+  // if no group containing the entry was ever full, no probe sequence went
+  // past it, and it can be emptied instead of leaving a tombstone
+  GroupMask empty_after = Group_match_empty(Group_load(self->ctrl + i));
+  GroupMask empty_before = Group_match_empty(
+    Group_load(self->ctrl + ((i - GROUP_WIDTH) & (self->cap - 1))));
+  bool was_never_full = empty_before != 0 && empty_after != 0 &&
+    GroupMask_first(empty_after) + GroupMask_leading(empty_before) <
+    GROUP_WIDTH;
+  CObjHashMap_set_ctrl(self, i, was_never_full ? CTRL_EMPTY : CTRL_DELETED);
+  self->growth_left += was_never_full;
+  self->len--;
+}
+
+
+int CObjHashMap_put (
+    struct CObjHashMap *self, const void *key, const void *value) {
+  uint64_t hash = CObjHashMap_hash(self, key);
+  ptrdiff_t found = CObjHashMap_find(self, key, hash);
+  if (found >= 0) {
+    return_if (self->value_size == 0) 0;
+    return CObjHashMap_replace(self, CObjHashMap_entry(self, found), value);
+  }
+
+  size_t i = self->cap == 0 ? 0 : CObjHashMap_find_free(self, hash);
+  // tombstones can be reused without growing
+  if (self->cap == 0 ||
+      (self->growth_left == 0 && self->ctrl[i] == CTRL_EMPTY)) {
+    // purge tombstones if the table is at most half full
+    size_t cap = self->cap == 0 ? COBJ_HASH_MAP_MIN_CAP :
+      self->len * 2 <= cap_to_growth(self->cap) ? self->cap :
+      self->cap * 2;
+    int res = CObjHashMap_rehash(self, cap);
+    return_if_fail (res == 0) res;
+    i = CObjHashMap_find_free(self, hash);
+  }
+  self->growth_left -= self->ctrl[i] == CTRL_EMPTY;
+  CObjHashMap_set_ctrl(self, i, H2(hash));
+  self->len++;
+  char *entry = CObjHashMap_entry(self, i);
+  int res = CObjHashMap_copy(&self->key_init, self->key_size, entry, key);
+  should (res == 0) otherwise {
+    CObjHashMap_erase(self, i);
+    return res;
+  }
+  return_if (self->value_size == 0) 0;
+
+  res = CObjHashMap_copy(
+    &self->value_init, self->value_size, entry + self->value_offset, value);
+  should (res == 0) otherwise {
+    if (self->key_destroy.func != NULL) {
+      self->key_destroy.func(entry, &self->key_destroy);
+    }
+    CObjHashMap_erase(self, i);
+    return res;
+  }
+  return 0;
+}
+
+
+bool CObjHashMap_remove (struct CObjHashMap *self, const void *key) {
+  ptrdiff_t i = CObjHashMap_find(self, key, CObjHashMap_hash(self, key));
+  return_if_fail (i >= 0) false;
+  CObjHashMap_destroy_entry(self, CObjHashMap_entry(self, i));
+  CObjHashMap_erase(self, i);
+  return true;
+}
+
+
+bool CObjHashMap_next (
+    const struct CObjHashMap *self, size_t *iter, const void **key,
+    void **value) {
+  for (; *iter < self->cap; (*iter)++) {
+    continue_if (self->ctrl[*iter] & CTRL_EMPTY);
+    char *entry = CObjHashMap_entry(self, *iter);
+    if (key != NULL) {
+      *key = entry;
+    }
+    if (value != NULL) {
+      *value = entry + self->value_offset;
+    }
+    (*iter)++;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,151 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "include/cmethod.h"
+#include "utils/macro.h"
+#include "allocator.h"
+#include "stats.h"
+#include "type.h"
+
+
+// whether the pointee is stored in the pointer object itself; size of the
+// pointee is resolved without an object, and is -1 if it has a getter
+static bool SBOPointer_isinline (
+    const void *self, const struct CObjTag *type, const struct CObjTag *super,
+    int *size) {
+  long capacity = CObjTagArray_get(type, &slot_size, self, sizeof(void *));
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info = CObjTypeInfo_get(&buf, super);
+  *size = info != NULL && !info->size_getter ? info->size : -1;
+  return *size <= capacity;
+}
+
+
+static const struct CObjTag *SBOPointer_super (const struct CObjTag *type) {
+  const struct CObjVariant *v = CObjTagArray_find(type, &slot_super);
+  return_if_fail (v != NULL && v->type == COBJ_TYPE_TAGS) NULL;
+  return v->tags;
+}
+
+
+void *SBOPointer_deref (void *self, const struct CObjTag *type) {
+  const struct CObjTag *super = SBOPointer_super(type);
+  return_if_fail (super != NULL) NULL;
+  int size;
+  bool isinline = SBOPointer_isinline(self, type, super, &size);
+  return_if_fail (size >= 0) NULL;
+  return isinline ? self : *(void **) self;
+}
+
+
+int SBOPointer_init_copy (
+    void *self, const void *other, const struct CMethodContext *ctx) {
+  const struct CObjTag *super = CMethodContext_super(ctx);
+  return_if_fail (super != NULL) 255;
+
+  int size;
+  return_if_fail (SBOPointer_isinline(self, ctx->types[0], super, &size))
+    Pointer_init_copy(self, (const void **) other, ctx);
+  return_if_fail (size >= 0) 255;
+
+  struct CMethodContext context;
+  const struct CObjTag *types[2];
+  if (CMethodContext_init_copyer(&context, types, super, ctx->msg) != 0) {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_MEMCPY, size);
+    memcpy(self, other, size);
+    return 0;
+  }
+  COBJ_STATS_RECORD(COBJ_STAT_COPY_METHOD, 1);
+  return ((int (*) ()) context.func)(self, other, &context);
+}
+const struct CMethod SBOPointerType_init[] = {
+  {.func = (CObjFunc) SBOPointer_init_copy,
+   .traits = trait_AsuperPeqBsuper_AsuperIsize},
+  {0}
+};
+
+
+void SBOPointer_destroy (void *self, const struct CMethodContext *ctx) {
+  const struct CObjTag *super = CMethodContext_super(ctx);
+  return_if_fail (super != NULL);
+
+  int size;
+  bool isinline = SBOPointer_isinline(self, ctx->types[0], super, &size);
+  return_if_fail (size >= 0);
+  void *pointee = isinline ? self : *(void **) self;
+  return_if (pointee == NULL);
+
+  struct CMethodContext context;
+  context.types = &super;
+  context.len = 1;
+  context.msg = ctx->msg;
+  if (CMethodContext_init(&context, &slot_destroy) == 0) {
+    context.func(pointee, &context);
+  }
+  if (!isinline) {
+    const struct CObjAllocator *allocator =
+      (void *) CObjTagArray_get0(super, &slot_allocator, self);
+    CObjAllocator_free(allocator, pointee);
+    *(void **) self = NULL;
+  }
+}
+const struct CMethod SBOPointerType_destroy[] = {
+  {.func = (CObjFunc) SBOPointer_destroy, .traits = trait_AsuperIsize},
+  {0}
+};
+
+
+long SBOPointer_deep_size (
+    const void *self, const struct CMethodContext *ctx) {
+  const struct CObjTag *super = CMethodContext_super(ctx);
+  return_if_fail (super != NULL) -1;
+
+  int size;
+  bool isinline = SBOPointer_isinline(self, ctx->types[0], super, &size);
+  return_if_fail (size >= 0) -1;
+  // an inline pointee is part of the pointer object itself, only what it owns
+  // is counted
+  return_if (isinline) CObjDeep_size(self, super, ctx->msg);
+  const void *pointee = *(void *const *) self;
+  return_if (pointee == NULL) 0;
+  long res = CObjDeep_size(pointee, super, ctx->msg);
+  return_if_fail (res >= 0) -1;
+  return size + res;
+}
+const struct CMethod SBOPointerType_deep_size[] = {
+  {.func = (CObjFunc) SBOPointer_deep_size, .traits = trait_AsuperIsize},
+  {0}
+};
+
+
+int SBOPointer_move (
+    void *self, void *other, const struct CMethodContext *ctx) {
+  const struct CObjTag *super = CMethodContext_super(ctx);
+  return_if_fail (super != NULL) 255;
+
+  int size;
+  return_if_fail (SBOPointer_isinline(self, ctx->types[0], super, &size))
+    Pointer_move(self, other, ctx);
+  return_if_fail (size >= 0) 255;
+
+  struct CMethodContext context;
+  const struct CObjTag *types[2];
+  if (CMethodContext_init_mover(&context, types, super, ctx->msg) == 0) {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_METHOD, 1);
+    return ((int (*) ()) context.func)(self, other, &context);
+  }
+  COBJ_STATS_RECORD(COBJ_STAT_COPY_MEMCPY, size);
+  memcpy(self, other, size);
+  // leave nothing for the destructor of the source to release
+  context.types = &super;
+  context.len = 1;
+  if (CMethodContext_init(&context, &slot_destroy) == 0) {
+    memset(other, 0, size);
+  }
+  return 0;
+}
+const struct CMethod SBOPointerType_move[] = {
+  {.func = (CObjFunc) SBOPointer_move,
+   .traits = trait_AsuperPeqBsuper_AsuperIsize},
+  {0}
+};
@@ -0,0 +1,146 @@
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "include/cmethod.h"
+#include "utils/macro.h"
+#include "allocator.h"
+#include "stats.h"
+#include "type.h"
+
+
+/// Control block preceding the pointee of a shared pointer.
+struct CObjSharedBlock {
+  /// reference count
+  long refcount;
+  /// allocator of the block
+  const struct CObjAllocator *allocator;
+  /// pointee
+  alignas(max_align_t) char data[];
+};
+
+
+static inline struct CObjSharedBlock *CObjSharedBlock_of (const void *ptr) {
+  return (struct CObjSharedBlock *) (
+    (char *) ptr - offsetof(struct CObjSharedBlock, data));
+}
+
+
+// the analyzer loses track of blocks only referred to by interior pointers
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wanalyzer-malloc-leak"
+
+
+static struct CObjSharedBlock *CObjSharedBlock_new (
+    const struct CObjAllocator *allocator, size_t size) {
+  struct CObjSharedBlock *block =
+    CObjAllocator_malloc(allocator, sizeof(*block) + size);
+  return_if_fail (block != NULL) NULL;
+  block->refcount = 1;
+  block->allocator = allocator;
+  return block;
+}
+
+
+void *CObjShared_alloc (const struct CObjAllocator *allocator, size_t size) {
+  struct CObjSharedBlock *block = CObjSharedBlock_new(allocator, size);
+  return likely (block != NULL) ? block->data : NULL;
+}
+
+
+bool CObjShared_isunique (const void *ptr) {
+  return __atomic_load_n(&CObjSharedBlock_of(ptr)->refcount,
+                         __ATOMIC_ACQUIRE) == 1;
+}
+
+
+// drop a reference, destroying the pointee of type if it was the last one
+static void CObjShared_release (
+    void *ptr, const struct CObjTag *type, struct CObjMsg *msg) {
+  struct CObjSharedBlock *block = CObjSharedBlock_of(ptr);
+  return_if (__atomic_sub_fetch(
+    &block->refcount, 1, __ATOMIC_ACQ_REL) != 0);
+
+  struct CMethodContext context;
+  context.types = &type;
+  context.len = 1;
+  context.msg = msg;
+  if (CMethodContext_init(&context, &slot_destroy) == 0) {
+    context.func(ptr, &context);
+  }
+  CObjAllocator_free(block->allocator, block);
+}
+
+
+int CObjShared_detach (
+    void **self, const struct CObjTag *type, struct CObjMsg *msg) {
+  return_if (*self == NULL || CObjShared_isunique(*self)) 0;
+
+  const struct CObjVariant *v = CObjTagArray_find(type, &slot_super);
+  return_if_fail (v != NULL && v->type == COBJ_TYPE_TAGS) 255;
+  const struct CObjTag *super = v->tags;
+  int size = CObjTagArray_get0(super, &slot_size, *self);
+  return_if_fail (size > 0) 255;
+
+  const struct CObjAllocator *allocator = CObjSharedBlock_of(*self)->allocator;
+  struct CObjSharedBlock *copy = CObjSharedBlock_new(allocator, size);
+  return_if_fail (copy != NULL) -1;
+  struct CMethodContext context;
+  const struct CObjTag *types[2];
+  if (CMethodContext_init_copyer(&context, types, super, msg) != 0) {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_MEMCPY, size);
+    memcpy(copy->data, *self, size);
+  } else {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_METHOD, 1);
+    int res = ((int (*) ()) context.func)(copy->data, *self, &context);
+    should (res == 0) otherwise {
+      CObjAllocator_free(allocator, copy);
+      return res;
+    }
+  }
+
+  CObjShared_release(*self, super, msg);
+  *self = copy->data;
+  return 0;
+}
+
+
+#pragma GCC diagnostic pop
+
+
+int SharedPointer_init_copy (
+    void **self, void * const *other, const struct CMethodContext *ctx) {
+  (void) ctx;
+  *self = *other;
+  if (*other != NULL) {
+    __atomic_add_fetch(&CObjSharedBlock_of(*other)->refcount, 1,
+                       __ATOMIC_RELAXED);
+  }
+  return 0;
+}
+const struct CMethod SharedPointerType_init[] = {
+  {.func = (CObjFunc) SharedPointer_init_copy,
+   .traits = trait_AsuperPeqBsuper_AsuperIsize},
+  {0}
+};
+
+
+void SharedPointer_destroy (void **self, const struct CMethodContext *ctx) {
+  return_if (*self == NULL);
+  const struct CObjTag *super = CMethodContext_super(ctx);
+  return_if_fail (super != NULL);
+  CObjShared_release(*self, super, ctx->msg);
+  *self = NULL;
+}
+const struct CMethod SharedPointerType_destroy[] = {
+  {.func = (CObjFunc) SharedPointer_destroy, .traits = trait_AsuperIsize},
+  {0}
+};
+
+
+const struct CMethod SharedPointerType_move[] = {
+  {.func = (CObjFunc) Pointer_move,
+   .traits = trait_AsuperPeqBsuper_AsuperIsize},
+  {0}
+};
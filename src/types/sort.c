@@ -0,0 +1,473 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "include/cmethod.h"
+#include "utils/macro.h"
+#include "type.h"
+
+
+static const struct CObjSlot slot_compare = {.name = "compare"};
+
+/// arrays up to this length are insertion sorted
+#define SORT_INSERTION_MAX 16
+/// arrays shorter than this are not radix sorted
+#define SORT_RADIX_MIN 256
+/// minimum number of elements sorted by each thread
+#define SORT_PARALLEL_MIN 16384
+/// maximum number of threads
+#define SORT_THREADS_MAX 64
+
+
+struct CObjSortContext {
+  /// element compare method
+  struct CMethodContext compare;
+  /// argument types of CObjSortContext::compare
+  const struct CObjTag *types[2];
+  /// element size
+  size_t size;
+  /// width of elements sorted as unsigned integers, or 0
+  unsigned radix;
+  /// keep equal elements in order
+  bool stable;
+};
+
+
+static inline int CObjSortContext_compare (
+    const struct CObjSortContext *self, const void *a, const void *b) {
+  return ((CObjCompareFunc) self->compare.func)(a, b, &self->compare);
+}
+
+
+static inline void swap (char *a, char *b, size_t size) {
+  char tmp[64];
+  while (size > 0) {
+    size_t chunk = min(size, sizeof(tmp));
+    memcpy(tmp, a, chunk);
+    memcpy(a, b, chunk);
+    memcpy(b, tmp, chunk);
+    a += chunk;
+    b += chunk;
+    size -= chunk;
+  }
+}
+
+
+/******** comparison sorts ********/
+
+// stable; tmp holds one element
+static void insertion_sort (
+    const struct CObjSortContext *self, char *data, size_t n, char *tmp) {
+  size_t size = self->size;
+  for (size_t i = 1; i < n; i++) {
+    char *e = data + size * i;
+    size_t j = i;
+    while (j > 0 &&
+           CObjSortContext_compare(self, data + size * (j - 1), e) > 0) {
+      j--;
+    }
+    continue_if (j == i);
+    memcpy(tmp, e, size);
+    memmove(data + size * (j + 1), data + size * j, size * (i - j));
+    memcpy(data + size * j, tmp, size);
+  }
+}
+
+
+static void sift_down (
+    const struct CObjSortContext *self, char *data, size_t root, size_t n) {
+  size_t size = self->size;
+  while (1) {
+    size_t child = 2 * root + 1;
+    break_if (child >= n);
+    if (child + 1 < n && CObjSortContext_compare(
+          self, data + size * child, data + size * (child + 1)) < 0) {
+      child++;
+    }
+    break_if (CObjSortContext_compare(
+      self, data + size * root, data + size * child) >= 0);
+    swap(data + size * root, data + size * child, size);
+    root = child;
+  }
+}
+
+
+static void heap_sort (
+    const struct CObjSortContext *self, char *data, size_t n) {
+  size_t size = self->size;
+  for (size_t i = n / 2; i > 0; i--) {
+    sift_down(self, data, i - 1, n);
+  }
+  for (size_t i = n - 1; i > 0; i--) {
+    swap(data, data + size * i, size);
+    sift_down(self, data, 0, i);
+  }
+}
+
+
+static void intro_sort (
+    const struct CObjSortContext *self, char *data, size_t n, int depth,
+    char *tmp) {
+  size_t size = self->size;
+  while (n > SORT_INSERTION_MAX) {
+    if (depth-- == 0) {
+      heap_sort(self, data, n);
+      return;
+    }
+
+    // median of three as pivot, moved to the front
+    char *a = data;
+    char *b = data + size * (n / 2);
+    char *c = data + size * (n - 1);
+    if (CObjSortContext_compare(self, b, a) < 0) {
+      swap(a, b, size);
+    }
+    if (CObjSortContext_compare(self, c, b) < 0) {
+      swap(b, c, size);
+      if (CObjSortContext_compare(self, b, a) < 0) {
+        swap(a, b, size);
+      }
+    }
+    swap(a, b, size);
+
+    // Hoare partition; elements equal to the pivot go to both sides
+    size_t i = 1;
+    size_t j = n - 1;
+    while (1) {
+      while (i <= j && CObjSortContext_compare(
+               self, data + size * i, data) < 0) {
+        i++;
+      }
+      while (j >= i && CObjSortContext_compare(
+               self, data + size * j, data) > 0) {
+        j--;
+      }
+      break_if (i >= j);
+      swap(data + size * i, data + size * j, size);
+      i++;
+      j--;
+    }
+    swap(data, data + size * j, size);
+
+    // recurse into the smaller side
+    size_t right = n - j - 1;
+    if (j < right) {
+      intro_sort(self, data, j, depth, tmp);
+      data += size * (j + 1);
+      n = right;
+    } else {
+      intro_sort(self, data + size * (j + 1), right, depth, tmp);
+      n = j;
+    }
+  }
+  insertion_sort(self, data, n, tmp);
+}
+
+
+// merge sorted a[0, n) and a[n, m) into dst
+static void merge (
+    const struct CObjSortContext *self, char *dst, const char *a, size_t n,
+    size_t m) {
+  size_t size = self->size;
+  const char *left = a;
+  const char *left_end = a + size * n;
+  const char *right = left_end;
+  const char *right_end = a + size * m;
+  while (left < left_end && right < right_end) {
+    if (CObjSortContext_compare(self, left, right) <= 0) {
+      memcpy(dst, left, size);
+      left += size;
+    } else {
+      memcpy(dst, right, size);
+      right += size;
+    }
+    dst += size;
+  }
+  memcpy(dst, left, left_end - left);
+  dst += left_end - left;
+  memcpy(dst, right, right_end - right);
+}
+
+
+// bottom-up merge sort, ping-ponging between data and buf
+static void merge_sort (
+    const struct CObjSortContext *self, char *data, size_t n, char *buf,
+    char *tmp) {
+  size_t size = self->size;
+  for (size_t i = 0; i < n; i += SORT_INSERTION_MAX) {
+    insertion_sort(
+      self, data + size * i, min(SORT_INSERTION_MAX, n - i), tmp);
+  }
+
+  char *src = data;
+  char *dst = buf;
+  for (size_t run = SORT_INSERTION_MAX; run < n; run *= 2) {
+    for (size_t i = 0; i < n; i += 2 * run) {
+      size_t m = min(2 * run, n - i);
+      if (m <= run || CObjSortContext_compare(
+            self, src + size * (i + run - 1), src + size * (i + run)) <= 0) {
+        // already in order
+        memcpy(dst + size * i, src + size * i, size * m);
+      } else {
+        merge(self, dst + size * i, src + size * i, run, m);
+      }
+    }
+    char *t = src;
+    src = dst;
+    dst = t;
+  }
+  if (src != data) {
+    memcpy(data, src, size * n);
+  }
+}
+
+
+/******** radix sort ********/
+
+// byte k of the value of an element, from the least significant
+static inline unsigned radix_digit (const unsigned char *e, unsigned width,
+                                    unsigned k) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  (void) width;
+  return e[k];
+#else
+  return e[width - 1 - k];
+#endif
+}
+
+
+// move elements to their buckets; inlined for each width so that copies are
+// not library calls
+__attribute__((always_inline))
+static inline void radix_scatter (
+    unsigned char *dst, const unsigned char *src, size_t n, unsigned width,
+    unsigned k, size_t offsets[256]) {
+  for (size_t i = 0; i < n; i++) {
+    const unsigned char *e = src + width * i;
+    memcpy(dst + width * offsets[radix_digit(e, width, k)]++, e, width);
+  }
+}
+
+
+// LSD radix sort of unsigned integers, stable
+static void radix_sort (
+    const struct CObjSortContext *self, unsigned char *data, size_t n,
+    unsigned char *buf) {
+  unsigned width = self->radix;
+  size_t counts[8][256] = {0};
+  for (size_t i = 0; i < n; i++) {
+    for (unsigned k = 0; k < width; k++) {
+      counts[k][radix_digit(data + width * i, width, k)]++;
+    }
+  }
+
+  unsigned char *src = data;
+  unsigned char *dst = buf;
+  for (unsigned k = 0; k < width; k++) {
+    // skip digits all elements share
+    continue_if (counts[k][radix_digit(src, width, k)] == n);
+    size_t offset = 0;
+    for (int d = 0; d < 256; d++) {
+      size_t c = counts[k][d];
+      counts[k][d] = offset;
+      offset += c;
+    }
+    switch (width) {
+      case 1:
+        radix_scatter(dst, src, n, 1, k, counts[k]);
+        break;
+      case 2:
+        radix_scatter(dst, src, n, 2, k, counts[k]);
+        break;
+      case 4:
+        radix_scatter(dst, src, n, 4, k, counts[k]);
+        break;
+      default:
+        radix_scatter(dst, src, n, 8, k, counts[k]);
+        break;
+    }
+    unsigned char *t = src;
+    src = dst;
+    dst = t;
+  }
+  if (src != data) {
+    memcpy(data, src, width * n);
+  }
+}
+
+
+/******** driver ********/
+
+static int floor_log2 (size_t n) {
+  return sizeof(long long) * 8 - 1 - __builtin_clzll(n);
+}
+
+
+// sort data[0, n); buf holds n elements if the sort is stable or radix
+static void CObjSortContext_sort (
+    const struct CObjSortContext *self, char *data, size_t n, char *buf,
+    char *tmp) {
+  return_if (n < 2);
+  if (self->radix != 0 && n >= SORT_RADIX_MIN) {
+    radix_sort(self, (unsigned char *) data, n, (unsigned char *) buf);
+  } else if (self->stable) {
+    merge_sort(self, data, n, buf, tmp);
+  } else {
+    intro_sort(self, data, n, 2 * floor_log2(n), tmp);
+  }
+}
+
+
+struct CObjSortTask {
+  const struct CObjSortContext *context;
+  char *data;
+  size_t n;
+  size_t m;
+  char *buf;
+  pthread_t thread;
+  int err;
+};
+
+
+static void *CObjSortTask_sort (void *arg) {
+  struct CObjSortTask *task = arg;
+  char *tmp = malloc(task->context->size);
+  should (tmp != NULL) otherwise {
+    task->err = -1;
+    return NULL;
+  }
+  CObjSortContext_sort(task->context, task->data, task->n, task->buf, tmp);
+  free(tmp);
+  return NULL;
+}
+
+
+static void *CObjSortTask_merge (void *arg) {
+  struct CObjSortTask *task = arg;
+  merge(task->context, task->buf, task->data, task->n, task->m);
+  return NULL;
+}
+
+
+// run tasks in threads, the first one in the calling thread
+static int CObjSortTask_run (
+    struct CObjSortTask *tasks, int len, void *(*func) (void *)) {
+  int started;
+  for (started = 1; started < len; started++) {
+    break_if (pthread_create(
+      &tasks[started].thread, NULL, func, tasks + started) != 0);
+  }
+  func(tasks);
+  // tasks that could not be started run here
+  for (int i = started; i < len; i++) {
+    func(tasks + i);
+  }
+  int err = tasks[0].err;
+  for (int i = 1; i < started; i++) {
+    pthread_join(tasks[i].thread, NULL);
+    if (tasks[i].err != 0) {
+      err = tasks[i].err;
+    }
+  }
+  return err;
+}
+
+
+// sort chunks in parallel, then merge pairs of chunks in parallel rounds
+static int CObjSortContext_sort_parallel (
+    const struct CObjSortContext *self, char *data, size_t n, char *buf,
+    int threads) {
+  size_t size = self->size;
+  struct CObjSortTask tasks[SORT_THREADS_MAX];
+  size_t bounds[SORT_THREADS_MAX + 1];
+  for (int i = 0; i <= threads; i++) {
+    bounds[i] = n * i / threads;
+  }
+
+  // radix and merge sorts need their own part of buf
+  for (int i = 0; i < threads; i++) {
+    tasks[i] = (struct CObjSortTask) {
+      .context = self, .data = data + size * bounds[i],
+      .n = bounds[i + 1] - bounds[i], .buf = buf + size * bounds[i],
+    };
+  }
+  int err = CObjSortTask_run(tasks, threads, CObjSortTask_sort);
+  return_if_fail (err == 0) err;
+
+  char *src = data;
+  char *dst = buf;
+  for (int step = 1; step < threads; step *= 2) {
+    int len = 0;
+    for (int i = 0; i < threads; i += 2 * step) {
+      size_t begin = bounds[i];
+      size_t mid = bounds[min(i + step, threads)];
+      size_t end = bounds[min(i + 2 * step, threads)];
+      tasks[len++] = (struct CObjSortTask) {
+        .context = self, .data = src + size * begin, .n = mid - begin,
+        .m = end - begin, .buf = dst + size * begin,
+      };
+    }
+    CObjSortTask_run(tasks, len, CObjSortTask_merge);
+    char *t = src;
+    src = dst;
+    dst = t;
+  }
+  if (src != data) {
+    memcpy(data, src, size * n);
+  }
+  return 0;
+}
+
+
+int CObjArray_sort (
+    void *data, size_t len, const struct CObjTag *type, int flags,
+    int threads, struct CObjMsg *msg) {
+  struct CObjSortContext self = {
+    .types = {type, type},
+    .stable = flags & COBJ_SORT_STABLE,
+  };
+  long size = CObjTagArray_get0(type, &slot_size, data);
+  return_if_fail (size > 0) 255;
+  self.size = size;
+  self.compare.types = self.types;
+  self.compare.len = 2;
+  self.compare.msg = msg;
+  int res = CMethodContext_init(&self.compare, &slot_compare);
+  return_if_fail (res == 0) res;
+  self.radix = Imm_radix_width(self.compare.func);
+  return_if (len < 2) 0;
+
+  if (threads <= 0) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? cpus : 1;
+  }
+  threads = min(threads, SORT_THREADS_MAX);
+  threads = min((size_t) threads, max(len / SORT_PARALLEL_MIN, 1));
+
+  bool need_buf = threads > 1 || self.stable ||
+    (self.radix != 0 && len >= SORT_RADIX_MIN);
+  char *buf = NULL;
+  if (need_buf) {
+    return_if_fail (len <= PTRDIFF_MAX / self.size) -1;
+    buf = malloc(self.size * len);
+    return_if_fail (buf != NULL) -1;
+  }
+  if (threads > 1) {
+    res = CObjSortContext_sort_parallel(&self, data, len, buf, threads);
+  } else {
+    char *tmp = malloc(self.size);
+    should (tmp != NULL) otherwise {
+      free(buf);
+      return -1;
+    }
+    CObjSortContext_sort(&self, data, len, buf, tmp);
+    free(tmp);
+  }
+  free(buf);
+  return res;
+}
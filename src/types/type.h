@@ -0,0 +1,167 @@
+#ifndef COBJ_TYPES_TYPE_H
+#define COBJ_TYPES_TYPE_H
+
+#include "include/cmethod.h"
+#include "utils/macro.h"
+#include "cache.h"
+
+
+static const struct CObjSlot slot_len = {.name = "len"};
+static const struct CObjSlot slot_size = {.name = "size"};
+static const struct CObjSlot slot_isnull = {.name = "isnull"};
+static const struct CObjSlot slot_allocator = {.name = "allocator"};
+static const struct CObjSlot slot_super = {.name = "super"};
+static const struct CObjSlot slot_init = {.name = "init"};
+static const struct CObjSlot slot_destroy = {.name = "destroy"};
+static const struct CObjSlot slot_move = {.name = "move"};
+
+static const struct CObjSlot path_1_super_size[] = {
+  {.name = {1}}, {.name = "super"}, {.name = "size"}, {{0}}};
+static const struct CObjSlot path_1_super[] = {
+  {.name = {1}}, {.name = "super"}, {{0}}};
+static const struct CObjSlot path_2_super[] = {
+  {.name = {2}}, {.name = "super"}, {{0}}};
+static const struct CObjSlot path_2_super_super[] = {
+  {.name = {2}}, {.name = "super"}, {.name = "super"}, {{0}}};
+
+static const struct CObjTrait trait_AsuperPeqBsuper_AsuperIsize[] = {
+  {.path = path_1_super,
+   .value = {.path = path_2_super, .type = COBJ_TYPE_PATH},
+   .cmp = COBJ_TRAIT_EQUAL},
+  {.path = path_1_super_size},
+  {0}
+};
+#define trait_AsuperIsize (trait_AsuperPeqBsuper_AsuperIsize + 1)
+static const struct CObjTrait trait_AsuperPeqBsuperIsuper_AsuperIsize[] = {
+  {.path = path_1_super,
+   .value = {.path = path_2_super_super, .type = COBJ_TYPE_PATH},
+   .cmp = COBJ_TRAIT_EQUAL},
+  {.path = path_1_super_size},
+  {0}
+};
+
+
+// types must outlive the context
+static inline int CMethodContext_init_copyer (
+    struct CMethodContext *self, const struct CObjTag *types[2],
+    const struct CObjTag *type, struct CObjMsg *msg) {
+  types[0] = type;
+  types[1] = type;
+  self->types = types;
+  self->len = 2;
+  self->msg = msg;
+  return CMethodContext_init(self, &slot_init);
+}
+
+
+// types must outlive the context
+static inline int CMethodContext_init_mover (
+    struct CMethodContext *self, const struct CObjTag *types[2],
+    const struct CObjTag *type, struct CObjMsg *msg) {
+  types[0] = type;
+  types[1] = type;
+  self->types = types;
+  self->len = 2;
+  self->msg = msg;
+  return CMethodContext_init(self, &slot_move);
+}
+
+
+__attribute__((warn_unused_result, nonnull(1), access(write_only, 1)))
+/**
+ * @memberof CObjTypeInfo
+ * @brief Get the core protocol slots of a type, resolving them on first use.
+ *
+ * @param[out] buf Storage for type info, copied out of the cache if cached.
+ * @param type Type.
+ * @return @p buf, or @c NULL if @p type is @c NULL.
+ */
+const struct CObjTypeInfo *CObjTypeInfo_get (
+  struct CObjTypeInfo *buf, const struct CObjTag *type);
+
+
+// size of obj
+static inline long CObjTypeInfo_size (
+    const struct CObjTypeInfo *self, const void *obj) {
+  return likely (!self->size_getter) ? self->size :
+    CObjTagArray_get0(self->self, &slot_size, obj);
+}
+
+
+// allocator of obj
+static inline const struct CObjAllocator *CObjTypeInfo_allocator (
+    const struct CObjTypeInfo *self, const void *obj) {
+  return likely (!self->allocator_getter) ? self->allocator :
+    (void *) CObjTagArray_get0(self->self, &slot_allocator, obj);
+}
+
+
+// types must outlive the context; returns as CMethodContext_init()
+static inline int CObjTypeInfo_context (
+    const struct CObjTypeInfo *self, enum CObjTypeMethod method,
+    struct CMethodContext *context, const struct CObjTag *types[2],
+    struct CObjMsg *msg) {
+  const struct CObjTypeInfoMethod *m = self->methods + method;
+  types[0] = self->self;
+  types[1] = self->self;
+  context->types = types;
+  context->len =
+    method == COBJ_TYPE_METHOD_INIT || method == COBJ_TYPE_METHOD_MOVE ? 2 : 1;
+  context->msg = msg;
+  context->func = m->func;
+  context->userdata = m->userdata;
+  context->traits = m->traits;
+  context->target = m->target;
+  context->offset = m->offset;
+  return m->res;
+}
+
+
+/// width of elements whose compare method is @p func, if it compares unsigned
+/// integers, or 0
+unsigned Imm_radix_width (CObjFunc func);
+/// copy the pointee of a pointer into a new allocation
+int Pointer_init_copy (
+  void **self, const void **other, const struct CMethodContext *ctx);
+/// destroy and free the pointee of a pointer
+void Pointer_destroy (void **self, const struct CMethodContext *ctx);
+/// move a pointer, leaving @c NULL in @p other
+int Pointer_move (void **self, void **other, const struct CMethodContext *ctx);
+/// number of elements of an array, whose elements have type info @p info
+int Array_len_ (
+  const void *self, int size, const struct CObjTypeInfo *info,
+  struct CObjMsg *msg);
+/// destroy the first @p n elements of an array
+void Array_destroy_ (
+  void *self, int size, int n, const struct CObjTypeInfo *info,
+  struct CObjMsg *msg);
+int Array_init_copy (
+  void *self, const void *other, const struct CMethodContext *ctx);
+void Array_destroy (void *self, struct CMethodContext *ctx);
+
+/// Shape of an object, as seen by the deep traversal.
+enum CObjDeepKind {
+  /// opaque, handled by its own methods
+  COBJ_DEEP_LEAF = 0,
+  /// pointer to its `super`, see #COBJ_TAG_POINTER_INIT
+  COBJ_DEEP_POINTER,
+  /// terminated array of its `super`, see #COBJ_TAG_ARRAY_INIT
+  COBJ_DEEP_ARRAY,
+};
+
+/// shape of objects of a type, told by their copyer or destructor
+int CObjDeep_kind (const struct CObjTypeInfo *info);
+/// deep copy an object of the given shape
+int CObjDeep_copy_ (
+  void *self, const void *other, const struct CObjTag *type, int kind,
+  struct CObjMsg *msg);
+/// deep destroy an object of the given shape
+void CObjDeep_destroy_ (
+  void *self, const struct CObjTag *type, int kind, struct CObjMsg *msg);
+/// memory owned by an object of the given shape, or -1 if out of memory
+long CObjDeep_size_ (
+  const void *self, const struct CObjTag *type, int kind,
+  struct CObjMsg *msg);
+
+
+#endif /* COBJ_TYPES_TYPE_H */
@@ -0,0 +1,300 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "include/chuge.h"
+#include "include/cmethod.h"
+#include "utils/macro.h"
+#include "allocator.h"
+#include "stats.h"
+#include "type.h"
+
+
+/// smallest capacity of a non-empty vector
+#define COBJ_VECTOR_MIN_CAP 4
+
+static const struct CObjSlot slot_huge_threshold = {.name = "huge_threshold"};
+
+
+// element type and allocator of a vector type
+struct CObjVectorInfo {
+  const struct CObjTag *type;
+  const struct CObjTypeInfo *super;
+  struct CObjTypeInfo buf;
+  const struct CObjAllocator *allocator;
+  size_t size;
+};
+
+
+static int CObjVectorInfo_init (
+    struct CObjVectorInfo *self, const struct CObjVector *vector,
+    const struct CObjTag *type) {
+  struct CObjTypeInfo buf;
+  const struct CObjTypeInfo *info = CObjTypeInfo_get(&buf, type);
+  return_if_fail (info != NULL) 255;
+  self->super = CObjTypeInfo_get(&self->buf, info->super);
+  return_if_fail (self->super != NULL) 255;
+  long size = CObjTypeInfo_size(self->super, vector);
+  return_if_fail (size > 0) 255;
+  self->size = size;
+  self->type = type;
+  self->allocator = CObjTypeInfo_allocator(info, vector);
+  return 0;
+}
+
+
+// allocator of a buffer of cap elements; without an allocator of the type,
+// large buffers are mapped directly
+static const struct CObjAllocator *CObjVectorInfo_allocator (
+    const struct CObjVectorInfo *self, const struct CObjVector *vector,
+    size_t cap) {
+  return_if (self->allocator != NULL || cap == 0) self->allocator;
+  long threshold = CObjTagArray_get(
+    self->type, &slot_huge_threshold, vector, COBJ_HUGE_THRESHOLD);
+  return threshold > 0 && self->size * cap >= (size_t) threshold ?
+    &CObjHuge_allocator : NULL;
+}
+
+
+// destroy elements [begin, end) of data
+static void CObjVector_destroy_ (
+    void *data, const struct CObjVectorInfo *info, size_t begin, size_t end,
+    struct CObjMsg *msg) {
+  struct CMethodContext context;
+  const struct CObjTag *types[2];
+  return_if_fail (CObjTypeInfo_context(
+    info->super, COBJ_TYPE_METHOD_DESTROY, &context, types, msg) == 0);
+  for (size_t i = begin; i < end; i++) {
+    context.func((char *) data + info->size * i, &context);
+  }
+}
+
+
+// move n elements from src to the uninitialized dst; on error, the number of
+// elements moved is stored in moved
+static int CObjVector_relocate (
+    void *dst, void *src, size_t n, size_t *moved,
+    const struct CObjVectorInfo *info, struct CObjMsg *msg) {
+  return_if (n == 0) 0;
+  struct CMethodContext context;
+  const struct CObjTag *types[2];
+  if (CObjTypeInfo_context(
+        info->super, COBJ_TYPE_METHOD_MOVE, &context, types, msg) == 0) {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_METHOD, n);
+    for (size_t i = 0; i < n; i++) {
+      int res = ((int (*) ()) context.func)(
+        (char *) dst + info->size * i, (char *) src + info->size * i,
+        &context);
+      should (res == 0) otherwise {
+        *moved = i;
+        return res;
+      }
+    }
+    return 0;
+  }
+
+  // without a mover, elements are relocatable bit by bit
+  COBJ_STATS_RECORD(COBJ_STAT_COPY_MEMCPY, info->size * n);
+  memcpy(dst, src, info->size * n);
+  return 0;
+}
+
+
+// move the first n elements of data back into the vector after a failed
+// relocation; should that fail too, the elements not moved back are destroyed,
+// and the vector is truncated before them
+static void CObjVector_restore (
+    struct CObjVector *self, void *data, size_t n,
+    const struct CObjVectorInfo *info, struct CObjMsg *msg) {
+  struct CMethodContext move;
+  struct CMethodContext destroy;
+  const struct CObjTag *move_types[2];
+  const struct CObjTag *destroy_types[2];
+  return_if_fail (CObjTypeInfo_context(
+    info->super, COBJ_TYPE_METHOD_MOVE, &move, move_types, msg) == 0);
+  bool has_destroy = CObjTypeInfo_context(
+    info->super, COBJ_TYPE_METHOD_DESTROY, &destroy, destroy_types, msg) == 0;
+
+  for (size_t i = 0; i < n; i++) {
+    char *dst = (char *) self->data + info->size * i;
+    char *src = (char *) data + info->size * i;
+    // the moved-from element is destroyed before being overwritten
+    if (has_destroy) {
+      destroy.func(dst, &destroy);
+    }
+    continue_if (((int (*) ()) move.func)(dst, src, &move) == 0);
+    CObjVector_destroy_(data, info, i, n, msg);
+    CObjVector_destroy_(self->data, info, i + 1, self->len, msg);
+    self->len = i;
+    return;
+  }
+}
+
+
+static int CObjVector_grow (
+    struct CObjVector *self, const struct CObjVectorInfo *info, size_t cap,
+    struct CObjMsg *msg) {
+  return_if (cap <= self->cap) 0;
+  return_if_fail (cap <= PTRDIFF_MAX / info->size) -1;
+
+  bool has_mover = info->super->methods[COBJ_TYPE_METHOD_MOVE].res == 0;
+  const struct CObjAllocator *old = CObjVectorInfo_allocator(
+    info, self, self->cap);
+  const struct CObjAllocator *allocator = CObjVectorInfo_allocator(
+    info, self, cap);
+
+  void *data;
+  if (allocator == old && (!has_mover || self->len == 0)) {
+    // realloc may extend in place, or remap large blocks without copying
+    data = CObjAllocator_realloc(allocator, self->data, info->size * cap);
+    return_if_fail (data != NULL) -1;
+  } else {
+    data = CObjAllocator_malloc(allocator, info->size * cap);
+    return_if_fail (data != NULL) -1;
+    size_t moved;
+    int res = CObjVector_relocate(
+      data, self->data, self->len, &moved, info, msg);
+    should (res == 0) otherwise {
+      CObjVector_restore(self, data, moved, info, msg);
+      CObjAllocator_free(allocator, data);
+      return res;
+    }
+    // elements relocated bit by bit are not destroyed
+    if (has_mover) {
+      CObjVector_destroy_(self->data, info, 0, self->len, msg);
+    }
+    CObjAllocator_free(old, self->data);
+  }
+  self->data = data;
+  self->cap = cap;
+  return 0;
+}
+
+
+// geometric growth for appending n elements
+static int CObjVector_grow_for (
+    struct CObjVector *self, const struct CObjVectorInfo *info, size_t n,
+    struct CObjMsg *msg) {
+  return_if_fail (n <= SIZE_MAX - self->len) -1;
+  size_t need = self->len + n;
+  return_if (need <= self->cap) 0;
+  size_t cap = self->cap < COBJ_VECTOR_MIN_CAP ?
+    COBJ_VECTOR_MIN_CAP : self->cap + self->cap / 2;
+  return CObjVector_grow(self, info, max(cap, need), msg);
+}
+
+
+int CObjVector_reserve (
+    struct CObjVector *self, const struct CObjTag *type, size_t cap,
+    struct CObjMsg *msg) {
+  struct CObjVectorInfo info;
+  int res = CObjVectorInfo_init(&info, self, type);
+  return_if_fail (res == 0) res;
+  return CObjVector_grow(self, &info, cap, msg);
+}
+
+
+int CObjVector_extend (
+    struct CObjVector *self, const struct CObjTag *type, const void *other,
+    size_t n, struct CObjMsg *msg) {
+  return_if (n == 0) 0;
+  struct CObjVectorInfo info;
+  int res = CObjVectorInfo_init(&info, self, type);
+  return_if_fail (res == 0) res;
+  res = CObjVector_grow_for(self, &info, n, msg);
+  return_if_fail (res == 0) res;
+
+  char *dst = (char *) self->data + info.size * self->len;
+  struct CMethodContext context;
+  const struct CObjTag *types[2];
+  if (CObjTypeInfo_context(
+        info.super, COBJ_TYPE_METHOD_INIT, &context, types, msg) != 0) {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_MEMCPY, info.size * n);
+    memcpy(dst, other, info.size * n);
+  } else {
+    COBJ_STATS_RECORD(COBJ_STAT_COPY_METHOD, n);
+    for (size_t i = 0; i < n; i++) {
+      res = ((int (*) ()) context.func)(
+        dst + info.size * i, (const char *) other + info.size * i, &context);
+      should (res == 0) otherwise {
+        CObjVector_destroy_(
+          self->data, &info, self->len, self->len + i, msg);
+        return res;
+      }
+    }
+  }
+  self->len += n;
+  return 0;
+}
+
+
+int CObjVector_append (
+    struct CObjVector *self, const struct CObjTag *type, const void *elem,
+    struct CObjMsg *msg) {
+  return CObjVector_extend(self, type, elem, 1, msg);
+}
+
+
+int Vector_len (const struct CObjVector *self,
+                const struct CMethodContext *ctx) {
+  (void) ctx;
+  return self->len;
+}
+const struct CMethod VectorType_len[] = {
+  {.func = (CObjFunc) Vector_len, .traits = trait_AsuperIsize},
+  {0}
+};
+
+
+int Vector_init_copy (
+    struct CObjVector *self, const struct CObjVector *other,
+    const struct CMethodContext *ctx) {
+  *self = (struct CObjVector) {0};
+  int res = CObjVector_extend(
+    self, ctx->types[0], other->data, other->len, ctx->msg);
+  should (res == 0) otherwise {
+    struct CObjVectorInfo info;
+    if (CObjVectorInfo_init(&info, self, ctx->types[0]) == 0) {
+      CObjAllocator_free(
+        CObjVectorInfo_allocator(&info, self, self->cap), self->data);
+    }
+    self->data = NULL;
+  }
+  return res;
+}
+const struct CMethod VectorType_init[] = {
+  {.func = (CObjFunc) Vector_init_copy,
+   .traits = trait_AsuperPeqBsuper_AsuperIsize},
+  {0}
+};
+
+
+void Vector_destroy (struct CObjVector *self,
+                     const struct CMethodContext *ctx) {
+  struct CObjVectorInfo info;
+  return_if_fail (CObjVectorInfo_init(&info, self, ctx->types[0]) == 0);
+  CObjVector_destroy_(self->data, &info, 0, self->len, ctx->msg);
+  CObjAllocator_free(
+    CObjVectorInfo_allocator(&info, self, self->cap), self->data);
+  *self = (struct CObjVector) {0};
+}
+const struct CMethod VectorType_destroy[] = {
+  {.func = (CObjFunc) Vector_destroy, .traits = trait_AsuperIsize},
+  {0}
+};
+
+
+int Vector_move (
+    struct CObjVector *self, struct CObjVector *other,
+    const struct CMethodContext *ctx) {
+  (void) ctx;
+  *self = *other;
+  *other = (struct CObjVector) {0};
+  return 0;
+}
+const struct CMethod VectorType_move[] = {
+  {.func = (CObjFunc) Vector_move,
+   .traits = trait_AsuperPeqBsuper_AsuperIsize},
+  {0}
+};
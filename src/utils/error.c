@@ -54,8 +54,8 @@ int CObjTagArray_putname (const struct CObjTag *self, FILE *stream) {
   if (super != NULL) {
     ret += fputs("(", stream);
     while (1) {
-      ret += CObjTagArray_putname(super, stream);
-      super = CObjTagArray_find_public(self + 1);
+      ret += CObjTagArray_putname(super->tags, stream);
+      super = CObjTagArray_find_public(super + 1);
       if (super == NULL) {
         ret += fputs(")", stream);
         break;
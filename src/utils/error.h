@@ -15,7 +15,8 @@ __attribute__((access(read_only, 1)))
  * @param stream The stream to print to.
  * @return Number of characters printed.
  */
-int CObjTagArray_putname (const struct CObjTag *self, FILE *stream);
+COBJ_CORE_LOCAL int CObjTagArray_putname (
+  const struct CObjTag *self, FILE *stream);
 
 __attribute__((noreturn, format(printf, 2, 3)))
 /**
@@ -27,7 +28,7 @@ __attribute__((noreturn, format(printf, 2, 3)))
  * @param format Format string.
  * @param ... Format arguments.
  */
-void CObjTagArray_TypeError (
+COBJ_CORE_LOCAL void CObjTagArray_TypeError (
   const struct CObjTag *self, const char *format, ...);
 
 
@@ -0,0 +1,74 @@
+#ifndef COBJ_UTILS_SEQLOCK_H
+#define COBJ_UTILS_SEQLOCK_H
+
+#include <stdbool.h>
+
+#include "macro.h"
+
+
+/**
+ * @file
+ * Sequence lock for small caches with one writer and many readers at a time.
+ *
+ * The sequence number is even when the protected data is stable and odd while
+ * a writer is updating it. It never goes backwards, so readers cannot be
+ * fooled by ABA.
+ */
+
+
+__attribute__((warn_unused_result, nonnull, access(read_only, 1)))
+/**
+ * @brief Begin a read-side critical section.
+ *
+ * @param seq Sequence number.
+ * @return Sequence number to be passed to seqlock_read_end(), or odd value if
+ *  a writer is active.
+ */
+static inline unsigned seqlock_read_begin (const unsigned *seq) {
+  return __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+}
+
+__attribute__((warn_unused_result, nonnull, access(read_only, 1)))
+/**
+ * @brief End a read-side critical section.
+ *
+ * @param seq Sequence number.
+ * @param begin Value returned by seqlock_read_begin().
+ * @return @c true if data read in the section is consistent.
+ */
+static inline bool seqlock_read_end (const unsigned *seq, unsigned begin) {
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return likely (!(begin & 1)) &&
+         likely (__atomic_load_n(seq, __ATOMIC_RELAXED) == begin);
+}
+
+__attribute__((warn_unused_result, nonnull))
+/**
+ * @brief Try to begin a write-side critical section. Never blocks.
+ *
+ * @param seq Sequence number.
+ * @param[out] begin Sequence number to be passed to seqlock_write_end().
+ * @return @c true if the lock is acquired.
+ */
+static inline bool seqlock_write_begin (unsigned *seq, unsigned *begin) {
+  *begin = __atomic_load_n(seq, __ATOMIC_RELAXED);
+  return_if_fail (!(*begin & 1)) false;
+  return_if_fail (__atomic_compare_exchange_n(
+    seq, begin, *begin + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) false;
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  return true;
+}
+
+__attribute__((nonnull))
+/**
+ * @brief End a write-side critical section.
+ *
+ * @param seq Sequence number.
+ * @param begin Value set by seqlock_write_begin().
+ */
+static inline void seqlock_write_end (unsigned *seq, unsigned begin) {
+  __atomic_store_n(seq, begin + 2, __ATOMIC_RELEASE);
+}
+
+
+#endif /* COBJ_UTILS_SEQLOCK_H */
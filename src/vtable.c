@@ -0,0 +1,125 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "include/cvtable.h"
+#include "utils/macro.h"
+#include "allocator.h"
+#include "slot.h"
+#include "tag.h"
+#include "vtable.h"
+
+
+// count tags of the tag set and its public tag sets, or -1 if too deep
+static int CObjTagArray_count_all (const struct CObjTag *self, int depth) {
+  return_if_fail (depth < COBJ_TAG_VALIDATE_DEPTH) -1;
+  int n = 0;
+  for (const struct CObjTag *tag = self; !CObjTag_isnull(tag); tag++) {
+    n++;
+    continue_if_not (tag->type == COBJ_TYPE_TAGS && tag->public_ &&
+                     tag->tags != NULL);
+    int super_n = CObjTagArray_count_all(tag->tags, depth + 1);
+    return_if_fail (super_n >= 0) -1;
+    n += super_n;
+  }
+  return n;
+}
+
+
+static struct CObjVTableEntry *CObjVTable_entry (
+    const struct CObjVTable *self, const struct CObjSlot *slot) {
+  for (unsigned i = CObjSlot_hash(slot); ; i++) {
+    const struct CObjVTableEntry *entry = self->entries + (i & self->mask);
+    return_if (CObjSlot_isnull(&entry->slot) ||
+               CObjSlot_equal(&entry->slot, slot))
+      (struct CObjVTableEntry *) entry;
+  }
+}
+
+
+static void CObjVTable_fill (
+    struct CObjVTable *self, const struct CObjTag *tags) {
+  for (const struct CObjTag *tag = tags; !CObjTag_isnull(tag); tag++) {
+    struct CObjVTableEntry *entry = CObjVTable_entry(self, &tag->slot);
+    if (CObjSlot_isnull(&entry->slot)) {
+      // resolve from the finalized tag set, so that overrides win; the tag
+      // set may not be validated, so defective aliases are left out
+      const struct CObjTag *target;
+      int offset;
+      const struct CObjVariant *v = CObjTagArray_resolve_unchecked(
+        self->type, &tag->slot, &target, &offset);
+      if (v != NULL) {
+        *entry = (struct CObjVTableEntry) {
+          .slot = tag->slot, .v = v, .target = target, .offset = offset};
+        self->len++;
+      }
+    }
+    if (tag->type == COBJ_TYPE_TAGS && tag->public_ && tag->tags != NULL) {
+      CObjVTable_fill(self, tag->tags);
+    }
+  }
+}
+
+
+unsigned CObjVTable_size (const struct CObjTag *type) {
+  int n = CObjTagArray_count_all(type, 0);
+  return_if_fail (n >= 0) 0;
+
+  // keep load factor at most 1/2
+  unsigned size = 8;
+  while (size < 2 * (unsigned) n) {
+    size *= 2;
+  }
+  return size;
+}
+
+
+void CObjVTable_init (
+    struct CObjVTable *self, unsigned size, const struct CObjTag *type,
+    const struct CObjAllocator *allocator, void *mem) {
+  self->type = type;
+  self->allocator = allocator;
+  self->mem = mem;
+  self->len = 0;
+  self->mask = size - 1;
+  memset(self->entries, 0, sizeof(self->entries[0]) * size);
+  CObjVTable_fill(self, type);
+}
+
+
+struct CObjVTable *CObjTagArray_finalize (
+    const struct CObjTag *self, const struct CObjAllocator *allocator) {
+  unsigned size = CObjVTable_size(self);
+  should (size > 0) otherwise {
+    errno = ELOOP;
+    return NULL;
+  }
+
+  struct CObjVTable *ret = CObjAllocator_malloc(
+    allocator, sizeof(*ret) + sizeof(ret->entries[0]) * size);
+  return_if_fail (ret != NULL) NULL;
+  CObjVTable_init(ret, size, self, allocator, ret);
+  return ret;
+}
+
+
+const struct CObjVariant *CObjVTable_resolve (
+    const struct CObjVTable *self, const struct CObjSlot *slot,
+    const struct CObjTag **target, int *offset) {
+  const struct CObjVTableEntry *entry = CObjVTable_entry(self, slot);
+  return_if_fail (!CObjSlot_isnull(&entry->slot)) NULL;
+  if (target != NULL) {
+    *target = entry->target;
+  }
+  if (offset != NULL) {
+    *offset = entry->offset;
+  }
+  return entry->v;
+}
+
+
+void CObjVTable_free (struct CObjVTable *self) {
+  return_if_fail (self != NULL);
+  CObjAllocator_free(self->allocator, self->mem);
+}
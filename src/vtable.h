@@ -0,0 +1,34 @@
+#ifndef COBJ_VTABLE_H
+#define COBJ_VTABLE_H
+
+#include "include/cvtable.h"
+
+
+__attribute__((warn_unused_result, nonnull, access(read_only, 1)))
+/**
+ * @memberof CObjVTable
+ * @brief Get the number of entries of the slot table of a tag set.
+ *
+ * @param type Tag set.
+ * @return Number of entries, or 0 if public tag sets nest too deep.
+ */
+unsigned CObjVTable_size (const struct CObjTag *type);
+__attribute__((nonnull(1, 3), access(write_only, 1), access(read_only, 3),
+               access(read_only, 4)))
+/**
+ * @memberof CObjVTable
+ * @brief Fill a slot table in place.
+ *
+ * @param self Slot table, with room for @p size entries.
+ * @param size Number of entries, as returned by CObjVTable_size().
+ * @param type Tag set.
+ * @param allocator Memory allocator of @p mem, can be @c NULL.
+ * @param mem Start of the allocation holding the table, freed by
+ *  CObjVTable_free().
+ */
+void CObjVTable_init (
+  struct CObjVTable *self, unsigned size, const struct CObjTag *type,
+  const struct CObjAllocator *allocator, void *mem);
+
+
+#endif /* COBJ_VTABLE_H */
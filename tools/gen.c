@@ -0,0 +1,320 @@
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "include/cgen.h"
+#include "include/cmethod.h"
+#include "include/cvtable.h"
+#include "utils/macro.h"
+#include "slot.h"
+
+
+/// maximum number of seeds tried for each table size
+#define GEN_SEED_TRIES 100000
+
+/// Statically resolved slot.
+struct GenEntry {
+  const struct CObjVTableEntry *entry;
+  /// symbol and index of the tag holding CObjVTableEntry::v
+  const char *v_sym;
+  ptrdiff_t v_index;
+  /// symbol and index of CObjVTableEntry::target
+  const char *target_sym;
+  ptrdiff_t target_index;
+  /// method for a call with the type as the only argument, if any
+  const char *method_sym;
+  ptrdiff_t method_index;
+};
+
+/// Symbols already declared in the output.
+static const char *declared[4096];
+static unsigned declared_len;
+
+
+// find the exported symbol containing p, as an element of an array of `size`
+static bool sym_of (const void *p, size_t size, const char **sym,
+                    ptrdiff_t *index) {
+  Dl_info info;
+  return_if_fail (dladdr(p, &info) != 0 && info.dli_sname != NULL &&
+                  info.dli_saddr != NULL) false;
+  ptrdiff_t off = (const char *) p - (const char *) info.dli_saddr;
+  return_if_fail (off >= 0 && off % size == 0) false;
+  *sym = info.dli_sname;
+  *index = off / size;
+  return true;
+}
+
+
+static void declare (const char *sym, const char *type, FILE *out) {
+  for (unsigned i = 0; i < declared_len; i++) {
+    return_if (strcmp(declared[i], sym) == 0);
+  }
+  if (declared_len < arraysize(declared)) {
+    declared[declared_len++] = sym;
+  }
+  fprintf(out, "extern const struct %s %s[];\n", type, sym);
+}
+
+
+static void put_slot (const struct CObjSlot *slot, FILE *out) {
+  fputs("&(const struct CObjSlot) {.name = \"", out);
+  size_t len = strnlen(slot->name, sizeof(slot->name));
+  for (size_t i = 0; i < len; i++) {
+    unsigned char c = slot->name[i];
+    if (c == '"' || c == '\\') {
+      fprintf(out, "\\%c", c);
+    } else if (c < 0x20 || c >= 0x7f) {
+      fprintf(out, "\\%03o", c);
+    } else {
+      fputc(c, out);
+    }
+  }
+  fprintf(out, "\", .ns = %d}", slot->ns);
+}
+
+
+// find a seed so that all slots hash to different buckets
+static bool find_seed (
+    const struct GenEntry *entries, unsigned n, unsigned mask,
+    uint64_t *seed) {
+  bool used[mask + 1];
+  for (unsigned tries = 1; tries <= GEN_SEED_TRIES; tries++) {
+    *seed = tries * 0x9e3779b97f4a7c15;
+    memset(used, 0, sizeof(used));
+    unsigned i;
+    for (i = 0; i < n; i++) {
+      unsigned h = CObjGen_hash(&entries[i].entry->slot, *seed) & mask;
+      break_if (used[h]);
+      used[h] = true;
+    }
+    return_if (i == n) true;
+  }
+  return false;
+}
+
+
+static void put_switch (
+    const struct GenEntry *entries, unsigned n, unsigned mask, uint64_t seed,
+    bool methods, FILE *out) {
+  fprintf(out, "  switch (CObjGen_hash(slot, UINT64_C(%#llx)) & %#x) {\n",
+          (unsigned long long) seed, mask);
+  for (unsigned i = 0; i < n; i++) {
+    const struct GenEntry *e = entries + i;
+    continue_if (methods && e->method_sym == NULL);
+    fprintf(out, "    case %#x:\n      if (!CObjGen_match(slot, ",
+            (unsigned) (CObjGen_hash(&e->entry->slot, seed) & mask));
+    put_slot(&e->entry->slot, out);
+    fputs(")) {\n        break;\n      }\n", out);
+    if (methods) {
+      fprintf(out, "      return %s + %td;\n", e->method_sym, e->method_index);
+    } else {
+      fprintf(out,
+              "      if (target != NULL) {\n"
+              "        *target = %s + %td;\n"
+              "      }\n"
+              "      if (offset != NULL) {\n"
+              "        *offset = %d;\n"
+              "      }\n"
+              "      return &%s[%td].data;\n",
+              e->target_sym, e->target_index, e->entry->offset,
+              e->v_sym, e->v_index);
+    }
+  }
+  fputs("  }\n", out);
+}
+
+
+static int gen_type (const char *name, FILE *out) {
+  const struct CObjTag *type = dlsym(RTLD_DEFAULT, name);
+  should (type != NULL) otherwise {
+    fprintf(stderr, "%s: symbol not found\n", name);
+    return 1;
+  }
+  struct CObjVTable *vtable = CObjTagArray_finalize(type, NULL);
+  should (vtable != NULL) otherwise {
+    fprintf(stderr, "%s: %s\n", name, strerror(errno));
+    return 1;
+  }
+
+  // a type without slots still gets a lookup, which finds nothing
+  struct GenEntry entries[max(vtable->len, 1u)];
+  unsigned n = 0;
+  unsigned n_methods = 0;
+  // slots which are not exported are left to the runtime
+  bool complete = true;
+  for (unsigned i = 0; i <= vtable->mask; i++) {
+    const struct CObjVTableEntry *entry = vtable->entries + i;
+    continue_if (CObjSlot_isnull(&entry->slot));
+    struct GenEntry *e = entries + n;
+    *e = (struct GenEntry) {.entry = entry};
+    const struct CObjTag *tag = (const struct CObjTag *) (
+      (const char *) entry->v - offsetof(struct CObjTag, data));
+    should (sym_of(tag, sizeof(*tag), &e->v_sym, &e->v_index) &&
+            sym_of(entry->target, sizeof(*tag), &e->target_sym,
+                   &e->target_index)) otherwise {
+      complete = false;
+      continue;
+    }
+    if (entry->v->type == COBJ_TYPE_CMETHODS && entry->v->methods != NULL) {
+      const struct CMethod *method =
+        CMethodArray_find(entry->v->methods, &type, 1);
+      if (method != NULL &&
+          sym_of(method, sizeof(*method), &e->method_sym, &e->method_index)) {
+        n_methods++;
+      }
+    }
+    n++;
+  }
+
+  unsigned mask = 0;
+  uint64_t seed = 0;
+  while (mask + 1 < n) {
+    mask = mask * 2 + 1;
+  }
+  for (; !find_seed(entries, n, mask, &seed); mask = mask * 2 + 1) {
+    should (mask < 8 * vtable->len) otherwise {
+      fprintf(stderr, "%s: no perfect hash found\n", name);
+      CObjVTable_free(vtable);
+      return 1;
+    }
+  }
+
+  declare(name, "CObjTag", out);
+  for (unsigned i = 0; i < n; i++) {
+    declare(entries[i].v_sym, "CObjTag", out);
+    declare(entries[i].target_sym, "CObjTag", out);
+    if (entries[i].method_sym != NULL) {
+      declare(entries[i].method_sym, "CMethod", out);
+    }
+  }
+
+  fprintf(out,
+          "\n"
+          "__attribute__((warn_unused_result, nonnull(1),\n"
+          "               access(read_only, 1), access(write_only, 2),\n"
+          "               access(write_only, 3)))\n"
+          "/**\n"
+          " * @brief Resolve a slot name of %s statically, like\n"
+          " *  CObjTagArray_resolve().\n"
+          " *\n"
+          " * @param slot Slot name.\n"
+          " * @param[out] target The target tag set.\n"
+          " * @param[out] offset Offset of the target tag set.\n"
+          " * @return Tag data, or @c NULL if not found.\n"
+          " */\n"
+          "static inline const struct CObjVariant *%s_static_resolve (\n"
+          "    const struct CObjSlot *slot, const struct CObjTag **target,\n"
+          "    int *offset) {\n",
+          name, name);
+  put_switch(entries, n, mask, seed, false, out);
+  if (complete) {
+    fputs("  return NULL;\n}\n", out);
+  } else {
+    fprintf(out, "  return CObjTagArray_resolve(%s, slot, target, offset);\n"
+                 "}\n", name);
+  }
+
+  if (n_methods > 0) {
+    fprintf(out,
+            "\n"
+            "__attribute__((pure, warn_unused_result, nonnull,\n"
+            "               access(read_only, 1)))\n"
+            "/**\n"
+            " * @brief Find the method for a call with %s as the only\n"
+            " *  argument statically, like CMethodArray_find().\n"
+            " *\n"
+            " * @param slot Slot name.\n"
+            " * @return Method descriptor, or @c NULL if not found.\n"
+            " */\n"
+            "static inline const struct CMethod *%s_static_dispatch (\n"
+            "    const struct CObjSlot *slot) {\n",
+            name, name);
+    put_switch(entries, n, mask, seed, true, out);
+    fputs("  return NULL;\n}\n", out);
+  }
+  fputs("\n", out);
+
+  CObjVTable_free(vtable);
+  return 0;
+}
+
+
+static void usage (const char *prog) {
+  fprintf(stderr,
+          "Usage: %s [-l LIBRARY]... [-o OUTPUT] TYPE...\n"
+          "Emit a header with static slot lookups of exported tag sets.\n"
+          "  -l LIBRARY  load shared object defining the types\n"
+          "  -o OUTPUT   write to OUTPUT instead of standard output\n"
+          "  -g GUARD    include guard (default: COBJ_STATIC_H)\n",
+          prog);
+}
+
+
+int main (int argc, char *argv[]) {
+  const char *output = NULL;
+  const char *guard = "COBJ_STATIC_H";
+  int opt;
+  while ((opt = getopt(argc, argv, "l:o:g:h")) != -1) {
+    switch (opt) {
+      case 'l':
+        should (dlopen(optarg, RTLD_NOW | RTLD_GLOBAL) != NULL) otherwise {
+          fprintf(stderr, "%s\n", dlerror());
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      case 'g':
+        guard = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  should (optind < argc) otherwise {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  FILE *out = stdout;
+  if (output != NULL) {
+    out = fopen(output, "w");
+    should (out != NULL) otherwise {
+      perror(output);
+      return EXIT_FAILURE;
+    }
+  }
+
+  fprintf(out,
+          "/* Generated by cobj-gen. Do not edit. */\n"
+          "#ifndef %s\n"
+          "#define %s\n"
+          "\n"
+          "#include <stddef.h>\n"
+          "\n"
+          "#include \"cgen.h\"\n"
+          "#include \"cmethod.h\"\n"
+          "\n",
+          guard, guard);
+  int ret = 0;
+  for (int i = optind; i < argc; i++) {
+    ret |= gen_type(argv[i], out);
+  }
+  fprintf(out, "\n#endif /* %s */\n", guard);
+
+  if (out != stdout) {
+    fclose(out);
+    if (ret != 0) {
+      remove(output);
+    }
+  }
+  return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}